@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "iex_messages.h"
+#include "order.h"
+#include "price.h"
+#include "symbol.h"
+
+struct BBO;
+
+/// \class BookListener
+/// \brief Receives the changes a book makes, in place of printing them.
+///
+/// Register one with OrderBook::SetListener or L3OrderBook::SetListener. Every callback does
+/// nothing by default, so a listener only overrides what it needs. Callbacks run synchronously on
+/// the thread updating the book, and a book without a listener makes no calls at all.
+class BookListener {
+ public:
+  virtual ~BookListener() = default;
+
+  /// \brief The best bid and offer moved at the end of an event.
+  ///
+  /// \param bbo  The new BBO, nullptr if one side is empty or the book is crossed.
+  virtual void OnBboChange(const Symbol& /*symbol*/, const BBO* /*bbo*/) {}
+
+  /// \brief A price level of an OrderBook was set, a size of 0 means it was removed.
+  virtual void OnLevelChange(const Symbol& /*symbol*/, Side /*side*/, Price /*price*/,
+                             int /*size*/) {}
+
+  /// \brief An order was added to an L3OrderBook.
+  virtual void OnOrderAdded(const Symbol& /*symbol*/, const Order& /*order*/) {}
+
+  /// \brief An order changed size or price, order holds the new values.
+  virtual void OnOrderModified(const Symbol& /*symbol*/, const Order& /*order*/) {}
+
+  /// \brief An order was executed, in part or completely.
+  ///
+  /// \param order          The order after the execution, with the size still resting.
+  /// \param executed_size  Size of this execution.
+  /// \param price          Execution price.
+  virtual void OnOrderExecuted(const Symbol& /*symbol*/, const Order& /*order*/,
+                               uint32_t /*executed_size*/, Price /*price*/) {}
+
+  /// \brief An order was removed from the book, either deleted or completely executed.
+  virtual void OnOrderDeleted(const Symbol& /*symbol*/, const Order& /*order*/) {}
+
+  /// \brief A trade report reached an L3OrderBook.
+  virtual void OnTrade(const TradeReportMessage& /*trade*/) {}
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "book_listener.h"
+#include "iex_messages.h"
+#include "l3book.h"
+#include "orderbook.h"
+#include "symbol_table.h"
+
+/// \brief Memory and activity of the books of one symbol, see BookManager::GetUsage.
+struct BookUsage {
+  Symbol symbol;
+
+  /// \brief Price level updates applied to the OrderBook.
+  uint64_t updates = 0;
+
+  /// \brief Order messages applied to the L3OrderBook.
+  uint64_t l3_updates = 0;
+
+  /// \brief Updates that threw, e.g. an order priced outside the L3OrderBook range.
+  uint64_t errors = 0;
+
+  /// \brief Approximate bytes held by both books, including the books themselves.
+  size_t memory_bytes = 0;
+};
+
+/// \class BookManager
+/// \brief Books for the whole DEEP universe, held in dense arrays indexed by symbol id.
+///
+/// Books are allocated as SecurityDirectory messages arrive at the start of the day; a symbol
+/// without a directory entry gets its OrderBook on first use. Routing a message costs one probe of
+/// the SymbolTable on the packed symbol and an array index, no strings are built or hashed.
+/// Price level updates (DEEP) go to the OrderBook of the symbol, order messages and trades
+/// (DEEP+) to its L3OrderBook, if L3 books are enabled.
+class BookManager {
+ public:
+  /// \brief Builds the L3OrderBook of a security, or returns nothing to go without one.
+  using L3BookFactory =
+      std::function<std::optional<L3OrderBook>(const SecurityDirectoryMessage& directory)>;
+
+  /// \param expected_symbols Capacity hint. The IEX universe is roughly 10,000 symbols.
+  explicit BookManager(size_t expected_symbols = 16384);
+
+  /// \brief Build L3 books with factory for every security added from now on.
+  void EnableL3Books(L3BookFactory factory) { l3_factory_ = std::move(factory); }
+
+  /// \brief Default limit on the levels of one L3 book built by PriceBandL3Books, about 1.5MB of
+  ///        empty levels. A +/- 20% band stays below it up to a close of roughly $1,600.
+  constexpr static size_t default_max_l3_levels = 65536;
+
+  /// \brief An L3BookFactory covering band around the adjusted previous close of a security, in
+  ///        cents, or in 1/100 cents below one dollar. Securities without a close, or whose band
+  ///        would need more than max_levels levels, get no book.
+  static L3BookFactory PriceBandL3Books(double band = 0.2,
+                                        size_t max_levels = default_max_l3_levels);
+
+  /// \brief Report the changes of every book to listener, including books added later.
+  void SetListener(BookListener* listener);
+
+  /// \brief Allocate the books of a security.
+  ///
+  /// \return The id of the security.
+  uint32_t AddSecurity(const SecurityDirectoryMessage& directory);
+
+  /// \brief Apply a message to the books of its symbol. SecurityDirectory messages add books.
+  ///
+  /// \return The id of the symbol whose books were updated, SymbolTable::invalid_id otherwise.
+  uint32_t ProcessMessage(const IEXMessage& msg);
+
+  /// \brief The books of a symbol id, nullptr for no L3 book.
+  OrderBook& GetOrderBook(uint32_t id) { return books_[id]; }
+  const OrderBook& GetOrderBook(uint32_t id) const { return books_[id]; }
+  const L3OrderBook* GetL3OrderBook(uint32_t id) const { return l3_books_[id].get(); }
+
+  const SymbolTable& GetSymbolTable() const { return symbols_; }
+
+  /// \brief Number of symbols with books, which is also one past the largest id.
+  size_t Size() const { return books_.size(); }
+
+  /// \brief Memory and update counts of the books of a symbol id.
+  BookUsage GetUsage(uint32_t id) const;
+
+  /// \brief Memory and update counts of all symbols, indexed by id.
+  std::vector<BookUsage> GetUsage() const;
+
+ private:
+  /// \brief Id of a symbol, allocating its OrderBook if it is new.
+  uint32_t Intern(const Symbol& symbol);
+
+  SymbolTable symbols_;
+
+  /// \brief Per symbol state, all indexed by id.
+  std::vector<OrderBook> books_;
+  std::vector<std::unique_ptr<L3OrderBook>> l3_books_;
+  std::vector<uint64_t> updates_;
+  std::vector<uint64_t> l3_updates_;
+  std::vector<uint64_t> errors_;
+
+  L3BookFactory l3_factory_;
+  BookListener* listener_ = nullptr;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "l3book.h"
+#include "orderbook.h"
+#include "packet_source.h"
+#include "spsc_queue.h"
+
+/// \brief The fields of a book update message, flattened into a fixed size record.
+///
+/// Records are what travels between the decoding thread and the book workers, a fraction of the
+/// size of an IEXMessage and trivially copyable.
+struct MessageRecord {
+  uint64_t timestamp;
+
+  /// \brief Order id, referenced order id or trade id, depending on the type.
+  uint64_t order_id;
+  Price price;
+  Symbol symbol;
+  uint32_t size;
+
+  /// \brief The message type byte, see GetType.
+  uint8_t type;
+
+  /// \brief Event flags, order side or modify flags, depending on the type.
+  uint8_t flags;
+
+  MessageType GetType() const { return static_cast<MessageType>(type); }
+};
+
+static_assert(sizeof(MessageRecord) == 40, "MessageRecord is meant to stay compact.");
+
+/// \brief Flatten a book update message.
+///
+/// \return False if the message does not update a book, record is left untouched then.
+bool ToMessageRecord(const IEXMessage& msg, MessageRecord& record);
+
+/// \brief Rebuild the message a record was made from, as far as the books use it.
+void FromMessageRecord(const MessageRecord& record, IEXMessage& msg);
+
+/// \brief Throughput and queue statistics of one BookPipeline::Run.
+struct PipelineStats {
+  struct Stage {
+    /// \brief Records produced (decoder) or applied (worker).
+    uint64_t records = 0;
+
+    /// \brief Time spent working: the whole decode loop, or applying records to books.
+    double busy_seconds = 0;
+
+    /// \brief Times the stage had to wait: on a full queue (decoder) or an empty one (worker).
+    uint64_t stalls = 0;
+
+    /// \brief Records a book rejected by throwing, e.g. on a crossed BBO.
+    uint64_t errors = 0;
+  };
+
+  struct Queue {
+    size_t capacity = 0;
+    size_t max_occupancy = 0;
+    double mean_occupancy = 0;
+  };
+
+  double elapsed_seconds = 0;
+
+  /// \brief Messages decoded, including those not updating any book.
+  uint64_t messages = 0;
+  Stage decoder;
+  std::vector<Stage> workers;
+  std::vector<Queue> queues;
+};
+
+std::ostream& operator<<(std::ostream& os, const PipelineStats& stats);
+
+/// \class BookPipeline
+/// \brief Builds order books on worker threads while the calling thread decodes.
+///
+/// Symbols are hash partitioned across the workers, so every book is owned by exactly one thread
+/// and needs no locking. The decoding thread turns each book update into a MessageRecord and
+/// pushes it on the SPSC queue of the owning worker; updates of one symbol therefore keep their
+/// feed order. Price level updates (DEEP) go to an OrderBook created on first use, order messages
+/// (DEEP+) go to the L3OrderBook registered for the symbol, if any.
+class BookPipeline {
+ public:
+  /// \param worker_count    Number of book building threads.
+  /// \param queue_capacity  Records buffered per worker.
+  explicit BookPipeline(size_t worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1,
+                        size_t queue_capacity = 1 << 16);
+
+  /// \brief Build an order by order book for a symbol. Call before Run.
+  void AddL3OrderBook(const Symbol& symbol, const L3OrderBook& book);
+
+  /// \brief Decode every remaining message of a decoder and apply it to the books.
+  ///
+  /// \return The return code that ended the decoder stream, EndOfStream normally.
+  ReturnCode Run(IEXDecoder& decoder);
+
+  /// \brief The worker owning the books of a symbol.
+  size_t GetWorkerIndex(const Symbol& symbol) const {
+    return std::hash<Symbol>()(symbol) % workers_.size();
+  }
+
+  /// \brief Book of a symbol, nullptr if no update was seen. Only valid between runs.
+  const OrderBook* GetOrderBook(const Symbol& symbol) const;
+  const L3OrderBook* GetL3OrderBook(const Symbol& symbol) const;
+
+  /// \brief Statistics of the last run.
+  const PipelineStats& GetStats() const { return stats_; }
+
+ private:
+  struct Worker {
+    explicit Worker(size_t queue_capacity) : queue(queue_capacity) {}
+
+    SpscQueue<MessageRecord> queue;
+
+    /// \brief Set by the decoding thread after its last push.
+    std::atomic<bool> done{false};
+    std::thread thread;
+
+    std::unordered_map<Symbol, OrderBook> books;
+    std::unordered_map<Symbol, L3OrderBook> l3_books;
+
+    PipelineStats::Stage stats;
+
+    /// \brief Occupancy samples, taken by the decoding thread.
+    uint64_t pushed = 0;
+    uint64_t occupancy_sum = 0;
+    uint64_t occupancy_samples = 0;
+    size_t max_occupancy = 0;
+  };
+
+  /// \brief Body of a worker thread.
+  static void WorkerLoop(Worker& worker);
+
+  /// \brief Apply one record to the books of a worker. A book throwing is counted, not fatal.
+  static void Apply(Worker& worker, const MessageRecord& record, IEXMessage& msg);
+
+  /// \brief Queue a record for a worker, waiting while its queue is full.
+  void Push(Worker& worker, const MessageRecord& record);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  PipelineStats stats_;
+};
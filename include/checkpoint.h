@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "iex_decoder.h"
+#include "l3book.h"
+#include "orderbook.h"
+#include "symbol.h"
+
+/// \brief A resumable snapshot of a decode loop: where the decoder stands and the books built
+///        from every message before that point.
+///
+/// File layout: the 8 byte magic, the DecoderPosition fields, then (uint32 crc32 of the book
+/// data, uint64 book data length, uint64 compressed length, zlib compressed book data).
+struct Checkpoint {
+  DecoderPosition position;
+
+  /// \brief Serialized books, see SaveBooks.
+  std::string books;
+};
+
+/// \brief Serialize books keyed by symbol, e.g. into Checkpoint::books.
+void SaveBooks(const std::unordered_map<Symbol, OrderBook>& books,
+               const std::unordered_map<Symbol, L3OrderBook>& l3_books, std::string& data);
+
+/// \brief Restore books written by SaveBooks, replacing the contents of both maps.
+///
+/// \return True if succeeds, false if the data is malformed.
+bool LoadBooks(const std::string& data, std::unordered_map<Symbol, OrderBook>& books,
+               std::unordered_map<Symbol, L3OrderBook>& l3_books) WARN_UNUSED;
+
+/// \brief Write a checkpoint file. The previous file at path stays intact until the new one is
+///        completely on disk.
+///
+/// \return True if succeeds, false otherwise.
+bool SaveCheckpoint(const std::string& path, const Checkpoint& checkpoint) WARN_UNUSED;
+
+/// \brief Read a checkpoint file written by SaveCheckpoint or CheckpointWriter.
+///
+/// \return True if succeeds, false if the file is missing, truncated or corrupt.
+bool LoadCheckpoint(const std::string& path, Checkpoint& checkpoint) WARN_UNUSED;
+
+/// \class CheckpointWriter
+/// \brief Writes checkpoints from a background thread, so compression and fsync never stall the
+///        decode loop.
+///
+/// At most one checkpoint waits while another is being written. Submitting while one is waiting
+/// replaces it, only the latest state is worth writing.
+class CheckpointWriter {
+ public:
+  /// \param path  File the checkpoints are written to, each one replacing the last.
+  explicit CheckpointWriter(const std::string& path);
+  ~CheckpointWriter();
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  /// \brief Hand a checkpoint to the background thread. Returns without waiting for the disk.
+  void Submit(Checkpoint checkpoint);
+
+  /// \brief Wait until every submitted checkpoint is written or replaced.
+  ///
+  /// \return False if any write failed.
+  bool Flush();
+
+  /// \brief Number of checkpoints written to disk.
+  uint64_t GetWrittenCount() const;
+
+  /// \brief Number of checkpoints replaced by a later one before being written.
+  uint64_t GetReplacedCount() const;
+
+ private:
+  void WriteLoop();
+
+  const std::string path_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+
+  /// \brief The checkpoint waiting to be written, guarded by mutex_.
+  std::optional<Checkpoint> pending_;
+  bool writing_ = false;
+  bool stop_ = false;
+  bool failed_ = false;
+  uint64_t written_count_ = 0;
+  uint64_t replaced_count_ = 0;
+
+  std::thread thread_;
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "packet_source.h"
+#include "symbol_table.h"
+
+/// \brief Storage type of one column. Values are little endian and tightly packed.
+enum class ColumnType : uint8_t { Int64 = 0, UInt32 = 1, UInt8 = 2 };
+
+/// \brief Width in bytes of one value of a column type.
+inline size_t GetColumnWidth(ColumnType type) {
+  return type == ColumnType::Int64 ? 8 : type == ColumnType::UInt32 ? 4 : 1;
+}
+
+/// \brief Name and type of one column of a table.
+struct ColumnInfo {
+  std::string name;
+  ColumnType type;
+};
+
+/// \brief A run of consecutive rows with the value range of every column.
+struct RowGroup {
+  uint64_t first_row;
+  uint64_t row_count;
+
+  /// \brief Smallest and largest value per column, in column order.
+  std::vector<int64_t> min;
+  std::vector<int64_t> max;
+};
+
+/// \class ColumnarWriter
+/// \brief Exports decoded messages into one table per message type, stored column by column.
+///
+/// Each column of a table is a separate file of packed fixed width values,
+/// "<directory>/<table>.<column>.col", so a reader can map exactly the columns it needs. Rows
+/// are written in groups; "<directory>/<table>.meta" lists the columns and, for every row group,
+/// the min and max of each column, which lets readers skip groups by time range. Symbols are
+/// stored as dense ids, "<directory>/symbols.col" holds the packed symbol of every id.
+///
+/// Tables: quote_update, trade_report, price_level_buy, price_level_sell, add_order,
+/// order_modify, order_delete and order_executed. Prices are in ticks, see Price.
+class ColumnarWriter {
+ public:
+  /// \param row_group_rows  Rows per row group, also the number of rows buffered per table.
+  explicit ColumnarWriter(size_t row_group_rows = 65536);
+  ~ColumnarWriter();
+
+  /// \brief Start an export, creating the directory if needed.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& directory) WARN_UNUSED;
+
+  /// \brief Add one message. Messages without a table are skipped, except SecurityDirectory
+  ///        messages, which assign symbol ids in directory order.
+  ///
+  /// \return False if writing failed.
+  bool Write(const IEXMessage& msg) WARN_UNUSED;
+
+  /// \brief Export every remaining message of a decoder in one pass.
+  ///
+  /// \return The return code that ended the decoder stream, EndOfStream normally, or
+  ///         FailedWriting.
+  ReturnCode WriteAll(IEXDecoder& decoder);
+
+  /// \brief Flush the last row groups and write the metadata and symbol files.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Close();
+
+  /// \brief Number of rows written to all tables.
+  uint64_t GetRowCount() const { return row_count_; }
+
+ private:
+  struct Table;
+
+  size_t row_group_rows_;
+  std::string directory_;
+  std::vector<std::unique_ptr<Table>> tables_;
+  SymbolTable symbols_;
+  uint64_t row_count_ = 0;
+  bool failed_ = false;
+};
+
+/// \class ColumnarTable
+/// \brief Read access to one table written by ColumnarWriter.
+///
+/// Columns are memory mapped on first access and stay mapped until the table is closed.
+class ColumnarTable {
+ public:
+  /// \brief Returned by FindColumn for unknown columns.
+  constexpr static size_t no_column = std::numeric_limits<size_t>::max();
+
+  ColumnarTable() = default;
+  ColumnarTable(const ColumnarTable&) = delete;
+  ColumnarTable& operator=(const ColumnarTable&) = delete;
+  ~ColumnarTable() { Close(); }
+
+  /// \brief Load the metadata of a table.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& directory, const std::string& table) WARN_UNUSED;
+  void Close();
+
+  const std::vector<ColumnInfo>& GetColumns() const { return columns_; }
+  const std::vector<RowGroup>& GetRowGroups() const { return row_groups_; }
+  uint64_t GetRowCount() const { return row_count_; }
+
+  /// \brief Index of a column by name, no_column if there is none.
+  size_t FindColumn(const std::string& name) const;
+
+  /// \brief Indexes of the row groups whose values of a column may lie in [min, max].
+  std::vector<size_t> FindRowGroups(size_t column, int64_t min, int64_t max) const;
+
+  /// \brief Map the values of a column.
+  ///
+  /// \tparam T  Value type, its size must match the column width (int64_t, uint32_t, uint8_t).
+  /// \return Pointer to GetRowCount() values, nullptr on a mismatch or failure.
+  template <typename T>
+  const T* GetColumnData(size_t column) {
+    if (column >= columns_.size() || GetColumnWidth(columns_[column].type) != sizeof(T)) {
+      return nullptr;
+    }
+    return static_cast<const T*>(MapColumn(column));
+  }
+
+ private:
+  const void* MapColumn(size_t column);
+
+  std::string path_prefix_;
+  std::vector<ColumnInfo> columns_;
+  std::vector<RowGroup> row_groups_;
+  uint64_t row_count_ = 0;
+
+  /// \brief Mapping of every column, nullptr while unmapped.
+  std::vector<void*> mappings_;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "packet_source.h"
+
+/// \class CompressedPcapSource
+/// \brief Packet source streaming a gzip (or, if built with zstd, zstd) compressed pcap file.
+///
+/// Decompression runs on a dedicated thread, filling a ring of fixed size buffers that the
+/// packet loop consumes, so decompression overlaps decoding and nothing is written to disk.
+/// Records are returned in place when they lie within one buffer and are copied only when they
+/// straddle two.
+class CompressedPcapSource : public PacketSource {
+ public:
+  /// \param chunk_size   Size of each decompressed buffer in bytes.
+  /// \param chunk_count  Number of buffers in the ring.
+  explicit CompressedPcapSource(size_t chunk_size = 4 << 20, size_t chunk_count = 8);
+  ~CompressedPcapSource() override { Close(); }
+
+  /// \brief Check the magic bytes of a file for a supported compression format.
+  static bool IsCompressed(const std::string& filename);
+
+  bool Open(const std::string& filename) override WARN_UNUSED;
+  void Close() override;
+  ReturnCode GetNextPayload(const uint8_t*& data, size_t& len) override WARN_UNUSED;
+
+  /// \brief Interface to the underlying decompressor, implemented per format.
+  class Reader {
+   public:
+    virtual ~Reader() = default;
+
+    /// \brief Decompress up to len bytes into dst.
+    ///
+    /// \return Number of bytes written, 0 at the end of the stream, negative on error.
+    virtual long Read(uint8_t* dst, size_t len) = 0;
+  };
+
+ private:
+  struct Chunk {
+    std::vector<uint8_t> data;
+    size_t len = 0;
+    bool full = false;
+  };
+
+  /// \brief Body of the decompression thread.
+  void DecompressLoop();
+
+  /// \brief Hand the current buffer back to the decompression thread and wait for the next one.
+  ///
+  /// \return False at the end of the stream.
+  bool NextChunk();
+
+  /// \brief Get the next n bytes of the decompressed stream as one contiguous range.
+  ///
+  /// \return Pointer valid until the next call, or null at the end of the stream.
+  const uint8_t* GetBytes(size_t n);
+
+  std::unique_ptr<Reader> reader_ptr_;
+  std::thread decompress_thread_;
+
+  std::mutex mutex_;
+  std::condition_variable chunk_filled_;
+  std::condition_variable chunk_released_;
+  std::vector<Chunk> ring_;
+  size_t chunk_size_;
+
+  /// \brief Guarded by mutex_: total buffers filled, end of stream and error flags.
+  size_t produced_ = 0;
+  bool end_of_stream_ = false;
+  bool decompress_error_ = false;
+  bool stop_ = false;
+
+  /// \brief Consumer side state, only touched by the decoding thread.
+  size_t consumed_ = 0;
+  Chunk* chunk_ptr_ = nullptr;
+  size_t chunk_pos_ = 0;
+
+  /// \brief Reassembly buffer for records straddling two buffers.
+  std::vector<uint8_t> spill_;
+
+  uint32_t link_type_ = 0;
+  bool swapped_ = false;
+
+  /// \brief Largest captured length of a record, from the snapshot length of the file header.
+  uint32_t max_caplen_ = 0;
+};
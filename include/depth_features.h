@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Features over the structure of arrays depth filled by OrderBook::GetDepth. The loops run over
+// plain arrays without branches or early exits, so the compiler can vectorize them.
+
+/// \brief Total size over the first n levels of a side.
+inline int64_t SumSizes(const int* sizes, size_t n) {
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += sizes[i];
+  }
+  return sum;
+}
+
+/// \brief Size imbalance between the sides, in [-1, 1]. Positive when bids outweigh asks, 0 for
+///        an empty book.
+inline double DepthImbalance(const int* bid_sizes, size_t bid_count, const int* ask_sizes,
+                             size_t ask_count) {
+  const int64_t bid_depth = SumSizes(bid_sizes, bid_count);
+  const int64_t ask_depth = SumSizes(ask_sizes, ask_count);
+  const int64_t total_depth = bid_depth + ask_depth;
+  if (total_depth == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(bid_depth - ask_depth) / static_cast<double>(total_depth);
+}
+
+/// \brief Size over the first n levels of a side, level i weighted by weights[i], e.g. a decay
+///        with the distance from the inside.
+inline double WeightedDepth(const int* sizes, const double* weights, size_t n) {
+  double sum = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += static_cast<double>(sizes[i]) * weights[i];
+  }
+  return sum;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "packet_source.h"
+#include "symbol.h"
+
+/// \brief Compact native storage of the IEX messages of a capture.
+///
+/// Messages are re-encoded field by field from their wire layout: the timestamp as the difference
+/// to the previous message, the symbol as a dense id (the 8 symbol bytes are only stored the
+/// first time), and integer fields as variable length integers. The encoded messages are
+/// collected in blocks that are compressed with zlib. Decoding restores the exact wire bytes, so
+/// the reader yields the same message structs as IEXDecoder, without any pcap or IEX-TP parsing.
+///
+/// File layout: the 8 byte magic, then blocks of (uint32 compressed length, uint32 raw length,
+/// uint32 message count, compressed data).
+namespace event_log {
+
+/// \brief Default amount of encoded messages per compressed block.
+constexpr size_t default_block_size = 1 << 18;
+
+/// \brief Largest raw block length a writer produces and a reader accepts.
+constexpr size_t max_block_size = 1 << 26;
+
+}  // namespace event_log
+
+/// \class EventLogWriter
+/// \brief Converts IEX messages into an event log file.
+class EventLogWriter {
+ public:
+  /// \param block_size  Encoded bytes collected before a block is compressed and written, at
+  ///                    most about event_log::max_block_size.
+  explicit EventLogWriter(size_t block_size = event_log::default_block_size);
+  ~EventLogWriter() { Close(); }
+
+  /// \brief Create or truncate a log file.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& filename) WARN_UNUSED;
+
+  /// \brief Write the last block and close the file.
+  ///
+  /// \return False if any write failed.
+  bool Close();
+
+  /// \brief Append one message.
+  ///
+  /// \param msg_data_ptr  Pointer to the message data (the message type byte).
+  /// \param msg_len       Length of the message data, at most the 65535 bytes of an IEX-TP block.
+  /// \return False if writing failed or the message is too long.
+  bool Write(const uint8_t* msg_data_ptr, size_t msg_len);
+
+  /// \brief Append every remaining message of a decoder, honouring its subscription.
+  ///
+  /// \return The return code that ended the decoder stream, EndOfStream normally, or
+  ///         FailedWriting.
+  ReturnCode WriteAll(IEXDecoder& decoder);
+
+  uint64_t GetMessageCount() const { return message_count_; }
+
+ private:
+  /// \brief Compress and write the current block.
+  bool FlushBlock();
+
+  size_t block_size_;
+  std::ofstream file_;
+  bool failed_ = false;
+
+  /// \brief Encoded messages of the current block.
+  std::vector<uint8_t> block_;
+  uint32_t block_messages_ = 0;
+  std::vector<uint8_t> compressed_;
+
+  uint64_t last_timestamp_ = 0;
+
+  /// \brief Symbols by id, and their ids by packed symbol.
+  std::vector<Symbol> symbols_;
+  std::unordered_map<Symbol, uint32_t> symbol_ids_;
+
+  uint64_t message_count_ = 0;
+};
+
+/// \class EventLogReader
+/// \brief Reads the messages of an event log file in the order they were written.
+class EventLogReader {
+ public:
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& filename) WARN_UNUSED;
+  void Close();
+
+  /// \brief Get the next message in its wire format.
+  ///
+  /// \param msg_data_ptr  Output parameter, pointing to the message type byte. Valid until the
+  ///                      next call.
+  /// \param msg_len       Output parameter, the length of the message data.
+  /// \return Success, EndOfStream at the end of the log, otherwise FailedParsingPacket.
+  ReturnCode GetNextRawMessage(const uint8_t*& msg_data_ptr, size_t& msg_len) WARN_UNUSED;
+
+  /// \brief Get and decode the next message, see IEXDecoder::GetNextMessage.
+  ReturnCode GetNextMessage(IEXMessage& msg) WARN_UNUSED;
+
+ private:
+  /// \brief Read and decompress the next block.
+  ReturnCode ReadBlock();
+
+  std::ifstream file_;
+  uint64_t file_size_ = 0;
+  std::vector<uint8_t> compressed_;
+
+  /// \brief Decompressed current block and the read position in it.
+  std::vector<uint8_t> block_;
+  size_t block_pos_ = 0;
+  uint32_t block_messages_left_ = 0;
+
+  uint64_t last_timestamp_ = 0;
+  std::vector<Symbol> symbols_;
+
+  /// \brief Wire bytes of the message returned last.
+  std::vector<uint8_t> message_;
+};
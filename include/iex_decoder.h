@@ -1,41 +1,60 @@
 #pragma once
 
-#include "Packet.h"
-#include "PcapFileDevice.h"
-
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include "iex_messages.h"
+#include "packet_index.h"
+#include "packet_source.h"
+#include "subscription.h"
+
+/// \brief Decode a single message block into a variant, replacing its previous contents.
+///
+/// \param msg_data_ptr  Pointer to the start of the message data (the message type byte).
+/// \param msg           Output parameter, containing the message if successfully decoded.
+/// \return ReturnCode enum describing success or a specific error code.
+ReturnCode DecodeMessage(const uint8_t* msg_data_ptr, IEXMessage& msg);
 
-/// \enum class ReturnCode
-/// \brief An enum for various possible errors when decoding a message.
-enum class ReturnCode {
-  Success,
-  ClassNotInitialized,
-  FailedParsingPacket,
-  FailedDecodingPacket,
-  UnknownMessageType,
-  EndOfStream
+/// \brief Names the message struct a type byte decodes into, see DispatchMessageType.
+template <typename T>
+struct MessageTag {
+  using type = T;
 };
 
-inline std::string ReturnCodeToString(const ReturnCode & code) {
-  switch(code) {
-    case ReturnCode::Success:
-      return "Success";
-    case ReturnCode::ClassNotInitialized:
-      return "Decoder class not initialized.";
-    case ReturnCode::FailedParsingPacket:
-      return "Failed parsing packet.";
-    case ReturnCode::FailedDecodingPacket:
-      return "Failed decoding packet.";
-    case ReturnCode::UnknownMessageType:
-      return "Unknown message type";
-    case ReturnCode::EndOfStream:
-      return "End of file stream.";
-    default:
-      return "Unknown return code.";
-  }
-}
+/// \brief Select the message struct from the type byte. This is the only mapping of message types
+///        to structs, every decode path goes through it.
+///
+/// \param msg_data_ptr  Pointer to the start of the message data (the message type byte).
+/// \param decode        Called as decode(MessageTag<T>(), args...), args being the constructor
+///                      arguments of T.
+/// \return The ReturnCode of decode, or UnknownMessageType.
+template <typename Decode>
+ReturnCode DispatchMessageType(const uint8_t* msg_data_ptr, Decode&& decode);
+
+/// \brief Where an IEXDecoder stands in a memory mapped file, see IEXDecoder::GetPosition.
+struct DecoderPosition {
+  /// \brief Offset of the pcap record of the open segment, or of the record read next.
+  uint64_t file_offset = 0;
+
+  /// \brief Offset of the next block within the open segment, 0 if no segment is open.
+  uint64_t block_offset = 0;
+
+  /// \brief Number of blocks of the open segment already consumed.
+  uint64_t block_index = 0;
+
+  /// \brief Sequence number of the next message, 0 at the end of the file.
+  int64_t next_sq_num = 0;
+
+  /// \brief Regular hours state, see IEXDecoder::SetRegularHoursOnly.
+  bool in_regular_hours = false;
+
+  /// \brief The end of the time window or of regular hours has been reached.
+  bool past_window = false;
+};
 
 /// \class IEXDecoder
 /// \brief A class for reading and decoding an IEX file stream.
@@ -50,23 +69,153 @@ class IEXDecoder {
   IEXDecoder() = default;
 
   virtual ~IEXDecoder() {
-    if (reader_ptr_) {
-      reader_ptr_->close();
+    if (source_ptr_) {
+      source_ptr_->Close();
     };
   }
 
   /// \brief Open a file for decoding.
   ///
   /// \param filename A string to the relative or full path of the file.
+  /// \param backend  How to read the file. If the memory mapped reader cannot handle the file
+  ///                 (e.g. pcapng), the PcapPlusPlus reader is used instead. gzip and zstd
+  ///                 compressed files are detected and streamed regardless of the backend.
   /// \return True if succeeds, false otherwise.
-  bool OpenFileForDecoding(const std::string& filename) WARN_UNUSED;
+  bool OpenFileForDecoding(const std::string& filename,
+                           ReaderBackend backend = ReaderBackend::PcapPlusPlus) WARN_UNUSED;
+
+  /// \brief Only decode messages matching a subscription from now on.
+  ///
+  /// Blocks are checked on their raw type byte and symbol field and skipped before anything is
+  /// constructed or decoded. This applies to GetNextMessage, DecodeBatch and ForEachMessage.
+  ///
+  /// \param subscription  The filter. A default constructed Subscription removes all filtering.
+  void SetSubscription(const Subscription& subscription) { subscription_ = subscription; }
+
+  /// \brief Decode from an already open packet source, e.g. a live UdpPacketSource.
+  ///
+  /// Unlike a capture file, a source is not expected to start with a header only packet, so
+  /// GetFirstHeader stays empty. Seeking is not available.
+  ///
+  /// \param source_ptr  The source, owned by the decoder from now on.
+  /// \return True if succeeds, false otherwise.
+  bool OpenSourceForDecoding(std::unique_ptr<PacketSource> source_ptr) WARN_UNUSED;
+
+  /// \brief Only deliver segments sent within [start, end).
+  ///
+  /// The window is checked against the send_time of each IEX-TP header, so segments before it are
+  /// dropped without looking at their blocks, and the stream ends at the first segment past it.
+  /// Message timestamps can be slightly earlier than the send time of their segment.
+  ///
+  /// \param start  Nanoseconds since POSIX (Epoch) time UTC, inclusive.
+  /// \param end    Nanoseconds since POSIX (Epoch) time UTC, exclusive.
+  void SetTimeWindow(int64_t start, int64_t end);
+
+  /// \brief Only deliver the regular market session.
+  ///
+  /// Segments are skipped until the one carrying the StartOfRegularMarketHours system event,
+  /// delivery starts at that event and the stream ends after the EndOfRegularMarketHours event.
+  /// Only the type and event bytes of blocks are read while looking for the start.
+  void SetRegularHoursOnly(bool regular_hours_only);
 
   /// \brief Get the next message from the stream.
+  /// \note  This allocates a new message on the heap for every call. Prefer ForEachMessage when
+  ///        decoding large files.
   ///
   /// \param msg_ptr  Output parameter, containing the message if successfully decoded.
   /// \return ReturnCode enum describing success or a specific error code.
   ReturnCode GetNextMessage(std::unique_ptr<IEXMessageBase>& msg_ptr);
 
+  /// \brief Get the next message from the stream, decoding it in place into a variant.
+  ///
+  /// \param msg  Output parameter, containing the message if successfully decoded.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode GetNextMessage(IEXMessage& msg);
+
+  /// \brief Get the wire data of the next message matching the subscription, without decoding it.
+  ///
+  /// \param msg_data_ptr  Output parameter, pointing to the message type byte. Valid until the
+  ///                      next call.
+  /// \param msg_len       Output parameter, the length of the message data.
+  /// \param sq_num        Output parameter, the sequence number of the message in the stream.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode GetNextRawMessage(const uint8_t*& msg_data_ptr, size_t& msg_len, int64_t& sq_num);
+
+  /// \brief Move to the next IEX-TP segment carrying messages, skipping heartbeats.
+  /// \note  Blocks of the current segment that were not decoded yet are dropped.
+  ///
+  /// \return ReturnCode enum describing success or a specific error code. On success the header
+  ///         of the new segment is available from GetLastDecodedHeader.
+  ReturnCode GetNextSegment() WARN_UNUSED;
+
+  /// \brief Decode the remaining blocks of the current segment into a caller-owned array.
+  ///
+  /// If no segment is open, the next one is opened first. A batch never spans two segments: all
+  /// messages of one call share the header returned by GetLastDecodedHeader. If the array is
+  /// smaller than the segment, the next call continues where this one stopped.
+  ///
+  /// \param msgs      Caller-owned array of at least capacity messages, reused across calls.
+  /// \param capacity  Maximum number of messages to decode, at least 1.
+  /// \param count     Output parameter, the number of messages decoded into msgs.
+  /// \return ReturnCode enum describing success or a specific error code. With a subscription set
+  ///         count may be 0 for a segment without matching messages. If a block fails to
+  ///         decode, count holds the messages decoded before it and the next call resumes after it.
+  ///         A block running past the end of its segment is FailedParsingPacket, count holds the
+  ///         messages before it and the rest of the segment is dropped. A capacity of 0 is
+  ///         InvalidArgument.
+  ReturnCode DecodeBatch(IEXMessage* msgs, size_t capacity, size_t& count);
+
+  /// \brief Decode all remaining messages of the stream, passing each one to a handler.
+  ///
+  /// Every block is decoded into a stack-resident struct of its concrete type and passed to the
+  /// handler overload taking that type, e.g. handler(const PriceLevelUpdateMessage&). The overload
+  /// is selected at compile time, there is no heap allocation or virtual dispatch per message.
+  /// Message types the handler cannot be called with are skipped without being decoded.
+  /// If the handler returns bool, returning false stops the iteration.
+  ///
+  /// \param handler  A callable, typically a struct with one operator() per message type.
+  /// \return EndOfStream when the stream is exhausted, Success if the handler stopped the
+  ///         iteration, otherwise an error code.
+  template <typename Handler>
+  ReturnCode ForEachMessage(Handler&& handler);
+
+  /// \brief Continue decoding at the first segment sent at or after send_time.
+  ///
+  /// Requires the memory mapped backend. On first use the sidecar index of the file is loaded, or
+  /// built with one scan of the file and saved next to it for later opens.
+  ///
+  /// \param send_time  Nanoseconds since POSIX (Epoch) time UTC, compared to the segment send time.
+  /// \return Success if positioned, EndOfStream if no such segment exists, otherwise an error.
+  ReturnCode SeekToTime(int64_t send_time) WARN_UNUSED;
+
+  /// \brief Continue decoding at the message with sequence number sq_num.
+  ///
+  /// Same requirements as SeekToTime. If sq_num falls in a gap of the capture, decoding continues
+  /// at the next message present.
+  ///
+  /// \param sq_num  Sequence number of the next message to decode.
+  /// \return Success if positioned, EndOfStream if no such message exists, otherwise an error.
+  ReturnCode SeekToSequence(int64_t sq_num) WARN_UNUSED;
+
+  /// \brief Get the current read position, e.g. to checkpoint it alongside the books built so far.
+  ///
+  /// Requires the memory mapped backend. The position is exact to the block, so a decoder resumed
+  /// from it continues with the message that would have been decoded next.
+  ///
+  /// \param position  Output parameter, the position of the next message.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode GetPosition(DecoderPosition& position) const WARN_UNUSED;
+
+  /// \brief Continue decoding at a position returned by GetPosition on the same file.
+  ///
+  /// The subscription, time window and regular hours mode are not part of the position and need
+  /// to be set as they were before the position was taken.
+  ///
+  /// \param position  A position previously returned by GetPosition.
+  /// \return Success if positioned, FailedParsingPacket if the position does not match the file,
+  ///         otherwise an error.
+  ReturnCode RestorePosition(const DecoderPosition& position) WARN_UNUSED;
+
   /// \brief Get the first header from the current packet.
   ///
   /// \return A struct populated with the header information.
@@ -78,10 +227,64 @@ class IEXDecoder {
   inline const IEXTPHeader& GetLastDecodedHeader() { return last_decoded_header_; }
 
  private:
+  /// \brief Drop the current source and all per stream state.
+  void ResetStream();
+
   /// \brief Get the last decoded header from the current packet.
   ///
   /// \return A struct populated with the header information.
   ReturnCode ParseNextPacket(IEXTPHeader& header) WARN_UNUSED;
+
+  /// \brief Advance to the next block of the stream, parsing the next packet when needed.
+  ///
+  /// \param msg_data_ptr  Output parameter, pointing to the start of the message data.
+  /// \param msg_len       Output parameter, the length of the message data.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode AdvanceBlock(const uint8_t*& msg_data_ptr, size_t& msg_len) WARN_UNUSED;
+
+  /// \brief Advance to the next block matching the subscription.
+  ///
+  /// \param msg_data_ptr  Output parameter, pointing to the start of the message data.
+  /// \param msg_len       Output parameter, the length of the message data.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode GetNextBlock(const uint8_t*& msg_data_ptr, size_t& msg_len) WARN_UNUSED;
+
+  /// \brief Position the current segment at its StartOfRegularMarketHours event, if it has one.
+  ///
+  /// \return True if the event was found.
+  bool SkipToStartOfRegularHours();
+
+  /// \brief True for the EndOfRegularMarketHours event when only regular hours are delivered.
+  inline bool IsEndOfRegularHours(const uint8_t* msg_data_ptr) const {
+    return regular_hours_only_ &&
+           msg_data_ptr[0] == static_cast<uint8_t>(MessageType::SystemEvent) &&
+           msg_data_ptr[1] ==
+               static_cast<uint8_t>(SystemEventMessage::Code::EndOfRegularMarketHours);
+  }
+
+  /// \brief Load or build the packet index of the open file.
+  ///
+  /// \param mmap_source  Output parameter, the source of the open file.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode PrepareIndex(MmapPcapSource*& mmap_source) WARN_UNUSED;
+
+  /// \brief Scan forward from offset and position the source at the first segment accepted by
+  ///        is_target.
+  template <typename Predicate>
+  ReturnCode SeekToSegment(MmapPcapSource& mmap_source, uint64_t offset, Predicate is_target);
+
+  /// \brief Decode the message at msg_data_ptr as type T and pass it to the handler.
+  ///
+  /// \param keep_going  Output parameter, set to false if the handler asked to stop.
+  template <typename T, typename Handler, typename... Args>
+  static ReturnCode DecodeAndInvoke(const uint8_t* msg_data_ptr, Handler& handler,
+                                    bool& keep_going, Args... args);
+
+  /// \brief Select the message struct from the type byte and call DecodeAndInvoke.
+  template <typename Handler>
+  static ReturnCode DispatchMessage(const uint8_t* msg_data_ptr, Handler& handler,
+                                    bool& keep_going);
+
   inline uint16_t GetBlockSize(const uint8_t* data_ptr) {
     return *(reinterpret_cast<const uint16_t*>(data_ptr));
   }
@@ -98,19 +301,132 @@ class IEXDecoder {
   /// \brief Contains the last header decoded of the current packet.
   IEXTPHeader last_decoded_header_;
 
-  /// \brief A pointer of the pcap file reader object.
-  std::unique_ptr<pcpp::IFileReaderDevice> reader_ptr_;
+  /// \brief Filter applied to every block before decoding.
+  Subscription subscription_;
+
+  /// \brief Segments sent before this time are skipped.
+  int64_t window_start_ = std::numeric_limits<int64_t>::min();
+
+  /// \brief Segments sent at or after this time end the stream.
+  int64_t window_end_ = std::numeric_limits<int64_t>::max();
+
+  /// \brief Deliver only the regular market session.
+  bool regular_hours_only_ = false;
+
+  /// \brief The StartOfRegularMarketHours event has been seen.
+  bool in_regular_hours_ = false;
 
-  /// \brief The pcpp::Packet needs to stay in context, otherwise the packet memory is deallocated.
-  pcpp::Packet parsed_packet_;
+  /// \brief The end of the time window or of regular hours has been reached.
+  bool past_window_ = false;
+
+  /// \brief Path of the open file, used to locate its sidecar index.
+  std::string filename_;
+
+  /// \brief Sparse index of the open file, loaded on the first seek.
+  PacketIndex index_;
+
+  /// \brief The source delivering the UDP payloads of the open file.
+  std::unique_ptr<PacketSource> source_ptr_;
 
   /// \brief A pointer to the start of the current packet. If this is null then there is no packet
   ///        currently being decoded.
-  const uint8_t* packet_ptr_;
+  const uint8_t* packet_ptr_ = nullptr;
 
   /// \brief An offset used to move the message pointer forward through the data.
   size_t block_offset_ = first_block_start;
 
+  /// \brief Number of blocks of the current packet consumed so far.
+  size_t block_index_ = 0;
+
   /// \brief Length of the currently open packet.
   size_t packet_len_ = 0;
 };
+
+template <typename T, typename Handler, typename... Args>
+ReturnCode IEXDecoder::DecodeAndInvoke(const uint8_t* msg_data_ptr, Handler& handler,
+                                       bool& keep_going, Args... args) {
+  if constexpr (std::is_invocable_v<Handler&, const T&>) {
+    T msg(args...);
+    if (!msg.Decode(msg_data_ptr)) {
+      return ReturnCode::FailedDecodingPacket;
+    }
+    if constexpr (std::is_same_v<std::invoke_result_t<Handler&, const T&>, bool>) {
+      keep_going = handler(static_cast<const T&>(msg));
+    } else {
+      handler(static_cast<const T&>(msg));
+    }
+  }
+  return ReturnCode::Success;
+}
+
+template <typename Decode>
+ReturnCode DispatchMessageType(const uint8_t* msg_data_ptr, Decode&& decode) {
+  const auto msg_enum = static_cast<MessageType>(*msg_data_ptr);
+  switch (msg_enum) {
+    case MessageType::QuoteUpdate:
+      return decode(MessageTag<QuoteUpdateMessage>());
+    case MessageType::TradingStatus:
+      return decode(MessageTag<TradingStatusMessage>());
+    case MessageType::SystemEvent:
+      return decode(MessageTag<SystemEventMessage>());
+    case MessageType::SecurityDirectory:
+      return decode(MessageTag<SecurityDirectoryMessage>());
+    case MessageType::OperationalHaltStatus:
+      return decode(MessageTag<OperationalHaltStatusMessage>());
+    case MessageType::ShortSalePriceTestStatus:
+      return decode(MessageTag<ShortSalePriceTestStatusMessage>());
+    case MessageType::TradeReport:
+    case MessageType::TradeBreak:
+      return decode(MessageTag<TradeReportMessage>(), msg_enum);
+    case MessageType::OfficialPrice:
+      return decode(MessageTag<OfficialPriceMessage>());
+    case MessageType::AuctionInformation:
+      return decode(MessageTag<AuctionInformationMessage>());
+    case MessageType::PriceLevelUpdateBuy:
+    case MessageType::PriceLevelUpdateSell:
+      return decode(MessageTag<PriceLevelUpdateMessage>(), msg_enum);
+    case MessageType::SecurityEvent:
+      return decode(MessageTag<SecurityEventMessage>(), msg_enum);
+    case MessageType::RetailLiquidityIndicator:
+      return decode(MessageTag<RetailLiquidityIndicatorMessage>());
+    case MessageType::AddOrder:
+      return decode(MessageTag<AddOrderMessage>());
+    case MessageType::OrderModify:
+      return decode(MessageTag<OrderModifyMessage>());
+    case MessageType::OrderDelete:
+      return decode(MessageTag<OrderDeleteMessage>());
+    case MessageType::OrderExecuted:
+      return decode(MessageTag<OrderExecutedMessage>());
+    case MessageType::ClearBook:
+      return decode(MessageTag<ClearBookMessage>());
+    default:
+      IEX_LOG("Unknown message type " << PRINTHEX(*msg_data_ptr));
+      return ReturnCode::UnknownMessageType;
+  }
+}
+
+template <typename Handler>
+ReturnCode IEXDecoder::DispatchMessage(const uint8_t* msg_data_ptr, Handler& handler,
+                                       bool& keep_going) {
+  return DispatchMessageType(msg_data_ptr, [&](auto tag, auto... args) {
+    using T = typename decltype(tag)::type;
+    return DecodeAndInvoke<T>(msg_data_ptr, handler, keep_going, args...);
+  });
+}
+
+template <typename Handler>
+ReturnCode IEXDecoder::ForEachMessage(Handler&& handler) {
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  bool keep_going = true;
+  while (keep_going) {
+    auto ret_code = GetNextBlock(msg_data_ptr, msg_len);
+    if (ret_code == ReturnCode::Success) {
+      ret_code = DispatchMessage(msg_data_ptr, handler, keep_going);
+    }
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+  }
+  return ReturnCode::Success;
+}
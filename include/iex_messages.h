@@ -4,8 +4,11 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <variant>
 #include <sale_condition.h>
 #include <order.h>
+#include <price.h>
+#include <symbol.h>
 
 // Note: All information for this implementation was taken from the IEX TOPS specification v1.6
 //       For further information visit:
@@ -14,6 +17,32 @@
 // This is simply a convenience function for cout, nothing more.
 #define IEX_LOG(msg) std::cout << msg << std::endl;
 
+// Diagnostic output on the book hot paths, compiled out entirely below IEX_LOG_LEVEL. Release
+// builds (NDEBUG) default to no output at all, books report through a BookListener instead.
+#define IEX_LOG_LEVEL_NONE 0
+#define IEX_LOG_LEVEL_ERROR 1
+#define IEX_LOG_LEVEL_DEBUG 2
+
+#ifndef IEX_LOG_LEVEL
+#ifdef NDEBUG
+#define IEX_LOG_LEVEL IEX_LOG_LEVEL_NONE
+#else
+#define IEX_LOG_LEVEL IEX_LOG_LEVEL_ERROR
+#endif
+#endif
+
+#if IEX_LOG_LEVEL >= IEX_LOG_LEVEL_ERROR
+#define IEX_ERROR(msg) (std::cerr << msg << std::endl)
+#else
+#define IEX_ERROR(msg) ((void)0)
+#endif
+
+#if IEX_LOG_LEVEL >= IEX_LOG_LEVEL_DEBUG
+#define IEX_DEBUG(msg) (std::cout << msg << std::endl)
+#else
+#define IEX_DEBUG(msg) ((void)0)
+#endif
+
 // This should be used on all functions that return something, so make it easier to use/read.
 #define WARN_UNUSED __attribute__((warn_unused_result))
 
@@ -131,7 +160,9 @@ class IEXMessageBase {
 
   /// \brief Print contents of message to standard output.
   virtual void Print() const = 0;
-  virtual std::string GetSymbol() const { return ""; }
+
+  /// \brief Security identifier, empty for messages that do not refer to a security.
+  virtual Symbol GetSymbol() const { return Symbol(); }
 
   /// \brief Return message type.
   MessageType GetMessageType() const { return message_type; }
@@ -218,60 +249,72 @@ struct RetailLiquidityIndicatorMessage : public IEXMessageBase {
 
   /// \brief Print contents of message to standard output.
   virtual void Print() const override;
-  std::string symbol;
+
+  /// \brief Retail liquidity indicator.
+  RetailLiquidityInd retail_liquidity_indicator;
+
+  /// \brief Security Identifier.
+  Symbol symbol;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct AddOrderMessage : public IEXMessageBase {
- 
+    AddOrderMessage() { message_type = MessageType::AddOrder; }
+
     virtual bool Decode(const uint8_t* data_ptr) override WARN_UNUSED;
 
     /// \brief Print contents of message to standard output.
     virtual void Print() const override;
-    uint8_t order_id;
-    uint8_t size;
+    uint64_t order_id;
+    uint32_t size;
     Side side;
-    double price;
-    std::string symbol;
-    virtual std::string GetSymbol() const override { return symbol; }
+    Price price;
+    Symbol symbol;
+    virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct OrderModifyMessage : public IEXMessageBase {
-    
+    OrderModifyMessage() { message_type = MessageType::OrderModify; }
+
     virtual bool Decode(const uint8_t* data_ptr) override WARN_UNUSED;
 
     /// \brief Print contents of message to standard output.
     virtual void Print() const override;
-    uint8_t order_id_ref;
-    uint8_t size;
-    double price;
+    uint64_t order_id_ref;
+    uint32_t size;
+    Price price;
     ModifyFlags flags;
-    std::string symbol;
-    virtual std::string GetSymbol() const override { return symbol; }
+    Symbol symbol;
+    virtual Symbol GetSymbol() const override { return symbol; }
 };
 
-struct OrderDeleteMessage : public IEXMessageBase { 
+struct OrderDeleteMessage : public IEXMessageBase {
+    OrderDeleteMessage() { message_type = MessageType::OrderDelete; }
+
     virtual bool Decode(const uint8_t* data_ptr) override WARN_UNUSED;
 
     /// \brief Print contents of message to standard output.
     virtual void Print() const override;
-    uint8_t reserved1;          
-    std::string symbol;             
-    uint8_t order_id_ref;           
-    virtual std::string GetSymbol() const override { return symbol; } 
+    uint8_t reserved1;
+    Symbol symbol;
+    uint64_t order_id_ref;
+    virtual Symbol GetSymbol() const override { return symbol; } 
 };
 
 struct OrderExecutedMessage : public IEXMessageBase {
+    OrderExecutedMessage() { message_type = MessageType::OrderExecuted; }
+
     virtual bool Decode(const uint8_t* data_ptr) override WARN_UNUSED;
 
     /// \brief Print contents of message to standard output.
     virtual void Print() const override;
     SaleCondition sale_condition;
-    uint8_t order_id_ref;
-    uint8_t size;
-    double price;
-    uint8_t trade_id;
-    std::string symbol;
-    virtual std::string GetSymbol() const override { return symbol; } 
+    uint64_t order_id_ref;
+    uint32_t size;
+    Price price;
+    uint64_t trade_id;
+    Symbol symbol;
+    virtual Symbol GetSymbol() const override { return symbol; } 
 };
 
 
@@ -283,10 +326,10 @@ struct TradeMessage : public IEXMessageBase {
   
     SaleCondition sale_condition;
     uint8_t size;
-    double price;
+    Price price;
     uint8_t trade_id;
-    std::string symbol;
-    virtual std::string GetSymbol() const override { return symbol; } 
+    Symbol symbol;
+    virtual Symbol GetSymbol() const override { return symbol; } 
 };
 
 struct TradeBreakMessage : public IEXMessageBase {
@@ -296,16 +339,20 @@ struct TradeBreakMessage : public IEXMessageBase {
     virtual void Print() const override;
     SaleCondition sale_condition;
     uint8_t size;
-    double price;
+    Price price;
     uint8_t trade_id;
 };
 
 struct ClearBookMessage : public IEXMessageBase {
+    ClearBookMessage() { message_type = MessageType::ClearBook; }
+
     virtual bool Decode(const uint8_t* data_ptr) override WARN_UNUSED;
 
     /// \brief Print contents of message to standard output.
     virtual void Print() const override;
-    uint8_t reserved1;          
+    uint8_t reserved1;
+    Symbol symbol;
+    virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 
@@ -327,17 +374,17 @@ struct SecurityDirectoryMessage : public IEXMessageBase {
   uint8_t flags;
 
   /// \brief Security identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Integer Number of shares that represent a round lot.
   int round_lot_size;
 
   /// \brief Corporate action adjusted previous official closing price
-  double adjusted_POC_price;
+  Price adjusted_POC_price;
 
   /// \brief Indicates which Limit Up-Limit Down price band calculation parameter is to be used.
   LULDTier LULD_tier;
-  virtual std::string GetSymbol() const override { return symbol; }
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct TradingStatusMessage : public IEXMessageBase {
@@ -363,11 +410,11 @@ struct TradingStatusMessage : public IEXMessageBase {
   Status trading_status;
 
   /// \brief Security identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Reason for the trading status change
   std::string reason;
-  virtual std::string GetSymbol() const override { return symbol; }
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct OperationalHaltStatusMessage : public IEXMessageBase {
@@ -391,8 +438,8 @@ struct OperationalHaltStatusMessage : public IEXMessageBase {
   Status operational_halt_status;
 
   /// \brief Security Identifier.
-  std::string symbol;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Symbol symbol;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct ShortSalePriceTestStatusMessage : public IEXMessageBase {
@@ -418,11 +465,11 @@ struct ShortSalePriceTestStatusMessage : public IEXMessageBase {
   bool short_sale_test_in_effect;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Detail code.
   Detail detail;
-  virtual std::string GetSymbol() const override { return symbol; }
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct QuoteUpdateMessage : public IEXMessageBase {
@@ -441,20 +488,20 @@ struct QuoteUpdateMessage : public IEXMessageBase {
   uint8_t flags;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Aggregate quoted best bid size.
   int bid_size;
 
   /// \brief Price Best quoted bid price.
-  double bid_price;
+  Price bid_price;
 
   /// \brief Integer Aggregate quoted best ask size.
   int ask_size;
 
   /// \brief Price Best quoted ask price.
-  double ask_price;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Price ask_price;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct TradeReportMessage : public IEXMessageBase {
@@ -475,17 +522,17 @@ struct TradeReportMessage : public IEXMessageBase {
   uint8_t flags;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Trade volume.
   int size;
 
   /// \brief Trade price.
-  double price;
+  Price price;
 
   /// \brief IEX Generated Identifier. Trade ID is also referenced in the Trade Break Message.
   int trade_id;
-  virtual std::string GetSymbol() const override { return symbol; }
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct OfficialPriceMessage : public IEXMessageBase {
@@ -509,11 +556,11 @@ struct OfficialPriceMessage : public IEXMessageBase {
   PriceType price_type;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Official opening or closing price, as specified.
-  double price;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Price price;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct AuctionInformationMessage : public IEXMessageBase {
@@ -546,16 +593,16 @@ struct AuctionInformationMessage : public IEXMessageBase {
   AuctionType auction_type;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Number of shares paired at the Reference Price using orders on the Auction Book.
   int paired_shares;
 
   /// \brief Clearing price at or within the Reference Price range using orders on the Auction Book.
-  double reference_price;
+  Price reference_price;
 
   /// \brief Price Clearing price using Eligible Auction Orders.
-  double indicative_clearing_price;
+  Price indicative_clearing_price;
 
   /// \brief Number of unpaired shares at the Reference Price using orders on the Auction Book.
   int imbalance_shares;
@@ -570,23 +617,23 @@ struct AuctionInformationMessage : public IEXMessageBase {
   int scheduled_auction_time;
 
   /// \brief Clearing price using orders on the Auction Book.
-  double auction_book_clearing_price;
+  Price auction_book_clearing_price;
 
   /// \brief Reference price used for the auction collar, if any.
-  double collar_reference_price;
+  Price collar_reference_price;
 
   /// \brief Lower threshold price of the auction collar, if any.
-  double lower_auction_collar;
+  Price lower_auction_collar;
 
   /// \brief Upper threshold price of the auction collar, if any.
-  double upper_auction_collar;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Price upper_auction_collar;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
 struct PriceLevelUpdateMessage : public IEXMessageBase {
   PriceLevelUpdateMessage(const MessageType& msg_type) { message_type = msg_type; }
-  PriceLevelUpdateMessage(const MessageType& msg_type, const std::string& symbol, double price, int size, uint8_t flags)
-        : symbol(symbol), price(price), size(size), flags(flags) {
+  PriceLevelUpdateMessage(const MessageType& msg_type, const Symbol& symbol, Price price, int size, uint8_t flags)
+        : flags(flags), symbol(symbol), size(size), price(price) {
         message_type = msg_type;
     }
 
@@ -603,14 +650,14 @@ struct PriceLevelUpdateMessage : public IEXMessageBase {
   uint8_t flags;
 
   /// \brief Security Identifier.
-  std::string symbol;
+  Symbol symbol;
 
   /// \brief Aggregate quoted size.
   int size;
 
   /// \brief Price level to add/update in the IEX Order Book.
-  double price;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Price price;
+  virtual Symbol GetSymbol() const override { return symbol; }
 
 };
 
@@ -635,10 +682,42 @@ struct SecurityEventMessage : public IEXMessageBase {
   SecurityMessageType security_event;
 
   /// \brief Security Identifier.
-  std::string symbol;
-  virtual std::string GetSymbol() const override { return symbol; }
+  Symbol symbol;
+  virtual Symbol GetSymbol() const override { return symbol; }
 };
 
-
 std::unique_ptr<IEXMessageBase> IEXMessageFactory(const uint8_t* msg_data_ptr);
 
+/// \brief Value type holding any decoded message, without a heap allocation per message.
+/// \note  The first alternative must stay default constructible.
+using IEXMessage = std::variant<SystemEventMessage,
+                                SecurityDirectoryMessage,
+                                TradingStatusMessage,
+                                OperationalHaltStatusMessage,
+                                ShortSalePriceTestStatusMessage,
+                                RetailLiquidityIndicatorMessage,
+                                QuoteUpdateMessage,
+                                TradeReportMessage,
+                                OfficialPriceMessage,
+                                AuctionInformationMessage,
+                                PriceLevelUpdateMessage,
+                                SecurityEventMessage,
+                                AddOrderMessage,
+                                OrderModifyMessage,
+                                OrderDeleteMessage,
+                                OrderExecutedMessage,
+                                ClearBookMessage>;
+
+/// \brief Access the fields common to all messages, e.g. timestamp and message type.
+inline const IEXMessageBase& GetMessageBase(const IEXMessage& msg) {
+  return std::visit([](const auto& m) -> const IEXMessageBase& { return m; }, msg);
+}
+
+/// \brief Helper to build a std::visit visitor out of several lambdas.
+template <class... Ts>
+struct Overloaded : Ts... {
+  using Ts::operator()...;
+};
+template <class... Ts>
+Overloaded(Ts...) -> Overloaded<Ts...>;
+
@@ -11,21 +11,23 @@
 #include "iex_messages.h" // Include the necessary headers for message types
 #include "order.h"
 
+class BookListener;
+
 class L3OrderBook {
 public:
     // Default constructor
     L3OrderBook()
-        : min_price(0.0), max_price(0.0), price_increment(0.0) {
+        : min_price(), max_price(), price_increment() {
         // Initialize price_levels to an empty state; no price levels set
         price_levels.clear();
     }
 
     // Parameterized constructor
-    L3OrderBook(size_t numPriceLevels, double minPrice, double maxPrice, double priceIncrement)
+    L3OrderBook(size_t numPriceLevels, Price minPrice, Price maxPrice, Price priceIncrement)
         : min_price(minPrice), max_price(maxPrice), price_increment(priceIncrement) {
         
         // Ensure that the price increment is valid (non-zero)
-        if (priceIncrement <= 0) {
+        if (priceIncrement.GetTicks() <= 0) {
             throw std::invalid_argument("Price increment must be greater than zero.");
         }
 
@@ -34,7 +36,7 @@ public:
 
         // Populate the price levels
         for (size_t i = 0; i < numPriceLevels; ++i) {
-            double price = min_price + i * price_increment;
+            Price price = min_price + price_increment * i;
             // Check if the price exceeds the maximum price
             if (price > max_price) {
                 break; // No more valid price levels
@@ -46,14 +48,28 @@ public:
 
     // Public interface to process incoming messages
     void ProcessMessage(const IEXMessageBase& message);
+    // Same as above for messages held by value, dispatched with std::visit instead of dynamic_cast
+    void ProcessMessage(const IEXMessage& message);
     void PrintOrderBook() const;
 
+    // Report order and trade events to listener, which must outlive the book. nullptr to stop.
+    void SetListener(BookListener* new_listener) { listener = new_listener; }
+
+    // Approximate heap bytes held by the book, excluding sizeof(*this)
+    size_t GetMemoryUsage() const;
+
+    // Write the orders, price levels and level grid to a binary stream
+    void SaveSnapshot(std::ostream& out) const;
+    // Replace the book state with one written by SaveSnapshot, returns false on a malformed stream
+    bool LoadSnapshot(std::istream& in);
+
 private:
-    std::unordered_map<uint8_t, Order> orders; // Map to store orders by order_id
+    std::unordered_map<uint64_t, Order> orders; // Map to store orders by order_id
     std::vector<std::vector<Order>> price_levels; // Fixed price levels
-    double min_price;
-    double max_price;
-    double price_increment;
+    Price min_price;
+    Price max_price;
+    Price price_increment;
+    BookListener* listener = nullptr; // Not owned, may be null
 
     // Private helper functions for processing different message types
     void AddOrder(const AddOrderMessage& message);
@@ -61,5 +77,5 @@ private:
     void DeleteOrder(const OrderDeleteMessage& message);
     void ExecuteOrder(const OrderExecutedMessage& message);
     void HandleTrade(const TradeReportMessage& message);
-    size_t GetPriceLevelIndex(double price) const;
+    size_t GetPriceLevelIndex(Price price) const;
 };
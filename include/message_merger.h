@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "packet_source.h"
+
+/// \class MessageMerger
+/// \brief Interleaves the messages of several decoders in timestamp order, e.g. the TOPS and DEEP
+///        captures of one day.
+///
+/// Every feed is already in timestamp order, so a k-way merge over the next message of each feed
+/// is enough: no feed is read ahead by more than one batch, and memory use is bounded by the number
+/// of inputs times the batch size, whatever the size of the files.
+class MessageMerger {
+ public:
+  /// \param batch_size  Number of messages decoded ahead per input.
+  explicit MessageMerger(size_t batch_size = 256);
+
+  /// \brief Add an input. The decoder must outlive the merger, its subscription and time window
+  ///        are honoured. Messages with equal timestamps are returned in the order inputs were
+  ///        added.
+  ///
+  /// \return Index of the input, as reported by GetNextMessage.
+  size_t AddDecoder(IEXDecoder& decoder);
+
+  /// \brief Get the message with the lowest timestamp across all inputs.
+  ///
+  /// \param msg     Output parameter, pointing to the message. Valid until the next call.
+  /// \param source  Output parameter, index of the input the message came from.
+  /// \return Success, EndOfStream once every input is exhausted, otherwise the error of an input,
+  ///         after delivering its messages decoded before the error. The next call continues.
+  ReturnCode GetNextMessage(const IEXMessage*& msg, size_t& source);
+
+ private:
+  struct Input {
+    IEXDecoder* decoder;
+    std::vector<IEXMessage> messages;
+    size_t count = 0;
+    size_t pos = 0;
+
+    /// \brief Return code of the batch in messages, reported once the batch is delivered.
+    ReturnCode ret_code = ReturnCode::Success;
+  };
+
+  /// \brief Decode the next batch of an input.
+  ///
+  /// \return Success if messages are available, otherwise the code ending the input or an error.
+  ReturnCode Refill(Input& input);
+
+  /// \brief Add an input with a message available to the heap.
+  void Push(size_t index);
+
+  size_t batch_size_;
+  std::vector<Input> inputs_;
+
+  /// \brief Min heap of (timestamp of the next message, input index).
+  std::vector<std::pair<uint64_t, size_t>> heap_;
+
+  /// \brief Inputs without buffered messages that have not ended yet.
+  std::vector<size_t> refill_;
+
+  /// \brief Input of the message returned last, advanced on the next call.
+  size_t pending_;
+};
@@ -1,11 +1,14 @@
 #pragma once
+#include <cstdint>
+#include "price.h"
+
 enum class Side { Buy = 0x38, Sell = 0x35};
 
 enum class ModifyFlags { ResetPriority = 0, MaintainPriority = 1};
 
 struct Order {
-    uint8_t order_id;
-    uint8_t size;
-    double price;
+    uint64_t order_id;
+    uint32_t size;
+    Price price;
     Side side; // Add the side property to track whether it's a buy or sell order
 };
\ No newline at end of file
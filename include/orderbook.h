@@ -5,71 +5,136 @@
 #include <memory>
 #include <string>
 #include <sstream>
+#include "book_listener.h"
 #include "iex_messages.h"
+#include "price_levels.h"
 #include <optional>
 #include <stdexcept>
 #include <vector>
+#include <array>
+#include <cstdint>
 
 struct BBO {
 private:
-    double bid_price;
+    Price bid_price;
     int bid_size;
-    double ask_price;
+    Price ask_price;
     int ask_size;
 
 public:
     // Constructor that enforces the bid <= ask constraint
-    BBO(double bid_price, int bid_size, double ask_price, int ask_size)
+    BBO(Price bid_price, int bid_size, Price ask_price, int ask_size)
         : bid_price(bid_price), bid_size(bid_size), ask_price(ask_price), ask_size(ask_size) {
         if (bid_price > ask_price) {
             throw std::invalid_argument("bid_price cannot be greater than ask_price");
         }
     }
 
-    // Getters
-    double getBidPrice() const { return bid_price; }
+    // Getters, prices in dollars for output
+    double getBidPrice() const { return bid_price.ToDouble(); }
     int getBidSize() const { return bid_size; }
-    double getAskPrice() const { return ask_price; }
+    double getAskPrice() const { return ask_price.ToDouble(); }
     int getAskSize() const { return ask_size; }
 
+    // Getters, exact prices in ticks
+    Price getBidTicks() const { return bid_price; }
+    Price getAskTicks() const { return ask_price; }
+
     // Setters with validation
-    void setBidPrice(double new_bid_price) {
+    void setBidPrice(Price new_bid_price) {
         if (new_bid_price > ask_price) {
             throw std::invalid_argument("bid_price cannot be greater than ask_price");
         }
         bid_price = new_bid_price;
     }
 
-    void setAskPrice(double new_ask_price) {
+    void setAskPrice(Price new_ask_price) {
         if (new_ask_price < bid_price) {
             throw std::invalid_argument("ask_price cannot be less than bid_price");
         }
         ask_price = new_ask_price;
     }
+
+    bool operator==(const BBO& other) const {
+        return bid_price == other.bid_price && bid_size == other.bid_size &&
+               ask_price == other.ask_price && ask_size == other.ask_size;
+    }
+    bool operator!=(const BBO& other) const { return !(*this == other); }
 };
 
 
-// OrderBook class definition
-class OrderBook {
+// Caller owned arrays that GetDepth fills with the top levels of each side, best level first.
+// Prices are in ticks (1/10000 dollar). Each array must hold as many levels as are requested.
+struct DepthArrays {
+    int64_t* bid_prices = nullptr;
+    int* bid_sizes = nullptr;
+    int64_t* ask_prices = nullptr;
+    int* ask_sizes = nullptr;
+    size_t bid_count = 0; // Levels filled per side, fewer than requested on a thin book
+    size_t ask_count = 0;
+};
+
+// OrderBook class definition, Levels is one of the containers in price_levels.h
+template <typename Levels>
+class BasicOrderBook {
+public:
+    // Updates staged per atomic event before they are applied in bulk. Longer events, e.g. sweeps
+    // at the open, apply the staged part to the levels early, the BBO still moves only at the end.
+    static constexpr size_t max_atomic_updates = 64;
+
+    // Levels per side kept contiguous for GetDepth
+    static constexpr size_t max_depth = 10;
+
 private:
-    std::map<double, int> bid_levels; // Price -> Size
-    std::map<double, int> ask_levels; // Price -> Size
-    std::map<std::string, std::vector<PriceLevelUpdateMessage>> atomicUpdates; // Symbol -> Updates
+    // One staged price level update of an atomic event
+    struct AtomicUpdate {
+        Price price;
+        int32_t size;
+        Side side;
+    };
+
+    // The best levels of one side, best first, in the layout GetDepth copies out
+    struct TopLevels {
+        std::array<int64_t, max_depth> prices; // In ticks
+        std::array<int, max_depth> sizes;
+        size_t count = 0; // All levels of the side while below max_depth
+    };
+
+    Levels bid_levels; // Price -> Size
+    Levels ask_levels; // Price -> Size
+    std::array<AtomicUpdate, max_atomic_updates> atomicUpdates; // Reused by every atomic event
+    size_t atomicUpdateCount = 0; // Updates staged for the open atomic event
     std::optional<BBO> current_bbo; // Best Bid and Offer as a class field
+    TopLevels top_bids; // Highest bid levels, kept by UpdateOrderBook
+    TopLevels top_asks; // Lowest ask levels, kept by UpdateOrderBook
+    bool top_of_book_changed = false; // Whether the last event moved the BBO
+    Symbol last_symbol; // Symbol of the last applied update, reported with BBO changes
+    BookListener* listener = nullptr; // Not owned, may be null
 
 public:
     // Constructor and destructor
-    OrderBook() = default;
-    ~OrderBook() = default;
+    BasicOrderBook() = default;
+    // Both sides start as copies of levels, e.g. a ladder with a sub-penny tick size
+    explicit BasicOrderBook(const Levels& levels) : bid_levels(levels), ask_levels(levels) {}
+    ~BasicOrderBook() = default;
 
     // Retrieve the current Best Bid and Offer
     std::optional<BBO> GetBbo() const;
 
+    // Whether the BBO moved with the last processed message, false while an atomic event is open
+    bool TopOfBookChanged() const { return top_of_book_changed; }
+
+    // Report level and BBO changes to listener, which must outlive the book. nullptr to stop.
+    void SetListener(BookListener* new_listener) { listener = new_listener; }
+
     // Process incoming messages
     void ProcessMessage(const IEXMessageBase& message);
 
-    // Update the order book based on the message type
-    void UpdateOrderBook(MessageType type, const std::string& symbol, double price, int size);
+    // Process incoming messages held by value, dispatched with std::visit instead of dynamic_cast
+    void ProcessMessage(const IEXMessage& message);
+
+    // Update the order book based on the message type, keeping the top levels current
+    void UpdateOrderBook(MessageType type, const Symbol& symbol, Price price, int size);
 
     // Print the current state of the order book
     void PrintOrderBook() const;
@@ -77,19 +142,40 @@ public:
     // Print the Best Bid and Offer
     void PrintBbo() const;
     double GetBookPressure() const;
-    // Update the Best Bid and Offer (BBO)
+
+    // Copy the top n levels of each side, at most max_depth, into out. Nothing is allocated, each
+    // array is filled with a single memcpy.
+    void GetDepth(size_t n, DepthArrays& out) const;
+
+    // Publish the best levels as the Best Bid and Offer (BBO), O(1)
     void UpdateBBO();
 
+    // Approximate heap bytes held by the book, excluding sizeof(*this)
+    size_t GetMemoryUsage() const;
+
+    // Write the complete book state, including pending atomic updates, to a binary stream
+    void SaveSnapshot(std::ostream& out) const;
+
+    // Replace the book state with one written by SaveSnapshot, returns false on a malformed stream
+    bool LoadSnapshot(std::istream& in);
+
 private:
-    // Start atomic update by adding the message to the atomic update map
-    void startAtomicUpdate(const PriceLevelUpdateMessage* update);
+    // Apply a single price level update, staging it if it is part of an atomic event
+    void ProcessPriceLevelUpdate(const PriceLevelUpdateMessage& update);
 
-    // End atomic update and apply all updates for the symbol
-    void endAtomicUpdate(const PriceLevelUpdateMessage* update);
+    // Stage an update of an atomic event, without touching the allocator
+    void startAtomicUpdate(const PriceLevelUpdateMessage& update);
 
-    // Apply all atomic updates for a symbol, then update the BBO
-    void applyAtomicUpdates(const std::string& symbol);
+    // End atomic update and apply all staged updates
+    void endAtomicUpdate(const PriceLevelUpdateMessage& update);
+
+    // Apply all staged updates in one pass, without publishing the BBO
+    void applyAtomicUpdates(const Symbol& symbol);
+};
 
+// The map based book handles any price equally, the ladder is faster near the inside
+using OrderBook = BasicOrderBook<MapPriceLevels>;
+using LadderOrderBook = BasicOrderBook<TickLadderPriceLevels>;
 
-    
-};
\ No newline at end of file
+extern template class BasicOrderBook<MapPriceLevels>;
+extern template class BasicOrderBook<TickLadderPriceLevels>;
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "packet_source.h"
+
+/// \class PacketIndex
+/// \brief A sparse index from segment send time and sequence number to pcap file offsets.
+///
+/// Every interval-th packet of a capture is recorded, so a lookup lands at most one interval
+/// before the wanted segment. The index is small enough to be kept next to the capture as a
+/// sidecar file and reloaded on later opens, instead of being rebuilt by scanning the file.
+class PacketIndex {
+ public:
+  /// \brief One indexed packet.
+  struct Entry {
+    /// \brief send_time of the IEX-TP header.
+    int64_t send_time;
+    /// \brief first_msg_sq_num of the IEX-TP header.
+    int64_t first_msg_sq_num;
+    /// \brief File offset of the pcap record header.
+    uint64_t offset;
+  };
+
+  /// \brief Default number of packets between two entries.
+  constexpr static size_t default_interval = 1024;
+
+  /// \brief The path of the sidecar index belonging to a capture file.
+  static std::string GetSidecarPath(const std::string& filename) { return filename + ".idx"; }
+
+  /// \brief Scan a mapped capture and record every interval-th packet.
+  ///
+  /// \param source    An open source. Its read position is not changed.
+  /// \param interval  Number of packets between two entries.
+  /// \return True if succeeds, false otherwise.
+  bool Build(const MmapPcapSource& source, size_t interval = default_interval) WARN_UNUSED;
+
+  /// \brief Write the index to a file, replacing it atomically.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Save(const std::string& path) const WARN_UNUSED;
+
+  /// \brief Read an index written by Save.
+  ///
+  /// \param path       Path of the index file.
+  /// \param file_size  Size of the capture the index must belong to. Stale indexes are rejected.
+  /// \return True if succeeds, false otherwise.
+  bool Load(const std::string& path, uint64_t file_size) WARN_UNUSED;
+
+  /// \brief Offset to start scanning from for the first segment sent at or after send_time.
+  uint64_t FindTime(int64_t send_time) const;
+
+  /// \brief Offset to start scanning from for the segment carrying sequence number sq_num.
+  uint64_t FindSequence(int64_t sq_num) const;
+
+  bool Empty() const { return entries_.empty(); }
+  const std::vector<Entry>& GetEntries() const { return entries_; }
+
+ private:
+  /// \brief Size of the indexed capture, used to detect a stale sidecar.
+  uint64_t file_size_ = 0;
+
+  std::vector<Entry> entries_;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Packet.h"
+#include "PcapFileDevice.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "iex_messages.h"
+
+/// \enum class ReturnCode
+/// \brief An enum for various possible errors when decoding a message.
+enum class ReturnCode {
+  Success,
+  ClassNotInitialized,
+  FailedParsingPacket,
+  FailedDecodingPacket,
+  UnknownMessageType,
+  EndOfStream,
+  WouldBlock,
+  FailedWriting,
+  InvalidArgument
+};
+
+inline std::string ReturnCodeToString(const ReturnCode & code) {
+  switch(code) {
+    case ReturnCode::Success:
+      return "Success";
+    case ReturnCode::ClassNotInitialized:
+      return "Decoder class not initialized.";
+    case ReturnCode::FailedParsingPacket:
+      return "Failed parsing packet.";
+    case ReturnCode::FailedDecodingPacket:
+      return "Failed decoding packet.";
+    case ReturnCode::UnknownMessageType:
+      return "Unknown message type";
+    case ReturnCode::EndOfStream:
+      return "End of file stream.";
+    case ReturnCode::WouldBlock:
+      return "No new data available yet.";
+    case ReturnCode::FailedWriting:
+      return "Failed writing output.";
+    case ReturnCode::InvalidArgument:
+      return "Invalid argument.";
+    default:
+      return "Unknown return code.";
+  }
+}
+
+/// \enum class ReaderBackend
+/// \brief Selects how IEXDecoder reads packets from a capture file.
+enum class ReaderBackend {
+  /// Read through PcapPlusPlus. Supports every format PcapPlusPlus supports (pcap, pcapng, ...).
+  PcapPlusPlus,
+  /// Memory map a classic pcap file and walk the record headers directly, without copying.
+  MemoryMapped
+};
+
+/// \class PacketSource
+/// \brief Interface for anything delivering IEX-TP segments, i.e. the UDP payload of a packet.
+class PacketSource {
+ public:
+  virtual ~PacketSource() = default;
+
+  /// \brief Open a capture file.
+  ///
+  /// \param filename A string to the relative or full path of the file.
+  /// \return True if succeeds, false otherwise.
+  virtual bool Open(const std::string& filename) WARN_UNUSED = 0;
+
+  /// \brief Release the file. Pointers previously handed out become invalid.
+  virtual void Close() = 0;
+
+  /// \brief Get the UDP payload of the next packet.
+  ///
+  /// \param data Output parameter, pointing at the IEX-TP segment. Valid until the next call.
+  /// \param len  Output parameter, the length of the segment in bytes.
+  /// \return ReturnCode enum describing success or a specific error code.
+  virtual ReturnCode GetNextPayload(const uint8_t*& data, size_t& len) WARN_UNUSED = 0;
+};
+
+/// \class PcapPlusPlusSource
+/// \brief Packet source reading through pcpp::IFileReaderDevice and pcpp::Packet layer parsing.
+class PcapPlusPlusSource : public PacketSource {
+ public:
+  ~PcapPlusPlusSource() override { Close(); }
+
+  bool Open(const std::string& filename) override WARN_UNUSED;
+  void Close() override;
+  ReturnCode GetNextPayload(const uint8_t*& data, size_t& len) override WARN_UNUSED;
+
+ private:
+  /// \brief A pointer of the pcap file reader object.
+  std::unique_ptr<pcpp::IFileReaderDevice> reader_ptr_;
+
+  /// \brief The raw packet owns the packet memory, so it needs to outlive the returned payload.
+  pcpp::RawPacket raw_packet_;
+
+  /// \brief The pcpp::Packet needs to stay in context, otherwise the packet memory is deallocated.
+  pcpp::Packet parsed_packet_;
+};
+
+/// \class MmapPcapSource
+/// \brief Zero-copy packet source for classic (non pcapng) capture files.
+///
+/// The whole file is mapped read only. Each call reads one 16 byte record header, skips the
+/// link, IPv4 and UDP headers and returns a pointer straight into the mapping.
+class MmapPcapSource : public PacketSource {
+ public:
+  ~MmapPcapSource() override { Close(); }
+
+  bool Open(const std::string& filename) override WARN_UNUSED;
+  void Close() override;
+  ReturnCode GetNextPayload(const uint8_t*& data, size_t& len) override WARN_UNUSED;
+
+  /// \brief Continue reading at the record header at offset, e.g. one found through a PacketIndex.
+  void Seek(uint64_t offset) { offset_ = offset; }
+
+  /// \brief Offset of the record header read next.
+  uint64_t GetOffset() const { return offset_; }
+
+  /// \brief Offset of the record header of the payload returned last.
+  uint64_t GetLastOffset() const { return last_offset_; }
+
+  /// \brief Size of the mapped file in bytes, or 0 if nothing is mapped.
+  size_t GetFileSize() const { return map_len_; }
+
+  /// \brief Collect the file offset of every record by walking the record headers only.
+  ///
+  /// \param offsets  Output parameter, the offset of each record header in file order.
+  void ScanRecordOffsets(std::vector<uint64_t>& offsets) const;
+
+  /// \brief Get the UDP payload of the record at a given offset. Does not move the read position,
+  ///        so it may be called from several threads at once.
+  ///
+  /// \param offset       Offset of a record header, as returned by ScanRecordOffsets.
+  /// \param data         Output parameter, pointing at the IEX-TP segment.
+  /// \param len          Output parameter, the length of the segment in bytes.
+  /// \param next_offset  Output parameter, the offset of the following record.
+  /// \return ReturnCode enum describing success or a specific error code.
+  ReturnCode GetPayloadAt(uint64_t offset, const uint8_t*& data, size_t& len,
+                          uint64_t& next_offset) const WARN_UNUSED;
+
+ private:
+  /// \brief Start of the mapped file, or null if nothing is mapped.
+  const uint8_t* map_ptr_ = nullptr;
+
+  /// \brief Size of the mapped file in bytes.
+  size_t map_len_ = 0;
+
+  /// \brief Byte offset of the next record header.
+  size_t offset_ = 0;
+
+  /// \brief Byte offset of the record header read by the last GetNextPayload.
+  size_t last_offset_ = 0;
+
+  /// \brief Link layer type from the pcap file header.
+  uint32_t link_type_ = 0;
+
+  /// \brief True if the file was written on a machine with the opposite byte order.
+  bool swapped_ = false;
+};
+
+/// \brief Size of the classic pcap file header.
+constexpr size_t pcap_file_header_len = 24;
+
+/// \brief Size of a classic pcap record header.
+constexpr size_t pcap_record_header_len = 16;
+
+/// \brief Parse a classic pcap file header.
+///
+/// \param data      Pointer to the first byte of the file.
+/// \param len       Number of bytes available.
+/// \param link_type Output parameter, the link layer type of all records.
+/// \param swapped   Output parameter, true if the header fields need byte swapping.
+/// \return True if this is a classic pcap file, false otherwise (e.g. pcapng).
+bool ParsePcapFileHeader(const uint8_t* data, size_t len, uint32_t& link_type, bool& swapped);
+
+/// \brief Parse a classic pcap file header, also returning its snapshot length.
+///
+/// \param snaplen   Output parameter, the largest captured length a record of the file may have.
+bool ParsePcapFileHeader(const uint8_t* data, size_t len, uint32_t& link_type, bool& swapped,
+                         uint32_t& snaplen);
+
+/// \brief Strip link, IPv4 and UDP headers from a captured frame.
+///
+/// \param frame     Pointer to the captured frame.
+/// \param caplen    Captured length of the frame.
+/// \param link_type Link layer type from the pcap file header.
+/// \param data      Output parameter, pointing at the UDP payload.
+/// \param len       Output parameter, the length of the UDP payload.
+/// \return True if the frame is an IPv4 UDP datagram, false otherwise.
+bool GetUdpPayload(const uint8_t* frame, size_t caplen, uint32_t link_type, const uint8_t*& data,
+                   size_t& len);
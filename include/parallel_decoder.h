@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "packet_source.h"
+#include "subscription.h"
+
+/// \class ParallelDecoder
+/// \brief Decodes one classic pcap file on several threads at once.
+///
+/// Opening the file walks the pcap record headers to find every packet boundary. The packets are
+/// then cut into chunks that are decoded concurrently, each into its own message buffer, while the
+/// calling thread hands the messages to a handler in stream sequence order. Only a bounded window
+/// of chunks is in flight at any time, so memory use does not grow with the file.
+class ParallelDecoder {
+ public:
+  /// \param thread_count       Number of chunks decoded concurrently.
+  /// \param packets_per_chunk  Number of packets in each chunk.
+  explicit ParallelDecoder(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()),
+                           size_t packets_per_chunk = 16384);
+
+  /// \brief Map a file and scan its packet boundaries.
+  ///
+  /// \param filename A string to the relative or full path of the file.
+  /// \return True if succeeds, false otherwise (e.g. for pcapng or compressed files).
+  bool OpenFileForDecoding(const std::string& filename) WARN_UNUSED;
+
+  /// \brief Only decode messages matching a subscription, see IEXDecoder::SetSubscription.
+  void SetSubscription(const Subscription& subscription) { subscription_ = subscription; }
+
+  /// \brief Number of packets found by the pre-scan.
+  size_t GetPacketCount() const { return record_offsets_.size(); }
+
+  /// \brief Decode the whole file, passing every message to a handler in sequence order.
+  ///
+  /// Segments are ordered by the first_msg_sq_num of their IEX-TP header, and segments whose
+  /// messages were already delivered (e.g. retransmissions) are skipped. A segment following a
+  /// gap in the sequence numbers is held back until the next chunk is decoded, so a segment
+  /// captured out of order across a chunk boundary is still delivered in order. A gap that the
+  /// next chunk does not fill is passed over. The handler is always called on the calling thread.
+  /// If the handler returns bool, returning false stops decoding: the chunks still in flight are
+  /// cancelled and waited for before this returns.
+  ///
+  /// \param handler  A callable taking const IEXMessage&.
+  /// \return EndOfStream when the file is exhausted, Success if the handler stopped the
+  ///         iteration, otherwise the first error, after delivering the messages before it. A
+  ///         segment overlapping messages already delivered without repeating them exactly is
+  ///         FailedParsingPacket.
+  template <typename Handler>
+  ReturnCode ForEachMessage(Handler&& handler);
+
+ private:
+  /// \brief The messages of one IEX-TP segment within a chunk.
+  struct Segment {
+    int64_t first_msg_sq_num;
+    size_t message_count;
+    size_t begin;
+    size_t end;
+  };
+
+  /// \brief Everything decoded from one chunk of packets.
+  struct Chunk {
+    ReturnCode ret_code = ReturnCode::EndOfStream;
+    std::vector<IEXMessage> messages;
+    std::vector<Segment> segments;
+  };
+
+  /// \brief A segment waiting to be delivered, with the chunk holding its messages.
+  struct PendingSegment {
+    std::shared_ptr<const Chunk> chunk;
+    Segment segment;
+
+    /// \brief Already held back once, so a gap before it is not waited on again.
+    bool carried;
+  };
+
+  /// \brief Decode the packets with index [first, last) of the pre-scan. Runs on a worker thread.
+  ///
+  /// \param cancelled  Checked before every packet, the chunk is abandoned once it is set.
+  Chunk DecodeChunk(size_t first, size_t last, const std::atomic<bool>* cancelled) const;
+
+  /// \brief Start decoding the chunk following the last one started.
+  std::future<Chunk> LaunchChunk(size_t& next_packet, const std::atomic<bool>* cancelled) const;
+
+  size_t thread_count_;
+  size_t packets_per_chunk_;
+
+  /// \brief Filter applied to every block before decoding.
+  Subscription subscription_;
+
+  /// \brief The mapped file. Workers only use its const, position independent accessors.
+  MmapPcapSource source_;
+
+  /// \brief File offset of every pcap record, from the pre-scan.
+  std::vector<uint64_t> record_offsets_;
+};
+
+template <typename Handler>
+ReturnCode ParallelDecoder::ForEachMessage(Handler&& handler) {
+  if (record_offsets_.empty()) {
+    IEX_LOG("The class has not opened a file for reading yet, call OpenFileForDecoding first.");
+    return ReturnCode::ClassNotInitialized;
+  }
+
+  std::atomic<bool> cancelled(false);
+  size_t next_packet = 0;
+  std::deque<std::future<Chunk>> in_flight;
+  while (in_flight.size() < thread_count_ && next_packet < record_offsets_.size()) {
+    in_flight.push_back(LaunchChunk(next_packet, &cancelled));
+  }
+  // The workers still reference cancelled, so they are finished before returning early.
+  auto cancel = [&]() {
+    cancelled = true;
+    for (auto& future : in_flight) {
+      future.wait();
+    }
+  };
+
+  // Segments not delivered yet, from this chunk and held back from earlier ones.
+  std::vector<PendingSegment> pending;
+  // Sequence number of the first message not delivered yet, once anything was delivered.
+  int64_t next_sq_num = 0;
+  bool started = false;
+  while (!in_flight.empty()) {
+    auto chunk = std::make_shared<const Chunk>(in_flight.front().get());
+    in_flight.pop_front();
+    // Keep the workers busy while this chunk is handed out.
+    if (next_packet < record_offsets_.size()) {
+      in_flight.push_back(LaunchChunk(next_packet, &cancelled));
+    }
+    // Nothing can fill a gap after the last chunk.
+    const bool last_chunk = in_flight.empty() || chunk->ret_code != ReturnCode::EndOfStream;
+
+    for (const auto& segment : chunk->segments) {
+      pending.push_back(PendingSegment{chunk, segment, false});
+    }
+    // Within a capture segments are nearly always in order already, this only fixes up the rest.
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const PendingSegment& lhs, const PendingSegment& rhs) {
+                       return lhs.segment.first_msg_sq_num < rhs.segment.first_msg_sq_num;
+                     });
+
+    size_t done = 0;
+    for (; done < pending.size(); ++done) {
+      const Segment& segment = pending[done].segment;
+      const int64_t end_sq_num =
+          segment.first_msg_sq_num + static_cast<int64_t>(segment.message_count);
+      if (started) {
+        // Retransmitted segments repeat the original exactly, so they are skipped whole.
+        if (end_sq_num <= next_sq_num) {
+          continue;
+        }
+        if (segment.first_msg_sq_num < next_sq_num) {
+          IEX_LOG("Segment " << segment.first_msg_sq_num
+                             << " overlaps messages already delivered up to " << next_sq_num);
+          cancel();
+          return ReturnCode::FailedParsingPacket;
+        }
+        if (segment.first_msg_sq_num > next_sq_num && !pending[done].carried && !last_chunk) {
+          break;
+        }
+      }
+      const auto& messages = pending[done].chunk->messages;
+      for (size_t i = segment.begin; i < segment.end; ++i) {
+        if constexpr (std::is_same_v<std::invoke_result_t<Handler&, const IEXMessage&>, bool>) {
+          if (!handler(static_cast<const IEXMessage&>(messages[i]))) {
+            cancel();
+            return ReturnCode::Success;
+          }
+        } else {
+          handler(static_cast<const IEXMessage&>(messages[i]));
+        }
+      }
+      next_sq_num = end_sq_num;
+      started = true;
+    }
+    pending.erase(pending.begin(), pending.begin() + done);
+    for (auto& held : pending) {
+      held.carried = true;
+    }
+
+    if (chunk->ret_code != ReturnCode::EndOfStream) {
+      cancel();
+      return chunk->ret_code;
+    }
+  }
+  return ReturnCode::EndOfStream;
+}
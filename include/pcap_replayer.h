@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <netinet/in.h>
+
+#include "packet_source.h"
+
+/// \class PcapReplayer
+/// \brief Plays the IEX-TP segments of a capture file out over UDP, e.g. to test a live feed
+///        handler on loopback.
+class PcapReplayer {
+ public:
+  ~PcapReplayer() { Close(); }
+
+  /// \brief Open a classic pcap file and a socket sending to a destination.
+  ///
+  /// \param filename     A string to the relative or full path of the capture.
+  /// \param destination  "ip:port" to send to, unicast or multicast. The port is 1..65535.
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& filename, const std::string& destination) WARN_UNUSED;
+
+  void Close();
+
+  /// \brief Send the segments of the capture in file order.
+  ///
+  /// \param packets_per_second  Send rate, 0 sends as fast as possible.
+  /// \param max_packets         Stop after this many packets, 0 sends the whole file.
+  /// \param skip_every          Drop every n-th segment instead of sending it, to simulate loss.
+  ///                            0 sends everything.
+  /// \return Number of packets sent.
+  size_t Run(double packets_per_second = 0, size_t max_packets = 0, size_t skip_every = 0);
+
+ private:
+  MmapPcapSource source_;
+  int socket_fd_ = -1;
+  sockaddr_in destination_;
+};
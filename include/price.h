@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+/// \class Price
+/// \brief A price in the native IEX fixed point format: an integer number of 1/10000 dollars.
+///
+/// Prices are kept as integer ticks from decoding all the way through the books, so level lookup
+/// and arithmetic are exact. Exactness is opt-in for callers: a Price still reads as the double it
+/// replaced, so code written against the former double fields keeps compiling. Comparing or
+/// combining two Prices stays in ticks, mixing a Price with a plain number is done in doubles as
+/// before. A double is constructed implicitly, rounded to the nearest tick.
+class Price {
+ public:
+  /// \brief Number of ticks per dollar, as used on the wire.
+  constexpr static int64_t ticks_per_dollar = 10000;
+
+  constexpr Price() = default;
+
+  /// \brief Convert from dollars, rounding to the nearest tick.
+  constexpr Price(double dollars)
+      : ticks_(static_cast<int64_t>(dollars * ticks_per_dollar + (dollars < 0 ? -0.5 : 0.5))) {}
+
+  constexpr static Price FromTicks(int64_t ticks) {
+    Price price;
+    price.ticks_ = ticks;
+    return price;
+  }
+
+  /// \brief The price as an integer number of 1/10000 dollars.
+  constexpr int64_t GetTicks() const { return ticks_; }
+
+  /// \brief The price in dollars.
+  constexpr double ToDouble() const { return static_cast<double>(ticks_) / ticks_per_dollar; }
+
+  /// \brief Read the price as a double, as the price fields were before they became Price.
+  constexpr operator double() const { return ToDouble(); }
+
+  friend constexpr bool operator==(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ == rhs.ticks_;
+  }
+  friend constexpr bool operator!=(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ != rhs.ticks_;
+  }
+  friend constexpr bool operator<(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ < rhs.ticks_;
+  }
+  friend constexpr bool operator>(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ > rhs.ticks_;
+  }
+  friend constexpr bool operator<=(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ <= rhs.ticks_;
+  }
+  friend constexpr bool operator>=(const Price& lhs, const Price& rhs) {
+    return lhs.ticks_ >= rhs.ticks_;
+  }
+  friend constexpr Price operator+(const Price& lhs, const Price& rhs) {
+    return FromTicks(lhs.ticks_ + rhs.ticks_);
+  }
+  friend constexpr Price operator-(const Price& lhs, const Price& rhs) {
+    return FromTicks(lhs.ticks_ - rhs.ticks_);
+  }
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  friend constexpr Price operator*(const Price& lhs, T factor) {
+    return FromTicks(lhs.ticks_ * static_cast<int64_t>(factor));
+  }
+  friend std::ostream& operator<<(std::ostream& os, const Price& price) {
+    return os << price.ToDouble();
+  }
+
+ private:
+  int64_t ticks_ = 0;
+};
+
+// Mixing a Price with a number matches these exactly, otherwise the implicit conversions in both
+// directions would make the expression ambiguous between the Price and the double operators.
+namespace price_detail {
+template <typename T>
+using EnableIfNumber = std::enable_if_t<std::is_arithmetic_v<T>, int>;
+}  // namespace price_detail
+
+#define IEX_PRICE_MIXED_OPERATOR(op, result)                                    \
+  template <typename T, price_detail::EnableIfNumber<T> = 0>                    \
+  constexpr result operator op(const Price& lhs, T rhs) {                       \
+    return lhs.ToDouble() op static_cast<double>(rhs);                          \
+  }                                                                             \
+  template <typename T, price_detail::EnableIfNumber<T> = 0>                    \
+  constexpr result operator op(T lhs, const Price& rhs) {                       \
+    return static_cast<double>(lhs) op rhs.ToDouble();                          \
+  }
+
+IEX_PRICE_MIXED_OPERATOR(==, bool)
+IEX_PRICE_MIXED_OPERATOR(!=, bool)
+IEX_PRICE_MIXED_OPERATOR(<, bool)
+IEX_PRICE_MIXED_OPERATOR(>, bool)
+IEX_PRICE_MIXED_OPERATOR(<=, bool)
+IEX_PRICE_MIXED_OPERATOR(>=, bool)
+IEX_PRICE_MIXED_OPERATOR(+, double)
+IEX_PRICE_MIXED_OPERATOR(-, double)
+IEX_PRICE_MIXED_OPERATOR(/, double)
+
+#undef IEX_PRICE_MIXED_OPERATOR
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "price.h"
+
+// Containers for one side of an OrderBook, mapping a price to the aggregate size resting there.
+// BasicOrderBook takes either one as a template parameter, they share this interface:
+//
+//   int Get(Price) const                    size at a price, 0 if the level is empty
+//   void Set(Price, int size)               set a level, a size of 0 removes it
+//   bool Empty() const, size_t Size() const
+//   std::pair<Price, int> Lowest() const    lowest level, the side must not be empty
+//   std::pair<Price, int> Highest() const   highest level, the side must not be empty
+//   ForEachAscending(f), ForEachDescending(f)
+//                                           call f(Price, int) per level until f returns false
+//   void KeepNear(Price inside)             hint where the inside of the side is
+//   void Clear()
+//   size_t GetMemoryUsage() const           approximate heap bytes held
+
+/// \class MapPriceLevels
+/// \brief Price levels in a std::map. Any price is stored the same way, at the cost of a tree
+///        walk per update and a node allocation per new level.
+class MapPriceLevels {
+ public:
+  int Get(Price price) const {
+    const auto it = levels_.find(price);
+    return it == levels_.end() ? 0 : it->second;
+  }
+
+  void Set(Price price, int size) {
+    if (size == 0) {
+      levels_.erase(price);
+    } else {
+      levels_[price] = size;
+    }
+  }
+
+  bool Empty() const { return levels_.empty(); }
+  size_t Size() const { return levels_.size(); }
+
+  std::pair<Price, int> Lowest() const { return *levels_.begin(); }
+  std::pair<Price, int> Highest() const { return *levels_.rbegin(); }
+
+  template <typename Function>
+  void ForEachAscending(Function&& function) const {
+    for (auto it = levels_.begin(); it != levels_.end(); ++it) {
+      if (!function(it->first, it->second)) {
+        return;
+      }
+    }
+  }
+
+  template <typename Function>
+  void ForEachDescending(Function&& function) const {
+    for (auto it = levels_.rbegin(); it != levels_.rend(); ++it) {
+      if (!function(it->first, it->second)) {
+        return;
+      }
+    }
+  }
+
+  /// \brief Nothing to do, a map is equally fast at any price.
+  void KeepNear(Price) {}
+
+  void Clear() { levels_.clear(); }
+
+  /// \brief Approximate, a red-black tree node carries three pointers and a color next to the value.
+  size_t GetMemoryUsage() const {
+    return levels_.size() * (sizeof(std::pair<const Price, int>) + 4 * sizeof(void*));
+  }
+
+ private:
+  std::map<Price, int> levels_;
+};
+
+/// \class TickLadderPriceLevels
+/// \brief Price levels in a contiguous array indexed by the tick offset from an anchor price.
+///
+/// The ladder covers slot_count ticks of tick_size around the inside. A bitmap marks the non-empty
+/// slots, with a summary bit per bitmap word, so the best level is found with a few bit scans
+/// instead of a tree walk. Prices off the tick grid or outside the window, e.g. far away resting
+/// orders, go to a sparse map. The window is anchored on the first level set, and re-anchored on
+/// the inside whenever KeepNear reports an inside outside of it.
+class TickLadderPriceLevels {
+ public:
+  /// \brief 4096 one cent slots cover +/- $20 around the inside.
+  constexpr static size_t default_slot_count = 4096;
+  constexpr static int64_t default_tick_size = Price::ticks_per_dollar / 100;
+
+  /// \param tick_size   Price increment of one slot, in 1/10000 dollars.
+  /// \param slot_count  Number of slots, rounded up to a multiple of 64.
+  explicit TickLadderPriceLevels(int64_t tick_size = default_tick_size,
+                                 size_t slot_count = default_slot_count);
+
+  int Get(Price price) const {
+    size_t slot = 0;
+    if (ToSlot(price, slot)) {
+      return sizes_[slot];
+    }
+    const auto it = sparse_.find(price);
+    return it == sparse_.end() ? 0 : it->second;
+  }
+
+  void Set(Price price, int size) {
+    size_t slot = 0;
+    if (ToSlot(price, slot)) {
+      SetSlot(slot, size);
+      return;
+    }
+    if (size != 0 && ladder_count_ == 0 && OnGrid(price)) {
+      // Nothing is in the window, so it can move to the new level for free.
+      Anchor(price);
+      ToSlot(price, slot);
+      SetSlot(slot, size);
+      return;
+    }
+    if (size == 0) {
+      sparse_.erase(price);
+    } else {
+      sparse_[price] = size;
+    }
+  }
+
+  bool Empty() const { return ladder_count_ == 0 && sparse_.empty(); }
+  size_t Size() const { return ladder_count_ + sparse_.size(); }
+
+  std::pair<Price, int> Lowest() const {
+    if (ladder_count_ == 0) {
+      return *sparse_.begin();
+    }
+    const size_t slot = LowestSlot();
+    const Price price = SlotPrice(slot);
+    if (!sparse_.empty() && sparse_.begin()->first < price) {
+      return *sparse_.begin();
+    }
+    return {price, sizes_[slot]};
+  }
+
+  std::pair<Price, int> Highest() const {
+    if (ladder_count_ == 0) {
+      return *sparse_.rbegin();
+    }
+    const size_t slot = HighestSlot();
+    const Price price = SlotPrice(slot);
+    if (!sparse_.empty() && sparse_.rbegin()->first > price) {
+      return *sparse_.rbegin();
+    }
+    return {price, sizes_[slot]};
+  }
+
+  template <typename Function>
+  void ForEachAscending(Function&& function) const {
+    auto sparse_it = sparse_.begin();
+    for (size_t word = 0; word < occupied_.size(); ++word) {
+      for (uint64_t bits = occupied_[word]; bits != 0; bits &= bits - 1) {
+        const size_t slot = word * 64 + __builtin_ctzll(bits);
+        const Price price = SlotPrice(slot);
+        // Sparse levels can sit between slots when they are off the tick grid.
+        for (; sparse_it != sparse_.end() && sparse_it->first < price; ++sparse_it) {
+          if (!function(sparse_it->first, sparse_it->second)) {
+            return;
+          }
+        }
+        if (!function(price, sizes_[slot])) {
+          return;
+        }
+      }
+    }
+    for (; sparse_it != sparse_.end(); ++sparse_it) {
+      if (!function(sparse_it->first, sparse_it->second)) {
+        return;
+      }
+    }
+  }
+
+  template <typename Function>
+  void ForEachDescending(Function&& function) const {
+    auto sparse_it = sparse_.rbegin();
+    for (size_t word = occupied_.size(); word-- > 0;) {
+      for (uint64_t bits = occupied_[word]; bits != 0;) {
+        const int bit = 63 - __builtin_clzll(bits);
+        bits &= ~(uint64_t{1} << bit);
+        const size_t slot = word * 64 + bit;
+        const Price price = SlotPrice(slot);
+        for (; sparse_it != sparse_.rend() && sparse_it->first > price; ++sparse_it) {
+          if (!function(sparse_it->first, sparse_it->second)) {
+            return;
+          }
+        }
+        if (!function(price, sizes_[slot])) {
+          return;
+        }
+      }
+    }
+    for (; sparse_it != sparse_.rend(); ++sparse_it) {
+      if (!function(sparse_it->first, sparse_it->second)) {
+        return;
+      }
+    }
+  }
+
+  /// \brief Re-anchor the window on inside if it has drifted out of it.
+  void KeepNear(Price inside) {
+    size_t slot = 0;
+    if (!ToSlot(inside, slot) && OnGrid(inside)) {
+      Anchor(inside);
+    }
+  }
+
+  void Clear();
+
+  /// \brief The ladder arrays are allocated up front, so this is mostly independent of the levels.
+  size_t GetMemoryUsage() const {
+    return sizes_.capacity() * sizeof(int) + occupied_.capacity() * sizeof(uint64_t) +
+           summary_.capacity() * sizeof(uint64_t) +
+           sparse_.size() * (sizeof(std::pair<const Price, int>) + 4 * sizeof(void*));
+  }
+
+  /// \brief Number of levels held in the sparse map rather than the ladder.
+  size_t GetSparseCount() const { return sparse_.size(); }
+
+ private:
+  bool OnGrid(Price price) const { return price.GetTicks() % tick_size_ == 0; }
+
+  /// \return True if price is on the grid and inside the window.
+  bool ToSlot(Price price, size_t& slot) const {
+    const int64_t ticks = price.GetTicks();
+    if (ticks % tick_size_ != 0) {
+      return false;
+    }
+    const uint64_t offset = static_cast<uint64_t>(ticks / tick_size_ - anchor_step_);
+    slot = static_cast<size_t>(offset);
+    return offset < sizes_.size();
+  }
+
+  Price SlotPrice(size_t slot) const {
+    return Price::FromTicks((anchor_step_ + static_cast<int64_t>(slot)) * tick_size_);
+  }
+
+  void SetSlot(size_t slot, int size) {
+    const size_t word = slot / 64;
+    const uint64_t bit = uint64_t{1} << (slot % 64);
+    if (size == 0) {
+      if (occupied_[word] & bit) {
+        occupied_[word] &= ~bit;
+        --ladder_count_;
+        if (occupied_[word] == 0) {
+          summary_[word / 64] &= ~(uint64_t{1} << (word % 64));
+        }
+      }
+    } else if (!(occupied_[word] & bit)) {
+      occupied_[word] |= bit;
+      summary_[word / 64] |= uint64_t{1} << (word % 64);
+      ++ladder_count_;
+    }
+    sizes_[slot] = size;
+  }
+
+  size_t LowestSlot() const {
+    size_t index = 0;
+    while (summary_[index] == 0) {
+      ++index;
+    }
+    const size_t word = index * 64 + __builtin_ctzll(summary_[index]);
+    return word * 64 + __builtin_ctzll(occupied_[word]);
+  }
+
+  size_t HighestSlot() const {
+    size_t index = summary_.size() - 1;
+    while (summary_[index] == 0) {
+      --index;
+    }
+    const size_t word = index * 64 + 63 - __builtin_clzll(summary_[index]);
+    return word * 64 + 63 - __builtin_clzll(occupied_[word]);
+  }
+
+  /// \brief Center the window on price, moving levels between the ladder and the sparse map.
+  void Anchor(Price price);
+
+  int64_t tick_size_;
+
+  /// \brief Price of slot 0, in steps of tick_size_.
+  int64_t anchor_step_ = 0;
+
+  /// \brief Size per slot, 0 where the level is empty.
+  std::vector<int> sizes_;
+
+  /// \brief One bit per slot, set if the slot holds a level.
+  std::vector<uint64_t> occupied_;
+
+  /// \brief One bit per word of occupied_, set if the word is non-zero.
+  std::vector<uint64_t> summary_;
+
+  /// \brief Number of levels held in the ladder.
+  size_t ladder_count_ = 0;
+
+  /// \brief Levels off the tick grid or outside the window.
+  std::map<Price, int> sparse_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "iex_messages.h"
+#include "orderbook.h"
+#include "price.h"
+#include "symbol.h"
+
+/// \class QuoteCsvWriter
+/// \brief Writes quotes as CSV rows: Timestamp,Symbol,BidSize,BidPrice,AskSize,AskPrice.
+///
+/// Rows are formatted by hand into a large buffer that is handed to the kernel with one write()
+/// when full. Timestamps are local time with nanoseconds, e.g. "2018-01-26 09:30:00.000123456":
+/// the date and time part is only rebuilt when the second changes, the nanoseconds are plain
+/// integer digits. Prices are printed exactly from their ticks, without trailing zeros.
+class QuoteCsvWriter {
+ public:
+  /// \param buffer_size  Bytes buffered before a write() is issued.
+  explicit QuoteCsvWriter(size_t buffer_size = 1 << 20);
+  ~QuoteCsvWriter() { Close(); }
+
+  /// \brief Create or truncate a file and write the header row.
+  ///
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& filename) WARN_UNUSED;
+
+  /// \brief Flush and close the file.
+  ///
+  /// \return False if any write failed.
+  bool Close();
+
+  /// \brief Append one row.
+  ///
+  /// \return False if flushing the buffer failed.
+  bool WriteQuote(uint64_t timestamp, const Symbol& symbol, int bid_size, Price bid_price,
+                  int ask_size, Price ask_price);
+  bool WriteQuote(uint64_t timestamp, const QuoteUpdateMessage& quote) {
+    return WriteQuote(timestamp, quote.symbol, quote.bid_size, quote.bid_price, quote.ask_size,
+                      quote.ask_price);
+  }
+  bool WriteQuote(uint64_t timestamp, const Symbol& symbol, const BBO& bbo) {
+    return WriteQuote(timestamp, symbol, bbo.getBidSize(), bbo.getBidTicks(), bbo.getAskSize(),
+                      bbo.getAskTicks());
+  }
+
+  /// \brief Hand the buffered rows to the kernel.
+  ///
+  /// \return False if writing failed.
+  bool Flush();
+
+  /// \brief Format a price from its ticks, e.g. 1234500 as "123.45".
+  ///
+  /// \return Pointer one past the last character written, at most 22 characters.
+  static char* FormatPrice(Price price, char* out);
+
+  /// \brief Format a timestamp as local "YYYY-MM-DD HH:MM:SS.nnnnnnnnn".
+  ///
+  /// \return Pointer one past the last character written, always 29 characters.
+  char* FormatTimestamp(uint64_t timestamp, char* out);
+
+ private:
+  /// \brief Longest row that can be formatted.
+  constexpr static size_t max_row_len = 128;
+
+  constexpr static size_t date_time_len = 19;
+
+  int fd_ = -1;
+  std::vector<char> buffer_;
+  size_t used_ = 0;
+  bool failed_ = false;
+
+  /// \brief Second of the timestamp date_time_ was formatted for.
+  int64_t cached_second_ = -1;
+  char date_time_[date_time_len + 1];
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "iex_decoder.h"
+#include "iex_messages.h"
+#include "packet_source.h"
+
+/// \brief Layout of the ring shared between one publisher and any number of consumers.
+///
+/// The ring lives in a POSIX shared memory object: a header followed by a power of two number of
+/// fixed size slots. Slot n % capacity holds message n. Each slot is guarded by its own sequence
+/// word, which is 0 while the publisher writes the slot and n + 1 once message n is complete, so
+/// readers validate a copy seqlock style and never block the publisher.
+namespace shm_ring {
+
+/// \brief Identifies a ring and its layout version.
+constexpr uint64_t magic = 0x3130474e49525849;  // "IXRING01"
+
+/// \brief Largest message that fits a slot. The longest IEX message, AuctionInformation, is 80.
+constexpr size_t max_message_len = 104;
+
+struct alignas(64) Header {
+  uint64_t magic;
+  uint64_t capacity;
+
+  /// \brief Set by the publisher after the last message.
+  std::atomic<uint32_t> finished;
+
+  /// \brief Number of messages published so far, on its own cache line.
+  alignas(64) std::atomic<uint64_t> write_count;
+};
+
+struct alignas(64) Slot {
+  /// \brief 0 while being written, otherwise one more than the index of the message held.
+  std::atomic<uint64_t> seq;
+
+  /// \brief Sequence number of the message in the IEX-TP stream.
+  int64_t sq_num;
+
+  uint16_t len;
+
+  /// \brief The message as sent on the wire, starting with the type byte.
+  uint8_t data[max_message_len];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The ring needs lock free atomics.");
+static_assert(sizeof(Slot) == 128, "Slots are meant to span exactly two cache lines.");
+
+/// \brief Size of the shared memory object for a ring of capacity slots.
+inline size_t GetMappingSize(size_t capacity) { return sizeof(Header) + capacity * sizeof(Slot); }
+
+}  // namespace shm_ring
+
+/// \class ShmRingPublisher
+/// \brief Publishes the messages of one IEXDecoder to any number of consumer processes.
+///
+/// The publisher never waits for consumers. A consumer falling more than the ring capacity behind
+/// loses messages, which it detects and reports, see ShmRingConsumer.
+class ShmRingPublisher {
+ public:
+  /// \param capacity  Number of slots, rounded up to a power of two.
+  explicit ShmRingPublisher(size_t capacity = 1 << 20);
+  ~ShmRingPublisher() { Close(); }
+
+  /// \brief Create the shared memory object, replacing any stale one of the same name.
+  ///
+  /// \param name  POSIX shared memory name, e.g. "/iex_deep".
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& name) WARN_UNUSED;
+
+  /// \brief Mark the ring finished and remove its name. Attached consumers keep their mapping.
+  void Close();
+
+  /// \brief Publish one message.
+  ///
+  /// \param msg_data_ptr  Pointer to the message data (the message type byte).
+  /// \param msg_len       Length of the message data.
+  /// \param sq_num        Sequence number of the message in the IEX-TP stream.
+  /// \return False if the message is too large for a slot.
+  bool Publish(const uint8_t* msg_data_ptr, size_t msg_len, int64_t sq_num);
+
+  /// \brief Publish every remaining message of a decoder, honouring its subscription.
+  ///
+  /// Stops at the first message too large for a slot, the decoder is left just past it.
+  ///
+  /// \return The return code that ended the decoder stream, EndOfStream normally, or
+  ///         FailedWriting if a message did not fit a slot.
+  ReturnCode PublishAll(IEXDecoder& decoder);
+
+  /// \brief Tell consumers no more messages will follow.
+  void Finish();
+
+ private:
+  std::string name_;
+  size_t capacity_;
+  shm_ring::Header* header_ = nullptr;
+  shm_ring::Slot* slots_ = nullptr;
+
+  /// \brief Local copy of the write count, the publisher is its only writer.
+  uint64_t write_count_ = 0;
+};
+
+/// \class ShmRingConsumer
+/// \brief Reads the messages of a ShmRingPublisher without system calls.
+class ShmRingConsumer {
+ public:
+  ~ShmRingConsumer() { Close(); }
+
+  /// \brief Attach to a ring.
+  ///
+  /// \param name         POSIX shared memory name given to the publisher.
+  /// \param from_oldest  Start at the oldest message still in the ring instead of the newest.
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& name, bool from_oldest = false) WARN_UNUSED;
+
+  void Close();
+
+  /// \brief Decode the next message of the ring.
+  ///
+  /// If the publisher overwrote messages this consumer had not read yet, reading continues at the
+  /// oldest message still available and the loss is counted in GetMissedCount.
+  ///
+  /// \param msg  Output parameter, containing the message if successfully decoded.
+  /// \return Success, WouldBlock if there is no new message yet, EndOfStream once the publisher
+  ///         finished and everything was read, otherwise a decoding error.
+  ReturnCode GetNextMessage(IEXMessage& msg);
+
+  /// \brief Sequence number in the IEX-TP stream of the last message returned.
+  int64_t GetLastSequence() const { return last_sq_num_; }
+
+  /// \brief Number of published messages not read yet.
+  uint64_t GetLag() const;
+
+  /// \brief Number of times the publisher overran this consumer.
+  uint64_t GetOverrunCount() const { return overrun_count_; }
+
+  /// \brief Total number of messages lost to overruns.
+  uint64_t GetMissedCount() const { return missed_count_; }
+
+ private:
+  /// \brief Skip ahead after an overrun.
+  void Resync();
+
+  size_t capacity_ = 0;
+  size_t mapping_len_ = 0;
+  const shm_ring::Header* header_ = nullptr;
+  const shm_ring::Slot* slots_ = nullptr;
+
+  /// \brief Index of the next message to read.
+  uint64_t read_count_ = 0;
+
+  int64_t last_sq_num_ = 0;
+  uint64_t overrun_count_ = 0;
+  uint64_t missed_count_ = 0;
+
+  /// \brief Validated copy of the slot being decoded.
+  uint8_t buffer_[shm_ring::max_message_len];
+};
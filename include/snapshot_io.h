@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// \brief Helpers for the binary book snapshots, see OrderBook::SaveSnapshot, and the other files
+///        the library persists.
+///
+/// Values are written in host byte order, snapshots are meant to be resumed on the machine that
+/// wrote them.
+namespace snapshot_io {
+
+template <typename T>
+void Write(std::ostream& out, const T& value) {
+  static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be written directly.");
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// \return False if the stream ended early.
+template <typename T>
+bool Read(std::istream& in, T& value) {
+  static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be read directly.");
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+/// \brief Read a container size, rejecting counts larger than the rest of a sane snapshot.
+inline bool ReadCount(std::istream& in, uint64_t& count) {
+  constexpr uint64_t max_count = uint64_t{1} << 32;
+  return Read(in, count) && count < max_count;
+}
+
+/// \brief Replace a file with the concatenation of parts.
+///
+/// The parts go to a temporary file next to path, which is synced to disk before it is renamed
+/// over path. A crash at any point therefore leaves either the previous file or the complete new
+/// one, never a truncated file.
+///
+/// \return True if succeeds, false otherwise, in which case path is left untouched.
+bool WriteFileAtomically(const std::string& path, std::initializer_list<std::string_view> parts);
+
+}  // namespace snapshot_io
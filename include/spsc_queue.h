@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/// \class SpscQueue
+/// \brief Bounded lock free queue between exactly one producer thread and one consumer thread.
+///
+/// Each side owns one index and only reads the other side's index when its cached copy says the
+/// queue is full (producer) or empty (consumer), so in steady state a push or a pop touches no
+/// cache line written by the other thread.
+template <typename T>
+class SpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value, "Queue elements are copied as raw bytes.");
+
+ public:
+  /// \param capacity  Number of elements, rounded up to a power of two.
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size *= 2;
+    }
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  /// \brief Producer side. Returns false if the queue is full.
+  bool TryPush(const T& value) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// \brief Consumer side. Returns false if the queue is empty.
+  bool TryPop(T& value) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    value = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// \brief Number of queued elements. Exact only when called from one of the two threads while
+  ///        the other is idle, otherwise a snapshot.
+  size_t Size() const {
+    return static_cast<size_t>(tail_.load(std::memory_order_acquire) -
+                               head_.load(std::memory_order_acquire));
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  std::vector<T> slots_;
+  uint64_t mask_;
+
+  /// \brief Written by the producer only, with the consumer index it saw last.
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  uint64_t cached_head_ = 0;
+
+  /// \brief Written by the consumer only, with the producer index it saw last.
+  alignas(64) std::atomic<uint64_t> head_{0};
+  uint64_t cached_tail_ = 0;
+};
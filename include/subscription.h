@@ -0,0 +1,65 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+#include "iex_messages.h"
+#include "symbol.h"
+#include "symbol_table.h"
+
+/// \class Subscription
+/// \brief A filter on message type and symbol, checked on the raw block before decoding.
+///
+/// The type byte is the first byte of every message and the symbol of every symbol carrying
+/// message sits at the same offset, so both checks read the wire data directly: a bit test for the
+/// type and a hash probe on the packed 8 byte symbol. An empty set of types or symbols matches
+/// everything, and messages without a symbol (e.g. SystemEvent) are never filtered on symbol.
+class Subscription {
+ public:
+  Subscription();
+
+  /// \brief Only deliver messages of the added types.
+  Subscription& AddMessageType(MessageType type);
+
+  /// \brief Only deliver messages for the added symbols, plus messages carrying no symbol.
+  Subscription& AddSymbol(const Symbol& symbol);
+
+  /// \brief True if nothing is filtered.
+  bool MatchesAll() const { return match_all_; }
+
+  /// \brief Check a message block against the subscription.
+  ///
+  /// \param msg_data_ptr  Pointer to the start of the message data (the message type byte).
+  /// \param msg_len       Length of the message data in bytes.
+  /// \return True if the message should be decoded.
+  inline bool Matches(const uint8_t* msg_data_ptr, size_t msg_len) const {
+    if (match_all_) {
+      return true;
+    }
+    const uint8_t type = msg_data_ptr[0];
+    if (filter_types_ && !types_.test(type)) {
+      return false;
+    }
+    if (symbols_.Size() == 0 || !symbol_types_.test(type) || msg_len < symbol_offset + 8) {
+      return true;
+    }
+    return symbols_.Find(Symbol::FromWire(msg_data_ptr + symbol_offset)) != SymbolTable::invalid_id;
+  }
+
+ private:
+  /// \brief Offset of the symbol field in every message that carries one.
+  constexpr static size_t symbol_offset = 10;
+
+  /// \brief Subscribed type bytes.
+  std::bitset<256> types_;
+
+  /// \brief Type bytes of the messages carrying a symbol at symbol_offset.
+  std::bitset<256> symbol_types_;
+
+  /// \brief Subscribed symbols. Only Find is used, the ids are irrelevant.
+  SymbolTable symbols_;
+
+  bool filter_types_ = false;
+  bool match_all_ = true;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/// \class Symbol
+/// \brief An IEX security identifier packed into a single 64 bit integer.
+///
+/// The value holds the raw 8 bytes of the wire field: ASCII, left justified and padded with
+/// spaces. Comparing or hashing two symbols is therefore a single integer operation, conversion to
+/// std::string only happens when a symbol is printed.
+class Symbol {
+ public:
+  /// \brief Length of the symbol field on the wire.
+  constexpr static size_t length = 8;
+
+  /// \brief An empty symbol, i.e. eight spaces.
+  constexpr Symbol() = default;
+
+  /// \brief Pack a string, padding with spaces. Characters beyond the 8th are dropped.
+  constexpr Symbol(const char* str) {
+    uint64_t packed = 0;
+    bool ended = false;
+    for (size_t i = 0; i < length; ++i) {
+      ended = ended || str[i] == '\0';
+      const uint64_t byte = ended ? ' ' : static_cast<unsigned char>(str[i]);
+      packed |= byte << (8 * i);
+    }
+    packed_ = packed;
+  }
+
+  Symbol(const std::string& str) : Symbol(str.c_str()) {}
+
+  /// \brief Load the symbol from the wire, without any conversion.
+  ///
+  /// \param data_ptr Pointer to the first byte of the 8 byte symbol field.
+  static Symbol FromWire(const uint8_t* data_ptr) {
+    Symbol symbol;
+    std::memcpy(&symbol.packed_, data_ptr, length);
+    return symbol;
+  }
+
+  /// \brief Construct from a value previously returned by GetPacked.
+  constexpr static Symbol FromPacked(uint64_t packed) {
+    Symbol symbol;
+    symbol.packed_ = packed;
+    return symbol;
+  }
+
+  /// \brief The raw 8 wire bytes as an integer.
+  constexpr uint64_t GetPacked() const { return packed_; }
+
+  /// \brief True if the symbol is all spaces.
+  constexpr bool empty() const { return packed_ == all_spaces; }
+
+  /// \brief The symbol as a string, with the trailing padding removed.
+  std::string ToString() const {
+    char chars[length];
+    std::memcpy(chars, &packed_, length);
+    size_t len = length;
+    while (len > 0 && (chars[len - 1] == ' ' || chars[len - 1] == '\0')) {
+      --len;
+    }
+    return std::string(chars, len);
+  }
+
+  friend constexpr bool operator==(const Symbol& lhs, const Symbol& rhs) {
+    return lhs.packed_ == rhs.packed_;
+  }
+  friend constexpr bool operator!=(const Symbol& lhs, const Symbol& rhs) {
+    return lhs.packed_ != rhs.packed_;
+  }
+  /// \brief Alphabetical order. The bytes are stored first character lowest, so swap them first.
+  friend bool operator<(const Symbol& lhs, const Symbol& rhs) {
+    return __builtin_bswap64(lhs.packed_) < __builtin_bswap64(rhs.packed_);
+  }
+  friend std::ostream& operator<<(std::ostream& os, const Symbol& symbol) {
+    return os << symbol.ToString();
+  }
+
+ private:
+  constexpr static uint64_t all_spaces = 0x2020202020202020ULL;
+
+  uint64_t packed_ = all_spaces;
+};
+
+namespace std {
+template <>
+struct hash<Symbol> {
+  size_t operator()(const Symbol& symbol) const {
+    // The splitmix64 finalizer. Every output bit depends on every character, so symbols sharing
+    // a prefix (GOOG, GOOGL) still spread when a table keeps only the low bits.
+    uint64_t x = symbol.GetPacked();
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<size_t>(x ^ (x >> 31));
+  }
+};
+}  // namespace std
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "iex_messages.h"
+#include "symbol.h"
+
+/// \class SymbolTable
+/// \brief Assigns dense integer ids to symbols, so per-symbol state can live in a plain array.
+///
+/// Ids are handed out in order of first appearance, starting at 0. The table is typically seeded
+/// from the SecurityDirectory messages sent at the start of each day, after which every lookup is
+/// a hash probe on the packed symbol and books can be indexed directly by id.
+class SymbolTable {
+ public:
+  /// \brief Returned by Find for symbols that were never interned.
+  constexpr static uint32_t invalid_id = UINT32_MAX;
+
+  /// \param expected_symbols Capacity hint. The IEX universe is roughly 10,000 symbols.
+  explicit SymbolTable(size_t expected_symbols = 16384);
+
+  /// \brief Get the id of a symbol, assigning the next free id if it is new.
+  uint32_t Intern(const Symbol& symbol);
+
+  /// \brief Get the id of a symbol.
+  ///
+  /// \return The id, or invalid_id if the symbol was never interned.
+  uint32_t Find(const Symbol& symbol) const;
+
+  /// \brief Seed the table from a security directory message.
+  ///
+  /// \return The id assigned to the security.
+  uint32_t AddSecurity(const SecurityDirectoryMessage& msg) { return Intern(msg.symbol); }
+
+  /// \brief Get the symbol belonging to an id.
+  const Symbol& GetSymbol(uint32_t id) const { return symbols_[id]; }
+
+  /// \brief Number of slots a lookup of the symbol examines, 1 if it sits in its home slot.
+  size_t GetProbeLength(const Symbol& symbol) const;
+
+  /// \brief Number of interned symbols, which is also one past the largest id.
+  size_t Size() const { return symbols_.size(); }
+
+ private:
+  /// \brief Position of the slot holding the symbol, or of the empty slot it would go into.
+  size_t Probe(uint64_t packed) const;
+
+  /// \brief Double the slot arrays and reinsert all symbols.
+  void Grow();
+
+  /// \brief Open addressing hash table of packed symbols. Zero marks an empty slot, which can
+  ///        never be a real symbol as those are padded with spaces.
+  std::vector<uint64_t> slot_keys_;
+
+  /// \brief Id stored in the slot with the same index.
+  std::vector<uint32_t> slot_ids_;
+
+  /// \brief Symbols indexed by id.
+  std::vector<Symbol> symbols_;
+};
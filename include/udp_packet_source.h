@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "packet_source.h"
+
+/// \class UdpPacketSource
+/// \brief Packet source receiving IEX-TP segments from a live UDP feed.
+///
+/// Datagrams are received in batches with recvmmsg, so one system call delivers many segments,
+/// and handed out one at a time like the file based sources. The IEX-TP header of every segment
+/// is checked against the sequence numbers seen so far to count gaps in the feed.
+class UdpPacketSource : public PacketSource {
+ public:
+  /// \param batch_size  Maximum number of datagrams received per system call.
+  /// \param timeout_ms  How long to wait for data before reporting the end of the stream. IEX
+  ///                    sends heartbeats every second, so a longer silence means the feed is
+  ///                    down. Zero waits forever.
+  explicit UdpPacketSource(size_t batch_size = 32, int timeout_ms = 5000);
+  ~UdpPacketSource() override { Close(); }
+
+  // The receive headers point into buffer_ and iovecs_, a copy would read through them.
+  UdpPacketSource(const UdpPacketSource&) = delete;
+  UdpPacketSource& operator=(const UdpPacketSource&) = delete;
+
+  /// \brief Bind a socket to the feed.
+  ///
+  /// \param address  "ip:port" to listen on. A multicast group address is joined on the default
+  ///                 interface. Port 0 binds an ephemeral port, see GetPort.
+  /// \return True if succeeds, false otherwise.
+  bool Open(const std::string& address) override WARN_UNUSED;
+  void Close() override;
+  ReturnCode GetNextPayload(const uint8_t*& data, size_t& len) override WARN_UNUSED;
+
+  /// \brief The local port the socket is bound to.
+  uint16_t GetPort() const { return port_; }
+
+  /// \brief Number of times the sequence number jumped ahead.
+  uint64_t GetGapCount() const { return gap_count_; }
+
+  /// \brief Total number of messages skipped over by gaps.
+  uint64_t GetMissedMessageCount() const { return missed_messages_; }
+
+  /// \brief Sequence number of the next message expected, 0 before the first segment.
+  int64_t GetExpectedSequence() const { return expected_sq_num_; }
+
+ private:
+  /// \brief Largest datagram that is received without truncation.
+  constexpr static size_t max_datagram_len = 65536;
+
+  /// \brief Receive the next batch of datagrams.
+  ReturnCode ReceiveBatch() WARN_UNUSED;
+
+  /// \brief Update the gap statistics from the IEX-TP header of a segment.
+  void TrackSequence(const uint8_t* data, size_t len);
+
+  int socket_fd_ = -1;
+  uint16_t port_ = 0;
+  int timeout_ms_;
+
+  /// \brief Receive buffers, max_datagram_len bytes per datagram of a batch.
+  std::vector<uint8_t> buffer_;
+  std::vector<struct mmsghdr> headers_;
+  std::vector<struct iovec> iovecs_;
+
+  /// \brief Number of datagrams in the current batch and the next one to hand out.
+  size_t batch_count_ = 0;
+  size_t batch_pos_ = 0;
+
+  int64_t expected_sq_num_ = 0;
+  uint64_t gap_count_ = 0;
+  uint64_t missed_messages_ = 0;
+};
@@ -0,0 +1,135 @@
+#include "book_manager.h"
+
+#include <exception>
+
+BookManager::BookManager(size_t expected_symbols) : symbols_(expected_symbols) {
+  books_.reserve(expected_symbols);
+  l3_books_.reserve(expected_symbols);
+  updates_.reserve(expected_symbols);
+  l3_updates_.reserve(expected_symbols);
+  errors_.reserve(expected_symbols);
+}
+
+BookManager::L3BookFactory BookManager::PriceBandL3Books(double band, size_t max_levels) {
+  return [band, max_levels](const SecurityDirectoryMessage& directory) -> std::optional<L3OrderBook> {
+    const double close = directory.adjusted_POC_price.ToDouble();
+    if (close <= 0.0) {
+      return std::nullopt;
+    }
+    // Sub-dollar securities quote in 1/100 cents.
+    const Price increment = close < 1.0 ? Price::FromTicks(1) : Price(0.01);
+    const int64_t increment_ticks = increment.GetTicks();
+    const int64_t min_ticks =
+        Price(close * (1.0 - band)).GetTicks() / increment_ticks * increment_ticks;
+    const int64_t max_ticks = Price(close * (1.0 + band)).GetTicks();
+    const size_t level_count = static_cast<size_t>((max_ticks - min_ticks) / increment_ticks) + 1;
+    if (level_count > max_levels) {
+      IEX_DEBUG("No L3 book for " << directory.symbol << ", its band needs " << level_count
+                                  << " levels");
+      return std::nullopt;
+    }
+    return L3OrderBook(level_count, Price::FromTicks(min_ticks), Price::FromTicks(max_ticks),
+                       increment);
+  };
+}
+
+void BookManager::SetListener(BookListener* listener) {
+  listener_ = listener;
+  for (auto& book : books_) {
+    book.SetListener(listener);
+  }
+  for (auto& l3_book : l3_books_) {
+    if (l3_book) {
+      l3_book->SetListener(listener);
+    }
+  }
+}
+
+uint32_t BookManager::Intern(const Symbol& symbol) {
+  const uint32_t id = symbols_.Intern(symbol);
+  if (id == books_.size()) {
+    books_.emplace_back();
+    books_.back().SetListener(listener_);
+    l3_books_.emplace_back();
+    updates_.push_back(0);
+    l3_updates_.push_back(0);
+    errors_.push_back(0);
+  }
+  return id;
+}
+
+uint32_t BookManager::AddSecurity(const SecurityDirectoryMessage& directory) {
+  const uint32_t id = Intern(directory.symbol);
+  if (l3_factory_ && !l3_books_[id]) {
+    if (auto l3_book = l3_factory_(directory)) {
+      l3_books_[id] = std::make_unique<L3OrderBook>(std::move(*l3_book));
+      l3_books_[id]->SetListener(listener_);
+    }
+  }
+  return id;
+}
+
+uint32_t BookManager::ProcessMessage(const IEXMessage& msg) {
+  if (const auto* directory = std::get_if<SecurityDirectoryMessage>(&msg)) {
+    AddSecurity(*directory);
+    return SymbolTable::invalid_id;
+  }
+
+  uint32_t id = SymbolTable::invalid_id;
+  // A book throwing is counted per symbol rather than ending the day.
+  try {
+    if (const auto* update = std::get_if<PriceLevelUpdateMessage>(&msg)) {
+      id = Intern(update->symbol);
+      ++updates_[id];
+      books_[id].ProcessMessage(msg);
+      return id;
+    }
+    const bool is_order_message =
+        std::holds_alternative<AddOrderMessage>(msg) ||
+        std::holds_alternative<OrderModifyMessage>(msg) ||
+        std::holds_alternative<OrderDeleteMessage>(msg) ||
+        std::holds_alternative<OrderExecutedMessage>(msg) ||
+        (std::holds_alternative<TradeReportMessage>(msg) &&
+         std::get<TradeReportMessage>(msg).GetMessageType() == MessageType::TradeReport);
+    if (!is_order_message) {
+      return SymbolTable::invalid_id;
+    }
+    id = symbols_.Find(GetMessageBase(msg).GetSymbol());
+    if (id == SymbolTable::invalid_id || !l3_books_[id]) {
+      return SymbolTable::invalid_id;
+    }
+    ++l3_updates_[id];
+    l3_books_[id]->ProcessMessage(msg);
+    return id;
+  } catch (const std::exception& e) {
+    if (id == SymbolTable::invalid_id) {
+      throw;
+    }
+    if (errors_[id]++ == 0) {
+      IEX_ERROR("Book update for " << symbols_.GetSymbol(id) << " failed: " << e.what());
+    }
+    return id;
+  }
+}
+
+BookUsage BookManager::GetUsage(uint32_t id) const {
+  BookUsage usage;
+  usage.symbol = symbols_.GetSymbol(id);
+  usage.updates = updates_[id];
+  usage.l3_updates = l3_updates_[id];
+  usage.errors = errors_[id];
+  usage.memory_bytes = sizeof(OrderBook) + books_[id].GetMemoryUsage();
+  if (l3_books_[id]) {
+    usage.memory_bytes += sizeof(L3OrderBook) + l3_books_[id]->GetMemoryUsage();
+  }
+  return usage;
+}
+
+std::vector<BookUsage> BookManager::GetUsage() const {
+  std::vector<BookUsage> usage;
+  usage.reserve(books_.size());
+  for (uint32_t id = 0; id < books_.size(); ++id) {
+    usage.push_back(GetUsage(id));
+  }
+  return usage;
+}
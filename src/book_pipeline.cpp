@@ -0,0 +1,264 @@
+#include "book_pipeline.h"
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// \brief Take an occupancy sample every this many pushes.
+constexpr uint64_t occupancy_sample_interval = 64;
+
+}  // namespace
+
+bool ToMessageRecord(const IEXMessage& msg, MessageRecord& record) {
+  const auto make_record = [&record](const IEXMessageBase& base, const Symbol& symbol,
+                                     uint64_t order_id, Price price, uint32_t size, uint8_t flags) {
+    record = {base.timestamp, order_id, price, symbol, size,
+              static_cast<uint8_t>(base.GetMessageType()), flags};
+    return true;
+  };
+  return std::visit(
+      Overloaded{
+          [&](const PriceLevelUpdateMessage& update) {
+            return make_record(update, update.symbol, 0, update.price,
+                               static_cast<uint32_t>(update.size), update.flags);
+          },
+          [&](const AddOrderMessage& add_order) {
+            return make_record(add_order, add_order.symbol, add_order.order_id, add_order.price,
+                               add_order.size, static_cast<uint8_t>(add_order.side));
+          },
+          [&](const OrderModifyMessage& modify_order) {
+            return make_record(modify_order, modify_order.symbol, modify_order.order_id_ref,
+                               modify_order.price, modify_order.size,
+                               static_cast<uint8_t>(modify_order.flags));
+          },
+          [&](const OrderDeleteMessage& delete_order) {
+            return make_record(delete_order, delete_order.symbol, delete_order.order_id_ref,
+                               Price(), 0, 0);
+          },
+          [&](const OrderExecutedMessage& executed_order) {
+            return make_record(executed_order, executed_order.symbol, executed_order.order_id_ref,
+                               executed_order.price, executed_order.size, 0);
+          },
+          [&](const TradeReportMessage& trade) {
+            // TradeBreak shares the struct but does not change a book.
+            return trade.GetMessageType() == MessageType::TradeReport &&
+                   make_record(trade, trade.symbol, static_cast<uint64_t>(trade.trade_id),
+                               trade.price, static_cast<uint32_t>(trade.size), trade.flags);
+          },
+          [](const auto&) { return false; }},
+      msg);
+}
+
+void FromMessageRecord(const MessageRecord& record, IEXMessage& msg) {
+  IEXMessageBase* base = nullptr;
+  switch (record.GetType()) {
+    case MessageType::PriceLevelUpdateBuy:
+    case MessageType::PriceLevelUpdateSell:
+      base = &msg.emplace<PriceLevelUpdateMessage>(record.GetType(), record.symbol, record.price,
+                                                   static_cast<int>(record.size), record.flags);
+      break;
+    case MessageType::AddOrder: {
+      auto& add_order = msg.emplace<AddOrderMessage>();
+      add_order.order_id = record.order_id;
+      add_order.size = record.size;
+      add_order.side = static_cast<Side>(record.flags);
+      add_order.price = record.price;
+      add_order.symbol = record.symbol;
+      base = &add_order;
+      break;
+    }
+    case MessageType::OrderModify: {
+      auto& modify_order = msg.emplace<OrderModifyMessage>();
+      modify_order.order_id_ref = record.order_id;
+      modify_order.size = record.size;
+      modify_order.price = record.price;
+      modify_order.flags = static_cast<ModifyFlags>(record.flags);
+      modify_order.symbol = record.symbol;
+      base = &modify_order;
+      break;
+    }
+    case MessageType::OrderDelete: {
+      auto& delete_order = msg.emplace<OrderDeleteMessage>();
+      delete_order.order_id_ref = record.order_id;
+      delete_order.symbol = record.symbol;
+      base = &delete_order;
+      break;
+    }
+    case MessageType::OrderExecuted: {
+      auto& executed_order = msg.emplace<OrderExecutedMessage>();
+      executed_order.order_id_ref = record.order_id;
+      executed_order.size = record.size;
+      executed_order.price = record.price;
+      executed_order.symbol = record.symbol;
+      base = &executed_order;
+      break;
+    }
+    default: {
+      auto& trade = msg.emplace<TradeReportMessage>(record.GetType());
+      trade.flags = record.flags;
+      trade.symbol = record.symbol;
+      trade.size = static_cast<int>(record.size);
+      trade.price = record.price;
+      trade.trade_id = static_cast<int>(record.order_id);
+      base = &trade;
+      break;
+    }
+  }
+  base->timestamp = record.timestamp;
+}
+
+std::ostream& operator<<(std::ostream& os, const PipelineStats& stats) {
+  const auto rate = [](uint64_t count, double seconds) {
+    return seconds > 0 ? count / seconds : 0.0;
+  };
+  os << std::fixed << std::setprecision(0);
+  os << "Pipeline ran " << std::setprecision(3) << stats.elapsed_seconds << " s, "
+     << stats.messages << " messages, " << stats.decoder.records << " book updates\n";
+  os << std::setprecision(0);
+  os << "  decoder : " << rate(stats.messages, stats.decoder.busy_seconds) << " msg/s, "
+     << stats.decoder.stalls << " waits on a full queue\n";
+  for (size_t i = 0; i < stats.workers.size(); ++i) {
+    const auto& worker = stats.workers[i];
+    const auto& queue = stats.queues[i];
+    os << "  worker " << i << ": " << worker.records << " updates, "
+       << rate(worker.records, worker.busy_seconds) << " upd/s busy, " << std::setprecision(1)
+       << (stats.elapsed_seconds > 0 ? 100 * worker.busy_seconds / stats.elapsed_seconds : 0)
+       << "% busy, " << worker.errors << " errors, queue mean " << queue.mean_occupancy << " max " << queue.max_occupancy << " of "
+       << queue.capacity << "\n"
+       << std::setprecision(0);
+  }
+  os.unsetf(std::ios_base::floatfield);
+  return os;
+}
+
+BookPipeline::BookPipeline(size_t worker_count, size_t queue_capacity) {
+  for (size_t i = 0; i < std::max<size_t>(1, worker_count); ++i) {
+    workers_.push_back(std::make_unique<Worker>(queue_capacity));
+  }
+}
+
+void BookPipeline::AddL3OrderBook(const Symbol& symbol, const L3OrderBook& book) {
+  workers_[GetWorkerIndex(symbol)]->l3_books.insert_or_assign(symbol, book);
+}
+
+const OrderBook* BookPipeline::GetOrderBook(const Symbol& symbol) const {
+  const auto& books = workers_[GetWorkerIndex(symbol)]->books;
+  const auto it = books.find(symbol);
+  return it == books.end() ? nullptr : &it->second;
+}
+
+const L3OrderBook* BookPipeline::GetL3OrderBook(const Symbol& symbol) const {
+  const auto& books = workers_[GetWorkerIndex(symbol)]->l3_books;
+  const auto it = books.find(symbol);
+  return it == books.end() ? nullptr : &it->second;
+}
+
+void BookPipeline::Apply(Worker& worker, const MessageRecord& record, IEXMessage& msg) {
+  // An exception escaping a worker thread would terminate the process.
+  try {
+    if (record.GetType() == MessageType::PriceLevelUpdateBuy ||
+        record.GetType() == MessageType::PriceLevelUpdateSell) {
+      FromMessageRecord(record, msg);
+      worker.books[record.symbol].ProcessMessage(msg);
+      return;
+    }
+    const auto it = worker.l3_books.find(record.symbol);
+    if (it != worker.l3_books.end()) {
+      FromMessageRecord(record, msg);
+      it->second.ProcessMessage(msg);
+    }
+  } catch (const std::exception& e) {
+    if (worker.stats.errors++ == 0) {
+      IEX_LOG("Book update for " << record.symbol << " failed: " << e.what());
+    }
+  }
+}
+
+void BookPipeline::WorkerLoop(Worker& worker) {
+  MessageRecord record;
+  IEXMessage msg;
+  while (true) {
+    if (!worker.queue.TryPop(record)) {
+      // Anything pushed before done was set is visible to the pop that follows reading it.
+      const bool done = worker.done.load(std::memory_order_acquire);
+      if (!worker.queue.TryPop(record)) {
+        if (done) {
+          return;
+        }
+        ++worker.stats.stalls;
+        std::this_thread::yield();
+        continue;
+      }
+    }
+    // Time whole batches, a clock read per record would cost more than most updates.
+    const auto start = Clock::now();
+    do {
+      Apply(worker, record, msg);
+      ++worker.stats.records;
+    } while (worker.queue.TryPop(record));
+    worker.stats.busy_seconds += SecondsSince(start);
+  }
+}
+
+void BookPipeline::Push(Worker& worker, const MessageRecord& record) {
+  while (!worker.queue.TryPush(record)) {
+    ++stats_.decoder.stalls;
+    std::this_thread::yield();
+  }
+  if (++worker.pushed % occupancy_sample_interval == 0) {
+    const size_t occupancy = worker.queue.Size();
+    worker.occupancy_sum += occupancy;
+    ++worker.occupancy_samples;
+    worker.max_occupancy = std::max(worker.max_occupancy, occupancy);
+  }
+}
+
+ReturnCode BookPipeline::Run(IEXDecoder& decoder) {
+  stats_ = PipelineStats();
+  for (auto& worker : workers_) {
+    worker->done.store(false, std::memory_order_relaxed);
+    worker->stats = PipelineStats::Stage();
+    worker->pushed = worker->occupancy_sum = worker->occupancy_samples = 0;
+    worker->max_occupancy = 0;
+    worker->thread = std::thread(&BookPipeline::WorkerLoop, std::ref(*worker));
+  }
+
+  const auto start = Clock::now();
+  IEXMessage msg;
+  MessageRecord record;
+  ReturnCode ret_code;
+  while ((ret_code = decoder.GetNextMessage(msg)) == ReturnCode::Success) {
+    ++stats_.messages;
+    if (ToMessageRecord(msg, record)) {
+      Push(*workers_[GetWorkerIndex(record.symbol)], record);
+      ++stats_.decoder.records;
+    }
+  }
+  stats_.decoder.busy_seconds = SecondsSince(start);
+
+  for (auto& worker : workers_) {
+    worker->done.store(true, std::memory_order_release);
+  }
+  for (auto& worker : workers_) {
+    worker->thread.join();
+    stats_.workers.push_back(worker->stats);
+    PipelineStats::Queue queue;
+    queue.capacity = worker->queue.Capacity();
+    queue.max_occupancy = worker->max_occupancy;
+    if (worker->occupancy_samples > 0) {
+      queue.mean_occupancy =
+          static_cast<double>(worker->occupancy_sum) / worker->occupancy_samples;
+    }
+    stats_.queues.push_back(queue);
+  }
+  stats_.elapsed_seconds = SecondsSince(start);
+  return ret_code;
+}
@@ -0,0 +1,214 @@
+#include "checkpoint.h"
+#include "snapshot_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <zlib.h>
+
+namespace {
+
+// The last character is the format version, bumped whenever a book snapshot changes layout.
+constexpr char checkpoint_magic[8] = {'I', 'E', 'X', 'C', 'K', 'P', 'T', '2'};
+
+/// \brief Book data larger than this is not a checkpoint of ours.
+constexpr uint64_t max_books_len = uint64_t{1} << 36;
+
+/// \brief Books in symbol order, so equal books give equal data.
+template <typename Book>
+std::vector<std::pair<Symbol, const Book*>> SortBySymbol(
+    const std::unordered_map<Symbol, Book>& books) {
+  std::vector<std::pair<Symbol, const Book*>> sorted;
+  sorted.reserve(books.size());
+  for (const auto& entry : books) {
+    sorted.emplace_back(entry.first, &entry.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+    return a.first.GetPacked() < b.first.GetPacked();
+  });
+  return sorted;
+}
+
+}  // namespace
+
+void SaveBooks(const std::unordered_map<Symbol, OrderBook>& books,
+               const std::unordered_map<Symbol, L3OrderBook>& l3_books, std::string& data) {
+  std::ostringstream out(std::ios::binary);
+  snapshot_io::Write<uint64_t>(out, books.size());
+  for (const auto& entry : SortBySymbol(books)) {
+    snapshot_io::Write<uint64_t>(out, entry.first.GetPacked());
+    entry.second->SaveSnapshot(out);
+  }
+  snapshot_io::Write<uint64_t>(out, l3_books.size());
+  for (const auto& entry : SortBySymbol(l3_books)) {
+    snapshot_io::Write<uint64_t>(out, entry.first.GetPacked());
+    entry.second->SaveSnapshot(out);
+  }
+  data = out.str();
+}
+
+bool LoadBooks(const std::string& data, std::unordered_map<Symbol, OrderBook>& books,
+               std::unordered_map<Symbol, L3OrderBook>& l3_books) {
+  books.clear();
+  l3_books.clear();
+  std::istringstream in(data, std::ios::binary);
+  uint64_t count = 0;
+  if (!snapshot_io::ReadCount(in, count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t packed = 0;
+    if (!snapshot_io::Read(in, packed) ||
+        !books[Symbol::FromPacked(packed)].LoadSnapshot(in)) {
+      return false;
+    }
+  }
+  if (!snapshot_io::ReadCount(in, count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t packed = 0;
+    if (!snapshot_io::Read(in, packed) ||
+        !l3_books[Symbol::FromPacked(packed)].LoadSnapshot(in)) {
+      return false;
+    }
+  }
+  // Trailing bytes mean the data was not written by SaveBooks.
+  return in.peek() == std::char_traits<char>::eof();
+}
+
+bool SaveCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+  uLongf compressed_len = compressBound(checkpoint.books.size());
+  std::vector<uint8_t> compressed(compressed_len);
+  const auto* books_ptr = reinterpret_cast<const Bytef*>(checkpoint.books.data());
+  if (compress2(compressed.data(), &compressed_len, books_ptr, checkpoint.books.size(),
+                Z_BEST_SPEED) != Z_OK) {
+    IEX_LOG("Failed compressing the checkpoint.");
+    return false;
+  }
+
+  std::ostringstream out(std::ios::binary);
+  out.write(checkpoint_magic, sizeof(checkpoint_magic));
+  const DecoderPosition& position = checkpoint.position;
+  snapshot_io::Write<uint64_t>(out, position.file_offset);
+  snapshot_io::Write<uint64_t>(out, position.block_offset);
+  snapshot_io::Write<uint64_t>(out, position.block_index);
+  snapshot_io::Write<int64_t>(out, position.next_sq_num);
+  snapshot_io::Write<uint8_t>(out, position.in_regular_hours);
+  snapshot_io::Write<uint8_t>(out, position.past_window);
+  snapshot_io::Write<uint32_t>(out, crc32(0, books_ptr, checkpoint.books.size()));
+  snapshot_io::Write<uint64_t>(out, checkpoint.books.size());
+  snapshot_io::Write<uint64_t>(out, compressed_len);
+  const std::string header = out.str();
+
+  return snapshot_io::WriteFileAtomically(
+      path, {header, std::string_view(reinterpret_cast<const char*>(compressed.data()),
+                                      compressed_len)});
+}
+
+bool LoadCheckpoint(const std::string& path, Checkpoint& checkpoint) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    IEX_LOG("Cannot open " + path + ".");
+    return false;
+  }
+  char magic[sizeof(checkpoint_magic)];
+  DecoderPosition& position = checkpoint.position;
+  uint8_t in_regular_hours = 0;
+  uint8_t past_window = 0;
+  uint32_t crc = 0;
+  uint64_t books_len = 0;
+  uint64_t compressed_len = 0;
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 ||
+      !snapshot_io::Read(in, position.file_offset) ||
+      !snapshot_io::Read(in, position.block_offset) ||
+      !snapshot_io::Read(in, position.block_index) ||
+      !snapshot_io::Read(in, position.next_sq_num) || !snapshot_io::Read(in, in_regular_hours) ||
+      !snapshot_io::Read(in, past_window) || !snapshot_io::Read(in, crc) ||
+      !snapshot_io::Read(in, books_len) || !snapshot_io::Read(in, compressed_len) ||
+      books_len > max_books_len || compressed_len > compressBound(books_len)) {
+    IEX_LOG(path + " is not a checkpoint.");
+    return false;
+  }
+  position.in_regular_hours = in_regular_hours != 0;
+  position.past_window = past_window != 0;
+
+  std::vector<uint8_t> compressed(compressed_len);
+  checkpoint.books.resize(books_len);
+  uLongf uncompressed_len = books_len;
+  auto* books_ptr = reinterpret_cast<Bytef*>(&checkpoint.books[0]);
+  if (!in.read(reinterpret_cast<char*>(compressed.data()), compressed_len) ||
+      uncompress(books_ptr, &uncompressed_len, compressed.data(), compressed_len) != Z_OK ||
+      uncompressed_len != books_len || crc32(0, books_ptr, books_len) != crc) {
+    IEX_LOG(path + " is truncated or corrupt.");
+    return false;
+  }
+  return true;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path) : path_(path) {
+  thread_ = std::thread(&CheckpointWriter::WriteLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_one();
+  // The loop writes what is still pending before it exits.
+  thread_.join();
+}
+
+void CheckpointWriter::Submit(Checkpoint checkpoint) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    replaced_count_ += pending_.has_value();
+    pending_ = std::move(checkpoint);
+  }
+  work_cv_.notify_one();
+}
+
+bool CheckpointWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return !pending_ && !writing_; });
+  return !failed_;
+}
+
+uint64_t CheckpointWriter::GetWrittenCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_count_;
+}
+
+uint64_t CheckpointWriter::GetReplacedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return replaced_count_;
+}
+
+void CheckpointWriter::WriteLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this]() { return pending_ || stop_; });
+    if (!pending_) {
+      return;
+    }
+    Checkpoint checkpoint = std::move(*pending_);
+    pending_.reset();
+    writing_ = true;
+
+    lock.unlock();
+    const bool success = SaveCheckpoint(path_, checkpoint);
+    lock.lock();
+
+    writing_ = false;
+    failed_ |= !success;
+    written_count_ += success;
+    if (!pending_) {
+      idle_cv_.notify_all();
+    }
+  }
+}
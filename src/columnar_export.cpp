@@ -0,0 +1,484 @@
+#include "columnar_export.h"
+#include "snapshot_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char table_magic[8] = {'I', 'E', 'X', 'C', 'O', 'L', '0', '1'};
+
+/// \brief Most columns of any table.
+constexpr size_t max_columns = 8;
+
+struct TableSchema {
+  const char* name;
+  std::vector<ColumnInfo> columns;
+};
+
+// Tables in the order of the TableIndex values below.
+const std::vector<TableSchema>& GetSchemas() {
+  static const std::vector<TableSchema> schemas = {
+      {"quote_update",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"flags", ColumnType::UInt8}, {"bid_size", ColumnType::UInt32},
+        {"bid_price", ColumnType::Int64}, {"ask_price", ColumnType::Int64},
+        {"ask_size", ColumnType::UInt32}}},
+      {"trade_report",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"flags", ColumnType::UInt8}, {"size", ColumnType::UInt32},
+        {"price", ColumnType::Int64}, {"trade_id", ColumnType::Int64}}},
+      {"price_level_buy",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"flags", ColumnType::UInt8}, {"size", ColumnType::UInt32},
+        {"price", ColumnType::Int64}}},
+      {"price_level_sell",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"flags", ColumnType::UInt8}, {"size", ColumnType::UInt32},
+        {"price", ColumnType::Int64}}},
+      {"add_order",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"side", ColumnType::UInt8}, {"order_id", ColumnType::Int64},
+        {"size", ColumnType::UInt32}, {"price", ColumnType::Int64}}},
+      {"order_modify",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"flags", ColumnType::UInt8}, {"order_id", ColumnType::Int64},
+        {"size", ColumnType::UInt32}, {"price", ColumnType::Int64}}},
+      {"order_delete",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"order_id", ColumnType::Int64}}},
+      {"order_executed",
+       {{"timestamp", ColumnType::Int64}, {"symbol_id", ColumnType::UInt32},
+        {"sale_condition", ColumnType::UInt8}, {"order_id", ColumnType::Int64},
+        {"size", ColumnType::UInt32}, {"price", ColumnType::Int64},
+        {"trade_id", ColumnType::Int64}}},
+  };
+  return schemas;
+}
+
+enum TableIndex : size_t {
+  QuoteUpdateTable,
+  TradeReportTable,
+  PriceLevelBuyTable,
+  PriceLevelSellTable,
+  AddOrderTable,
+  OrderModifyTable,
+  OrderDeleteTable,
+  OrderExecutedTable,
+  NoTable
+};
+
+/// \brief Flatten a message into the column values of its table.
+///
+/// \return The table of the message, NoTable if it is not exported.
+size_t ToRow(const IEXMessage& msg, SymbolTable& symbols, int64_t* values) {
+  return std::visit(
+      Overloaded{
+          [&](const QuoteUpdateMessage& quote) {
+            const int64_t row[] = {static_cast<int64_t>(quote.timestamp),
+                                   symbols.Intern(quote.symbol),
+                                   quote.flags,
+                                   quote.bid_size,
+                                   quote.bid_price.GetTicks(),
+                                   quote.ask_price.GetTicks(),
+                                   quote.ask_size};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{QuoteUpdateTable};
+          },
+          [&](const TradeReportMessage& trade) {
+            if (trade.GetMessageType() != MessageType::TradeReport) {
+              return size_t{NoTable};
+            }
+            const int64_t row[] = {static_cast<int64_t>(trade.timestamp),
+                                   symbols.Intern(trade.symbol),
+                                   trade.flags,
+                                   trade.size,
+                                   trade.price.GetTicks(),
+                                   trade.trade_id};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{TradeReportTable};
+          },
+          [&](const PriceLevelUpdateMessage& update) {
+            const int64_t row[] = {static_cast<int64_t>(update.timestamp),
+                                   symbols.Intern(update.symbol), update.flags, update.size,
+                                   update.price.GetTicks()};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{update.GetMessageType() == MessageType::PriceLevelUpdateBuy
+                              ? PriceLevelBuyTable
+                              : PriceLevelSellTable};
+          },
+          [&](const AddOrderMessage& add_order) {
+            const int64_t row[] = {static_cast<int64_t>(add_order.timestamp),
+                                   symbols.Intern(add_order.symbol),
+                                   static_cast<uint8_t>(add_order.side),
+                                   static_cast<int64_t>(add_order.order_id),
+                                   add_order.size,
+                                   add_order.price.GetTicks()};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{AddOrderTable};
+          },
+          [&](const OrderModifyMessage& modify_order) {
+            const int64_t row[] = {static_cast<int64_t>(modify_order.timestamp),
+                                   symbols.Intern(modify_order.symbol),
+                                   static_cast<uint8_t>(modify_order.flags),
+                                   static_cast<int64_t>(modify_order.order_id_ref),
+                                   modify_order.size,
+                                   modify_order.price.GetTicks()};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{OrderModifyTable};
+          },
+          [&](const OrderDeleteMessage& delete_order) {
+            const int64_t row[] = {static_cast<int64_t>(delete_order.timestamp),
+                                   symbols.Intern(delete_order.symbol),
+                                   static_cast<int64_t>(delete_order.order_id_ref)};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{OrderDeleteTable};
+          },
+          [&](const OrderExecutedMessage& executed_order) {
+            const int64_t row[] = {static_cast<int64_t>(executed_order.timestamp),
+                                   symbols.Intern(executed_order.symbol),
+                                   static_cast<uint8_t>(executed_order.sale_condition),
+                                   static_cast<int64_t>(executed_order.order_id_ref),
+                                   executed_order.size,
+                                   executed_order.price.GetTicks(),
+                                   static_cast<int64_t>(executed_order.trade_id)};
+            std::copy(std::begin(row), std::end(row), values);
+            return size_t{OrderExecutedTable};
+          },
+          [&](const SecurityDirectoryMessage& directory) {
+            symbols.AddSecurity(directory);
+            return size_t{NoTable};
+          },
+          [](const auto&) { return size_t{NoTable}; }},
+      msg);
+}
+
+std::string GetColumnPath(const std::string& prefix, const std::string& column) {
+  return prefix + "." + column + ".col";
+}
+
+template <typename T>
+void AppendValue(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadValue(std::ifstream& in, T& value) {
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+}  // namespace
+
+/// \brief Buffers of the current row group of one table and the files its columns go to.
+struct ColumnarWriter::Table {
+  struct Column {
+    ColumnInfo info;
+    std::ofstream file;
+    std::vector<uint8_t> buffer;
+    int64_t min;
+    int64_t max;
+  };
+
+  std::string path_prefix;
+  std::vector<Column> columns;
+  std::vector<RowGroup> row_groups;
+  uint64_t row_count = 0;
+  size_t group_rows = 0;
+
+  bool Open(const std::string& prefix, const TableSchema& schema, size_t row_group_rows) {
+    path_prefix = prefix;
+    columns.resize(schema.columns.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+      Column& column = columns[i];
+      column.info = schema.columns[i];
+      column.buffer.reserve(row_group_rows * GetColumnWidth(column.info.type));
+      const std::string path = GetColumnPath(path_prefix, column.info.name);
+      column.file.open(path, std::ios::binary | std::ios::trunc);
+      if (!column.file) {
+        IEX_LOG("Cannot open " + path + " for writing.");
+        return false;
+      }
+    }
+    ResetStatistics();
+    return true;
+  }
+
+  void ResetStatistics() {
+    for (auto& column : columns) {
+      column.min = std::numeric_limits<int64_t>::max();
+      column.max = std::numeric_limits<int64_t>::min();
+    }
+  }
+
+  void AppendRow(const int64_t* values) {
+    for (size_t i = 0; i < columns.size(); ++i) {
+      Column& column = columns[i];
+      const int64_t value = values[i];
+      column.min = std::min(column.min, value);
+      column.max = std::max(column.max, value);
+      // Little endian, the low bytes of the value are the narrower encodings.
+      const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+      column.buffer.insert(column.buffer.end(), bytes,
+                           bytes + GetColumnWidth(column.info.type));
+    }
+    ++group_rows;
+  }
+
+  bool FlushRowGroup() {
+    if (group_rows == 0) {
+      return true;
+    }
+    RowGroup group{row_count, group_rows, {}, {}};
+    bool success = true;
+    for (auto& column : columns) {
+      group.min.push_back(column.min);
+      group.max.push_back(column.max);
+      column.file.write(reinterpret_cast<const char*>(column.buffer.data()),
+                        column.buffer.size());
+      success = success && static_cast<bool>(column.file);
+      column.buffer.clear();
+    }
+    row_groups.push_back(std::move(group));
+    row_count += group_rows;
+    group_rows = 0;
+    ResetStatistics();
+    if (!success) {
+      IEX_LOG("Failed writing the columns of " + path_prefix + ".");
+    }
+    return success;
+  }
+
+  bool WriteMetadata() const {
+    std::string meta(table_magic, sizeof(table_magic));
+    AppendValue<uint32_t>(meta, columns.size());
+    for (const auto& column : columns) {
+      AppendValue<uint8_t>(meta, static_cast<uint8_t>(column.info.type));
+      AppendValue<uint8_t>(meta, column.info.name.size());
+      meta += column.info.name;
+    }
+    AppendValue<uint64_t>(meta, row_groups.size());
+    for (const auto& group : row_groups) {
+      AppendValue(meta, group.first_row);
+      AppendValue(meta, group.row_count);
+      for (size_t i = 0; i < columns.size(); ++i) {
+        AppendValue(meta, group.min[i]);
+        AppendValue(meta, group.max[i]);
+      }
+    }
+    return snapshot_io::WriteFileAtomically(path_prefix + ".meta", {meta});
+  }
+};
+
+ColumnarWriter::ColumnarWriter(size_t row_group_rows)
+    : row_group_rows_(std::max<size_t>(1, row_group_rows)) {}
+
+ColumnarWriter::~ColumnarWriter() { Close(); }
+
+bool ColumnarWriter::Open(const std::string& directory) {
+  Close();
+  if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    IEX_LOG("Cannot create directory " + directory + ": " << std::strerror(errno));
+    return false;
+  }
+  directory_ = directory;
+  symbols_ = SymbolTable();
+  row_count_ = 0;
+  failed_ = false;
+  for (const auto& schema : GetSchemas()) {
+    tables_.push_back(std::make_unique<Table>());
+    if (!tables_.back()->Open(directory_ + "/" + schema.name, schema, row_group_rows_)) {
+      tables_.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ColumnarWriter::Write(const IEXMessage& msg) {
+  int64_t values[max_columns];
+  const size_t table_index = ToRow(msg, symbols_, values);
+  if (table_index == NoTable) {
+    return true;
+  }
+  Table& table = *tables_[table_index];
+  table.AppendRow(values);
+  ++row_count_;
+  if (table.group_rows == row_group_rows_ && !table.FlushRowGroup()) {
+    failed_ = true;
+  }
+  return !failed_;
+}
+
+ReturnCode ColumnarWriter::WriteAll(IEXDecoder& decoder) {
+  if (tables_.empty()) {
+    IEX_LOG("The writer has not been opened yet, call Open first.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  IEXMessage msg;
+  ReturnCode ret_code;
+  while ((ret_code = decoder.GetNextMessage(msg)) == ReturnCode::Success) {
+    if (!Write(msg)) {
+      return ReturnCode::FailedWriting;
+    }
+  }
+  return ret_code;
+}
+
+bool ColumnarWriter::Close() {
+  if (tables_.empty()) {
+    return true;
+  }
+  bool success = !failed_;
+  for (auto& table : tables_) {
+    success = table->FlushRowGroup() && success;
+    for (auto& column : table->columns) {
+      column.file.close();
+    }
+    success = table->WriteMetadata() && success;
+  }
+  std::string symbols;
+  for (size_t id = 0; id < symbols_.Size(); ++id) {
+    AppendValue(symbols, symbols_.GetSymbol(id).GetPacked());
+  }
+  success = snapshot_io::WriteFileAtomically(directory_ + "/symbols.col", {symbols}) && success;
+  tables_.clear();
+  return success;
+}
+
+bool ColumnarTable::Open(const std::string& directory, const std::string& table) {
+  Close();
+  path_prefix_ = directory + "/" + table;
+  const std::string path = path_prefix_ + ".meta";
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    IEX_LOG("Cannot open " + path + " for reading.");
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  const std::streamoff file_len = in.tellg();
+  in.seekg(0);
+  // Counts and lengths read from the file are checked against the bytes left before allocating.
+  auto remaining = [&in, file_len]() -> uint64_t {
+    const std::streamoff pos = in.tellg();
+    return pos < 0 || pos > file_len ? 0 : static_cast<uint64_t>(file_len - pos);
+  };
+
+  char magic[sizeof(table_magic)];
+  uint32_t column_count = 0;
+  in.read(magic, sizeof(magic));
+  if (!ReadValue(in, column_count) || std::memcmp(magic, table_magic, sizeof(magic)) != 0) {
+    IEX_LOG(path + " is not a columnar table.");
+    return false;
+  }
+  // Every column takes at least its type and name length bytes.
+  if (column_count > remaining() / 2) {
+    IEX_LOG(path + " is corrupt, it cannot hold " << column_count << " columns.");
+    return false;
+  }
+  columns_.resize(column_count);
+  for (auto& column : columns_) {
+    uint8_t type = 0;
+    uint8_t name_len = 0;
+    if (!ReadValue(in, type) || !ReadValue(in, name_len) || name_len > remaining()) {
+      IEX_LOG(path + " is truncated.");
+      Close();
+      return false;
+    }
+    column.type = static_cast<ColumnType>(type);
+    column.name.resize(name_len);
+    in.read(&column.name[0], name_len);
+  }
+  uint64_t group_count = 0;
+  ReadValue(in, group_count);
+  const uint64_t group_len = 2 * sizeof(uint64_t) + 2 * sizeof(int64_t) * column_count;
+  if (in && group_count > remaining() / group_len) {
+    IEX_LOG(path + " is corrupt, it cannot hold " << group_count << " row groups.");
+    Close();
+    return false;
+  }
+  row_groups_.reserve(group_count);
+  for (uint64_t i = 0; in && i < group_count; ++i) {
+    RowGroup group{0, 0, std::vector<int64_t>(column_count), std::vector<int64_t>(column_count)};
+    ReadValue(in, group.first_row);
+    ReadValue(in, group.row_count);
+    for (uint32_t c = 0; c < column_count; ++c) {
+      ReadValue(in, group.min[c]);
+      ReadValue(in, group.max[c]);
+    }
+    row_count_ += group.row_count;
+    row_groups_.push_back(std::move(group));
+  }
+  if (!in) {
+    IEX_LOG(path + " is truncated.");
+    Close();
+    return false;
+  }
+  mappings_.assign(column_count, nullptr);
+  return true;
+}
+
+void ColumnarTable::Close() {
+  for (size_t i = 0; i < mappings_.size(); ++i) {
+    if (mappings_[i]) {
+      ::munmap(mappings_[i], row_count_ * GetColumnWidth(columns_[i].type));
+    }
+  }
+  mappings_.clear();
+  columns_.clear();
+  row_groups_.clear();
+  row_count_ = 0;
+}
+
+size_t ColumnarTable::FindColumn(const std::string& name) const {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].name == name) {
+      return i;
+    }
+  }
+  return no_column;
+}
+
+std::vector<size_t> ColumnarTable::FindRowGroups(size_t column, int64_t min, int64_t max) const {
+  std::vector<size_t> groups;
+  if (column >= columns_.size()) {
+    return groups;
+  }
+  for (size_t i = 0; i < row_groups_.size(); ++i) {
+    if (row_groups_[i].max[column] >= min && row_groups_[i].min[column] <= max) {
+      groups.push_back(i);
+    }
+  }
+  return groups;
+}
+
+const void* ColumnarTable::MapColumn(size_t column) {
+  if (mappings_[column] || row_count_ == 0) {
+    return mappings_[column];
+  }
+  const std::string path = GetColumnPath(path_prefix_, columns_[column].name);
+  const size_t len = row_count_ * GetColumnWidth(columns_[column].type);
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    IEX_LOG("Cannot open " + path + " for reading.");
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < len) {
+    IEX_LOG(path + " is shorter than its metadata says.");
+    ::close(fd);
+    return nullptr;
+  }
+  void* map = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    IEX_LOG("Cannot map " + path + ".");
+    return nullptr;
+  }
+  mappings_[column] = map;
+  return map;
+}
@@ -0,0 +1,35 @@
+#include <iostream>
+#include <string>
+
+#include "columnar_export.h"
+#include "iex_decoder.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: columnar_export <input_pcap> <output_directory>" << std::endl;
+        return 1;
+    }
+
+    IEXDecoder decoder;
+    if (!decoder.OpenFileForDecoding(argv[1])) {
+        std::cout << "Failed to open file '" << argv[1] << "'." << std::endl;
+        return 1;
+    }
+
+    ColumnarWriter writer;
+    if (!writer.Open(argv[2])) {
+        std::cout << "Failed to create output directory '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+
+    const ReturnCode ret_code = writer.WriteAll(decoder);
+    if (ret_code != ReturnCode::EndOfStream) {
+        std::cout << "Export stopped early: " << ReturnCodeToString(ret_code) << std::endl;
+    }
+    if (!writer.Close()) {
+        std::cout << "Failed to finish writing '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+    std::cout << "Exported " << writer.GetRowCount() << " rows to " << argv[2] << "." << std::endl;
+    return 0;
+}
@@ -0,0 +1,335 @@
+#include "compressed_pcap_source.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+#ifdef IEX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr uint8_t gzip_magic[] = {0x1f, 0x8b};
+constexpr uint8_t zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+/// \brief Largest captured length accepted when the file header gives none, as in libpcap.
+constexpr uint32_t max_snaplen = 262144;
+
+enum class Compression { None, Gzip, Zstd };
+
+/// \brief Tell the compression format of a file from its magic bytes.
+Compression DetectCompression(const std::string& filename) {
+  uint8_t magic[4] = {0, 0, 0, 0};
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    return Compression::None;
+  }
+  const size_t read = std::fread(magic, 1, sizeof(magic), file);
+  std::fclose(file);
+  if (read >= sizeof(gzip_magic) && std::memcmp(magic, gzip_magic, sizeof(gzip_magic)) == 0) {
+    return Compression::Gzip;
+  }
+  if (read >= sizeof(zstd_magic) && std::memcmp(magic, zstd_magic, sizeof(zstd_magic)) == 0) {
+    return Compression::Zstd;
+  }
+  return Compression::None;
+}
+
+/// \brief Reads gzip files, including files made of several concatenated gzip members.
+class GzipReader : public CompressedPcapSource::Reader {
+ public:
+  ~GzipReader() override {
+    if (file_) {
+      gzclose(file_);
+    }
+  }
+
+  bool Open(const std::string& filename) {
+    file_ = gzopen(filename.c_str(), "rb");
+    if (!file_) {
+      return false;
+    }
+    gzbuffer(file_, 1 << 20);
+    return true;
+  }
+
+  long Read(uint8_t* dst, size_t len) override {
+    const int read = gzread(file_, dst, static_cast<unsigned>(std::min<size_t>(len, 1 << 30)));
+    if (read == 0) {
+      // zlib reports a file cut off inside a member as Z_BUF_ERROR and still returns 0.
+      int error = Z_OK;
+      const char* message = gzerror(file_, &error);
+      if (error != Z_OK) {
+        IEX_LOG("gzip decompression failed: " << message);
+        return -1;
+      }
+    }
+    return read;
+  }
+
+ private:
+  gzFile file_ = nullptr;
+};
+
+#ifdef IEX_HAVE_ZSTD
+/// \brief Reads zstd files with the streaming decompression API.
+class ZstdReader : public CompressedPcapSource::Reader {
+ public:
+  ~ZstdReader() override {
+    if (stream_) {
+      ZSTD_freeDStream(stream_);
+    }
+    if (file_) {
+      std::fclose(file_);
+    }
+  }
+
+  bool Open(const std::string& filename) {
+    file_ = std::fopen(filename.c_str(), "rb");
+    if (!file_) {
+      return false;
+    }
+    stream_ = ZSTD_createDStream();
+    ZSTD_initDStream(stream_);
+    in_buffer_.resize(ZSTD_DStreamInSize());
+    input_ = {in_buffer_.data(), 0, 0};
+    return true;
+  }
+
+  long Read(uint8_t* dst, size_t len) override {
+    ZSTD_outBuffer output = {dst, len, 0};
+    while (output.pos < output.size) {
+      if (input_.pos == input_.size && !end_of_file_) {
+        const size_t read = std::fread(in_buffer_.data(), 1, in_buffer_.size(), file_);
+        end_of_file_ = read == 0;
+        input_.size = read;
+        input_.pos = 0;
+      }
+      const size_t output_before = output.pos;
+      const size_t input_before = input_.pos;
+      const size_t ret = ZSTD_decompressStream(stream_, &output, &input_);
+      if (ZSTD_isError(ret)) {
+        IEX_LOG("zstd decompression failed: " << ZSTD_getErrorName(ret));
+        return -1;
+      }
+      if (output.pos != output_before || input_.pos != input_before) {
+        frame_complete_ = ret == 0;
+      } else if (end_of_file_) {
+        // Everything is flushed, the file must not end inside a frame.
+        if (!frame_complete_) {
+          IEX_LOG("zstd stream is truncated in the middle of a frame.");
+          return -1;
+        }
+        break;
+      }
+    }
+    return static_cast<long>(output.pos);
+  }
+
+ private:
+  std::FILE* file_ = nullptr;
+  ZSTD_DStream* stream_ = nullptr;
+  std::vector<uint8_t> in_buffer_;
+  ZSTD_inBuffer input_;
+  bool end_of_file_ = false;
+  bool frame_complete_ = false;
+};
+#endif
+
+}  // namespace
+
+CompressedPcapSource::CompressedPcapSource(size_t chunk_size, size_t chunk_count)
+    : ring_(chunk_count), chunk_size_(chunk_size) {}
+
+bool CompressedPcapSource::IsCompressed(const std::string& filename) {
+  return DetectCompression(filename) != Compression::None;
+}
+
+bool CompressedPcapSource::Open(const std::string& filename) {
+  Close();
+
+  const Compression compression = DetectCompression(filename);
+  if (compression == Compression::Gzip) {
+    auto gzip_reader = new GzipReader();
+    reader_ptr_.reset(gzip_reader);
+    if (!gzip_reader->Open(filename)) {
+      IEX_LOG("Cannot open " + filename + " for reading.");
+      reader_ptr_.reset();
+      return false;
+    }
+  } else if (compression == Compression::Zstd) {
+#ifdef IEX_HAVE_ZSTD
+    auto zstd_reader = new ZstdReader();
+    reader_ptr_.reset(zstd_reader);
+    if (!zstd_reader->Open(filename)) {
+      IEX_LOG("Cannot open " + filename + " for reading.");
+      reader_ptr_.reset();
+      return false;
+    }
+#else
+    IEX_LOG(filename + " is zstd compressed, but this library was built without zstd support.");
+    return false;
+#endif
+  } else {
+    IEX_LOG(filename + " cannot be read or is neither gzip nor zstd compressed.");
+    return false;
+  }
+
+  for (auto& chunk : ring_) {
+    chunk.data.resize(chunk_size_);
+    chunk.len = 0;
+    chunk.full = false;
+  }
+  produced_ = 0;
+  consumed_ = 0;
+  end_of_stream_ = false;
+  decompress_error_ = false;
+  stop_ = false;
+  chunk_ptr_ = nullptr;
+  chunk_pos_ = 0;
+  decompress_thread_ = std::thread(&CompressedPcapSource::DecompressLoop, this);
+
+  const uint8_t* file_header = GetBytes(pcap_file_header_len);
+  uint32_t snaplen = 0;
+  if (!file_header ||
+      !ParsePcapFileHeader(file_header, pcap_file_header_len, link_type_, swapped_, snaplen)) {
+    IEX_LOG(filename + " does not contain a classic pcap file.");
+    Close();
+    return false;
+  }
+  max_caplen_ = snaplen > 0 && snaplen < max_snaplen ? snaplen : max_snaplen;
+  return true;
+}
+
+void CompressedPcapSource::Close() {
+  if (decompress_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    chunk_released_.notify_all();
+    decompress_thread_.join();
+  }
+  reader_ptr_.reset();
+  chunk_ptr_ = nullptr;
+}
+
+void CompressedPcapSource::DecompressLoop() {
+  for (size_t produced = 0;; ++produced) {
+    Chunk& chunk = ring_[produced % ring_.size()];
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      chunk_released_.wait(lock, [&] { return !chunk.full || stop_; });
+      if (stop_) {
+        return;
+      }
+    }
+
+    // Fill the buffer without holding the lock, the consumer does not touch buffers that are not
+    // marked full.
+    size_t len = 0;
+    bool error = false;
+    while (len < chunk_size_) {
+      const long read = reader_ptr_->Read(chunk.data.data() + len, chunk_size_ - len);
+      if (read <= 0) {
+        error = read < 0;
+        break;
+      }
+      len += static_cast<size_t>(read);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunk.len = len;
+    if (len > 0) {
+      chunk.full = true;
+      ++produced_;
+    }
+    // The buffer is only left short at the end of the stream.
+    if (len < chunk_size_) {
+      end_of_stream_ = true;
+      decompress_error_ = error;
+    }
+    chunk_filled_.notify_one();
+    if (end_of_stream_) {
+      return;
+    }
+  }
+}
+
+bool CompressedPcapSource::NextChunk() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (chunk_ptr_) {
+    chunk_ptr_->full = false;
+    chunk_ptr_ = nullptr;
+    ++consumed_;
+    chunk_released_.notify_one();
+  }
+  chunk_filled_.wait(lock, [&] { return produced_ > consumed_ || end_of_stream_; });
+  if (produced_ == consumed_) {
+    return false;
+  }
+  chunk_ptr_ = &ring_[consumed_ % ring_.size()];
+  chunk_pos_ = 0;
+  return true;
+}
+
+const uint8_t* CompressedPcapSource::GetBytes(size_t n) {
+  // Fast path, the range lies within the current buffer.
+  if (chunk_ptr_ && chunk_pos_ + n <= chunk_ptr_->len) {
+    const uint8_t* bytes = chunk_ptr_->data.data() + chunk_pos_;
+    chunk_pos_ += n;
+    return bytes;
+  }
+
+  // The range straddles buffers, copy it together.
+  spill_.resize(n);
+  size_t filled = 0;
+  while (filled < n) {
+    if (!chunk_ptr_ || chunk_pos_ == chunk_ptr_->len) {
+      if (!NextChunk()) {
+        return nullptr;
+      }
+    }
+    const size_t take = std::min(n - filled, chunk_ptr_->len - chunk_pos_);
+    std::memcpy(spill_.data() + filled, chunk_ptr_->data.data() + chunk_pos_, take);
+    chunk_pos_ += take;
+    filled += take;
+  }
+  return spill_.data();
+}
+
+ReturnCode CompressedPcapSource::GetNextPayload(const uint8_t*& data, size_t& len) {
+  if (!reader_ptr_) {
+    return ReturnCode::ClassNotInitialized;
+  }
+
+  const uint8_t* record_ptr = GetBytes(pcap_record_header_len);
+  if (record_ptr) {
+    uint32_t caplen;
+    std::memcpy(&caplen, record_ptr + 8, sizeof(caplen));
+    if (swapped_) {
+      caplen = __builtin_bswap32(caplen);
+    }
+    // Unlike a mapped file, the stream has no known end to bound the record by.
+    if (caplen > max_caplen_) {
+      IEX_LOG("Record of " << caplen << " bytes exceeds the snapshot length of the capture.");
+      return ReturnCode::FailedParsingPacket;
+    }
+    const uint8_t* frame_ptr = GetBytes(caplen);
+    if (frame_ptr) {
+      if (!GetUdpPayload(frame_ptr, caplen, link_type_, data, len)) {
+        IEX_LOG("Couldn't find a UDP payload for IEX message data.");
+        return ReturnCode::FailedParsingPacket;
+      }
+      return ReturnCode::Success;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (decompress_error_) {
+    IEX_LOG("Decompression failed before the end of the capture.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  return ReturnCode::EndOfStream;
+}
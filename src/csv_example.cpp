@@ -7,10 +7,15 @@
 #include <memory>
 #include <chrono>
 #include <iomanip>
+#include <optional>
 #include <sstream>
+#include "book_listener.h"
+#include "book_manager.h"
 #include "iex_decoder.h"
 #include "iex_messages.h"
+#include "message_merger.h"
 #include "orderbook.h"
+#include "quote_csv_writer.h"
 
 std::string parseBusinessDate(const std::string& filePath) {
     size_t lastSlash = filePath.find_last_of('/');
@@ -41,86 +46,110 @@ uint64_t businessDateToNanosecondsSinceEpoch(const std::string& businessDate) {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()).count();
 }
 
-std::string nanosSinceEpochToTimestamp(int64_t nanos_since_epoch) {
-    auto tp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>(std::chrono::nanoseconds(nanos_since_epoch));
-    std::time_t seconds = std::chrono::system_clock::to_time_t(tp);
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&seconds), "%F %T");
+// Prints every change of the best bid and offer of one symbol, the books themselves print nothing.
+class BboPrinter : public BookListener {
+public:
+    explicit BboPrinter(Symbol symbol) : symbol_(symbol) {}
 
-    auto duration_since_epoch = tp.time_since_epoch();
-    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration_since_epoch) % 1000;
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration_since_epoch) % 1000;
-    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration_since_epoch) % 1000;
-
-    oss << "." << std::setw(3) << std::setfill('0') << milliseconds.count()
-        << std::setw(3) << microseconds.count()
-        << std::setw(3) << nanoseconds.count();
+    void OnBboChange(const Symbol& symbol, const BBO* bbo) override {
+        if (symbol != symbol_) {
+            return;
+        }
+        if (!bbo) {
+            std::cout << "Symbol: " << symbol << ", No Best Bid or Offer available." << std::endl;
+            return;
+        }
+        std::cout << "Symbol: " << symbol << ", Best Bid: " << bbo->getBidSize() << " @ "
+                  << bbo->getBidPrice() << ", Best Ask: " << bbo->getAskSize() << " @ "
+                  << bbo->getAskPrice() << std::endl;
+    }
 
-    return oss.str();
-}
+private:
+    Symbol symbol_;
+};
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cout << "Usage: iex_pcap_decoder <input_pcap>" << std::endl;
+        std::cout << "Usage: iex_pcap_decoder <input_pcap> [<input_pcap> ...]" << std::endl;
         return 1;
     }
 
-    std::ofstream out_stream;
-    try {
-        out_stream.open("quotes.csv");
-    } catch (...) {
-        std::cout << "Exception thrown opening output file." << std::endl;
+    QuoteCsvWriter quote_writer;
+    if (!quote_writer.Open("quotes.csv")) {
+        std::cout << "Failed to open output file." << std::endl;
         return 1;
     }
 
-    out_stream << "Timestamp,Symbol,BidSize,BidPrice,AskSize,AskPrice" << std::endl;
     std::string input_file(argv[1]);
     auto biz_date = parseBusinessDate(input_file);
     auto biz_nano_open = businessDateToNanosecondsSinceEpoch(biz_date);
-    IEXDecoder decoder;
 
-    if (!decoder.OpenFileForDecoding(input_file)) {
-        std::cout << "Failed to open file '" << input_file << "'." << std::endl;
-        return 1;
-    }
-
-    std::vector<std::unique_ptr<IEXMessageBase>> messages;
-    std::unique_ptr<IEXMessageBase> msg_ptr;
-    std::cout << "Starting decoding pcaps.." << std::endl;
-    auto ret_code = decoder.GetNextMessage(msg_ptr);
-    while (ret_code == ReturnCode::Success) {
-        messages.push_back(std::move(msg_ptr));
-        ret_code = decoder.GetNextMessage(msg_ptr);
+    // Captures of the same day, e.g. TOPS and DEEP, are interleaved by timestamp as they are read.
+    std::vector<std::unique_ptr<IEXDecoder>> decoders;
+    MessageMerger merger;
+    for (int i = 1; i < argc; ++i) {
+        decoders.push_back(std::make_unique<IEXDecoder>());
+        if (!decoders.back()->OpenFileForDecoding(argv[i])) {
+            std::cout << "Failed to open file '" << argv[i] << "'." << std::endl;
+            return 1;
+        }
+        merger.AddDecoder(*decoders.back());
     }
-    std::cout << "Decoding pcap is done.." << std::endl;
-    std::sort(messages.begin(), messages.end(), [](const std::unique_ptr<IEXMessageBase>& a, const std::unique_ptr<IEXMessageBase>& b) {
-        return a->timestamp < b->timestamp;
-    });
 
-    std::unordered_map<std::string, OrderBook> order_books;
+    // Books for every symbol, indexed by the dense symbol id and seeded from the security directory.
+    BookManager books;
+    BboPrinter bbo_printer(Symbol("TSLA"));
+    books.SetListener(&bbo_printer);
 
-    for (const auto& message : messages) {
-        auto* msg_base = message.get();
-        std::string symbol = msg_base->GetSymbol();
+    // Every message is handled as soon as it is decoded, nothing is buffered for the whole day.
+    std::cout << "Starting decoding pcaps.." << std::endl;
+    const IEXMessage* message = nullptr;
+    size_t source = 0;
+    while (merger.GetNextMessage(message, source) == ReturnCode::Success) {
+        auto* msg_base = &GetMessageBase(*message);
+        const Symbol symbol = msg_base->GetSymbol();
+
+        if (auto* directory = std::get_if<SecurityDirectoryMessage>(message)) {
+            books.AddSecurity(*directory);
+        }
 
-        if (symbol == "TSLA" || msg_base->GetMessageType() == MessageType::PriceLevelUpdateBuy || msg_base->GetMessageType() == MessageType::PriceLevelUpdateSell) {
-            auto ts = nanosSinceEpochToTimestamp(msg_base->timestamp);
-            out_stream << ts << "," << MessageTypeToString(msg_base->GetMessageType()) << std::endl;
+        // TOPS carries the BBO itself.
+        if (auto* quote = std::get_if<QuoteUpdateMessage>(message)) {
+            quote_writer.WriteQuote(msg_base->timestamp, *quote);
         }
 
         if (msg_base->timestamp >= biz_nano_open) {
-            if (!symbol.empty() && symbol == "TSLA") {
-                auto& ob = order_books[symbol];
-                ob.ProcessMessage(*message);
-
-                double book_pressure = ob.GetBookPressure();
-                std::cout << "Symbol: " << symbol << ", Book Pressure: " << book_pressure << std::endl;
-                ob.PrintOrderBook();
-                ob.PrintBbo();
+            const uint32_t symbol_id = books.ProcessMessage(*message);
+            if (symbol_id == SymbolTable::invalid_id) {
+                continue;
+            }
+            // Only actual changes of the best bid and offer are written out.
+            const auto& ob = books.GetOrderBook(symbol_id);
+            const auto bbo = ob.GetBbo();
+            if (ob.TopOfBookChanged() && bbo) {
+                quote_writer.WriteQuote(msg_base->timestamp, symbol, *bbo);
             }
         }
     }
+    std::cout << "Decoding pcap is done.." << std::endl;
+
+    // The most active books of the day.
+    auto usage = books.GetUsage();
+    std::sort(usage.begin(), usage.end(),
+              [](const BookUsage& a, const BookUsage& b) { return a.updates > b.updates; });
+    size_t total_bytes = 0;
+    for (const auto& entry : usage) {
+        total_bytes += entry.memory_bytes;
+    }
+    std::cout << books.Size() << " books, " << total_bytes / 1024 << " KiB" << std::endl;
+    for (size_t i = 0; i < usage.size() && i < 10; ++i) {
+        std::cout << usage[i].symbol << ": " << usage[i].updates << " updates, "
+                  << usage[i].memory_bytes << " bytes" << std::endl;
+    }
 
-    out_stream.close();
+    if (!quote_writer.Close()) {
+        std::cout << "Failed writing quotes.csv." << std::endl;
+        return 1;
+    }
     return 0;
 }
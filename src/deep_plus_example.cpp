@@ -7,41 +7,15 @@
 #include <memory>
 #include <chrono>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include "book_listener.h"
+#include "book_pipeline.h"
 #include "iex_decoder.h"
 #include "iex_messages.h"
 #include "order.h"
 #include "l3book.h"
 
-std::string parseBusinessDate(const std::string& filePath) {
-    size_t lastSlash = filePath.find_last_of('/');
-    if (lastSlash == std::string::npos) return "";
-    std::string fileName = filePath.substr(lastSlash + 1);
-    size_t underscorePos = fileName.find('_');
-    if (underscorePos == std::string::npos) return "";
-    return fileName.substr(0, underscorePos);
-}
-
-uint64_t businessDateToNanosecondsSinceEpoch(const std::string& businessDate) {
-    if (businessDate.size() != 8) throw std::invalid_argument("Invalid date format. Expected format: YYYYMMDD");
-
-    std::tm tm = {};
-    std::istringstream ss(businessDate);
-    ss >> std::get_time(&tm, "%Y%m%d");
-    if (ss.fail()) throw std::runtime_error("Failed to parse date.");
-
-    tm.tm_hour = 9;
-    tm.tm_min = 30;
-    tm.tm_sec = 0;
-    tm.tm_isdst = -1;
-
-    std::time_t time = std::mktime(&tm);
-    if (time == -1) throw std::runtime_error("Failed to convert to time_t.");
-
-    auto epoch = std::chrono::system_clock::from_time_t(time);
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()).count();
-}
-
 std::string nanosSinceEpochToTimestamp(int64_t nanos_since_epoch) {
     auto tp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>(std::chrono::nanoseconds(nanos_since_epoch));
     std::time_t seconds = std::chrono::system_clock::to_time_t(tp);
@@ -60,6 +34,34 @@ std::string nanosSinceEpochToTimestamp(int64_t nanos_since_epoch) {
     return oss.str();
 }
 
+// Prints executions and trades. The books are updated on pipeline worker threads, hence the lock.
+class ExecutionPrinter : public BookListener {
+public:
+    void OnOrderExecuted(const Symbol& symbol, const Order& order, uint32_t executed_size,
+                         Price price) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::cout << symbol << " executed: ID: " << order.order_id << ", Size: " << executed_size
+                  << ", Price: " << price << ", Remaining: " << order.size << std::endl;
+    }
+
+    void OnTrade(const TradeReportMessage& trade) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::cout << nanosSinceEpochToTimestamp(trade.timestamp) << " " << trade.symbol
+                  << " trade: ID: " << trade.trade_id << ", Size: " << trade.size
+                  << ", Price: " << trade.price << std::endl;
+    }
+
+private:
+    std::mutex mutex_;
+};
+
+// An L3 book with one level per increment from min_price to max_price, both ends included.
+L3OrderBook MakeL3OrderBook(Price min_price, Price max_price, Price increment) {
+    const size_t level_count =
+        static_cast<size_t>((max_price - min_price).GetTicks() / increment.GetTicks()) + 1;
+    return L3OrderBook(level_count, min_price, max_price, increment);
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cout << "Usage: iex_pcap_decoder <input_pcap>" << std::endl;
@@ -76,8 +78,6 @@ int main(int argc, char* argv[]) {
 
     out_stream << "Timestamp,Symbol,BidSize,BidPrice,AskSize,AskPrice" << std::endl;
     std::string input_file(argv[1]);
-    auto biz_date = parseBusinessDate(input_file);
-    auto biz_nano_open = businessDateToNanosecondsSinceEpoch(biz_date);
     IEXDecoder decoder;
 
     if (!decoder.OpenFileForDecoding(input_file)) {
@@ -85,36 +85,26 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    std::vector<std::unique_ptr<IEXMessageBase>> messages;
-    std::unique_ptr<IEXMessageBase> msg_ptr;
+    // Only TSLA and AAPL are processed below, so skip every other symbol before it is decoded.
+    decoder.SetSubscription(Subscription().AddSymbol("TSLA").AddSymbol("AAPL"));
+    // Pre-market segments are skipped on their header, the session is taken from the feed itself.
+    decoder.SetRegularHoursOnly(true);
+
+    // Decoding stays on this thread, the books are built on worker threads as messages arrive.
+    BookPipeline pipeline;
+    ExecutionPrinter execution_printer;
+    L3OrderBook tsla_book = MakeL3OrderBook(Price(100.0), Price(300.0), Price(0.01));
+    tsla_book.SetListener(&execution_printer);
+    pipeline.AddL3OrderBook(Symbol("TSLA"), tsla_book);
+    L3OrderBook aapl_book = MakeL3OrderBook(Price(120.0), Price(180.0), Price(0.05));
+    aapl_book.SetListener(&execution_printer);
+    pipeline.AddL3OrderBook(Symbol("AAPL"), aapl_book);
+    // You can add more entries for other stocks
+
     std::cout << "Starting decoding pcaps.." << std::endl;
-    auto ret_code = decoder.GetNextMessage(msg_ptr);
-    while (ret_code == ReturnCode::Success) {
-        messages.push_back(std::move(msg_ptr));
-        ret_code = decoder.GetNextMessage(msg_ptr);
-    }
+    pipeline.Run(decoder);
     std::cout << "Decoding pcap is done.." << std::endl;
-    std::sort(messages.begin(), messages.end(), [](const std::unique_ptr<IEXMessageBase>& a, const std::unique_ptr<IEXMessageBase>& b) {
-        return a->timestamp < b->timestamp;
-    });
-
-    std::unordered_map<std::string, L3OrderBook> order_books = {
-            {"TSLA", L3OrderBook(20000, 100.0, 300.0, 0.01)},
-            {"AAPL", L3OrderBook(20000, 120.0, 180.0, 0.05)},
-            // You can add more entries for other stocks
-        };
-
-    for (const auto& message : messages) {
-        auto* msg_base = message.get();
-        std::string symbol = msg_base->GetSymbol();
-
-        if (msg_base->timestamp >= biz_nano_open) {
-            if (!symbol.empty() && symbol == "TSLA") {
-                auto& ob = order_books[symbol];
-                ob.ProcessMessage(*message);
-            }
-        }
-    }
+    std::cout << pipeline.GetStats();
 
     out_stream.close();
     return 0;
@@ -0,0 +1,401 @@
+#include "event_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+
+constexpr char log_magic[8] = {'I', 'E', 'X', 'E', 'L', 'O', 'G', '1'};
+
+/// \brief Marks a message stored as raw bytes. Never a message type on the wire.
+constexpr uint8_t raw_marker = 0xFF;
+
+/// \brief Longest message the writer accepts, the IEX-TP block length is 16 bits.
+constexpr size_t max_message_len = 0xFFFF;
+
+/// \brief Upper bound of the encoded length of one message: marker, varint length and data.
+constexpr size_t max_encoded_message_len = 1 + 10 + max_message_len;
+
+constexpr size_t symbol_offset = 10;
+constexpr size_t fields_offset = 18;
+
+/// \brief Wire layout of one message type.
+///
+/// fields describes the bytes after the symbol: '1' a byte stored as is, '4' and '8' a little
+/// endian integer of that width stored as a variable length integer, 'r' four bytes stored as is.
+struct Layout {
+  size_t wire_len = 0;
+  bool has_symbol = false;
+  const char* fields = "";
+};
+
+const std::array<Layout, 256>& GetLayouts() {
+  static const std::array<Layout, 256> layouts = []() {
+    std::array<Layout, 256> table{};
+    const auto set = [&table](MessageType type, size_t wire_len, bool has_symbol,
+                              const char* fields) {
+      table[static_cast<uint8_t>(type)] = Layout{wire_len, has_symbol, fields};
+    };
+    set(MessageType::SystemEvent, 10, false, "");
+    set(MessageType::SecurityDirectory, 31, true, "481");
+    set(MessageType::TradingStatus, 22, true, "r");
+    set(MessageType::OperationalHaltStatus, 18, true, "");
+    set(MessageType::ShortSalePriceTestStatus, 19, true, "1");
+    set(MessageType::QuoteUpdate, 42, true, "4884");
+    set(MessageType::TradeReport, 38, true, "488");
+    set(MessageType::TradeBreak, 38, true, "488");
+    set(MessageType::OfficialPrice, 26, true, "8");
+    set(MessageType::AuctionInformation, 80, true, "48841148888");
+    set(MessageType::PriceLevelUpdateBuy, 30, true, "48");
+    set(MessageType::PriceLevelUpdateSell, 30, true, "48");
+    set(MessageType::SecurityEvent, 18, true, "");
+    set(MessageType::RetailLiquidityIndicator, 18, true, "");
+    set(MessageType::AddOrder, 38, true, "848");
+    set(MessageType::OrderModify, 38, true, "848");
+    set(MessageType::OrderDelete, 26, true, "8");
+    set(MessageType::OrderExecuted, 46, true, "8488");
+    set(MessageType::ClearBook, 18, true, "");
+    return table;
+  }();
+  return layouts;
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && data < end; shift += 7) {
+    const uint8_t byte = *data++;
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+uint64_t LoadInteger(const uint8_t* data, size_t width) {
+  uint64_t value = 0;
+  std::memcpy(&value, data, width);
+  return value;
+}
+
+template <typename T>
+void AppendValue(std::vector<uint8_t>& out, T value) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+}  // namespace
+
+// A block is flushed once it reaches block_size, so it is at most one message longer.
+EventLogWriter::EventLogWriter(size_t block_size)
+    : block_size_(
+          std::clamp<size_t>(block_size, 1, event_log::max_block_size - max_encoded_message_len)) {}
+
+bool EventLogWriter::Open(const std::string& filename) {
+  Close();
+  file_.open(filename, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    IEX_LOG("Cannot open " + filename + " for writing.");
+    return false;
+  }
+  file_.write(log_magic, sizeof(log_magic));
+  failed_ = false;
+  block_.clear();
+  block_.reserve(block_size_ + 128);
+  block_messages_ = 0;
+  last_timestamp_ = 0;
+  symbols_.clear();
+  symbol_ids_.clear();
+  message_count_ = 0;
+  return true;
+}
+
+bool EventLogWriter::Close() {
+  if (!file_.is_open()) {
+    return true;
+  }
+  FlushBlock();
+  file_.close();
+  return !failed_;
+}
+
+bool EventLogWriter::Write(const uint8_t* msg_data_ptr, size_t msg_len) {
+  if (!file_.is_open()) {
+    return false;
+  }
+  if (msg_len == 0) {
+    return !failed_;
+  }
+  if (msg_len > max_message_len) {
+    IEX_LOG("Message of " + std::to_string(msg_len) + " bytes is too long for the event log.");
+    return false;
+  }
+  const Layout& layout = GetLayouts()[msg_data_ptr[0]];
+  if (layout.wire_len == 0 || msg_len != layout.wire_len) {
+    // Unknown type or unexpected length, keep the bytes as they are.
+    block_.push_back(raw_marker);
+    PutVarint(block_, msg_len);
+    block_.insert(block_.end(), msg_data_ptr, msg_data_ptr + msg_len);
+  } else {
+    block_.push_back(msg_data_ptr[0]);
+    block_.push_back(msg_data_ptr[1]);
+    const uint64_t timestamp = LoadInteger(msg_data_ptr + 2, 8);
+    PutVarint(block_, ZigZag(static_cast<int64_t>(timestamp - last_timestamp_)));
+    last_timestamp_ = timestamp;
+
+    const uint8_t* field_ptr = msg_data_ptr + symbol_offset;
+    if (layout.has_symbol) {
+      const Symbol symbol = Symbol::FromWire(field_ptr);
+      const auto inserted = symbol_ids_.emplace(symbol, static_cast<uint32_t>(symbols_.size()));
+      PutVarint(block_, inserted.first->second);
+      if (inserted.second) {
+        symbols_.push_back(symbol);
+        block_.insert(block_.end(), field_ptr, field_ptr + Symbol::length);
+      }
+      field_ptr = msg_data_ptr + fields_offset;
+    }
+    for (const char* field = layout.fields; *field != '\0'; ++field) {
+      switch (*field) {
+        case '1':
+          block_.push_back(*field_ptr++);
+          break;
+        case 'r':
+          block_.insert(block_.end(), field_ptr, field_ptr + 4);
+          field_ptr += 4;
+          break;
+        default: {
+          const size_t width = *field - '0';
+          PutVarint(block_, LoadInteger(field_ptr, width));
+          field_ptr += width;
+          break;
+        }
+      }
+    }
+  }
+  ++block_messages_;
+  ++message_count_;
+  if (block_.size() >= block_size_) {
+    FlushBlock();
+  }
+  return !failed_;
+}
+
+ReturnCode EventLogWriter::WriteAll(IEXDecoder& decoder) {
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  int64_t sq_num = 0;
+  ReturnCode ret_code;
+  while ((ret_code = decoder.GetNextRawMessage(msg_data_ptr, msg_len, sq_num)) ==
+         ReturnCode::Success) {
+    if (!Write(msg_data_ptr, msg_len)) {
+      return ReturnCode::FailedWriting;
+    }
+  }
+  return ret_code;
+}
+
+bool EventLogWriter::FlushBlock() {
+  if (block_messages_ == 0 || failed_) {
+    return !failed_;
+  }
+  uLongf compressed_len = compressBound(block_.size());
+  compressed_.resize(compressed_len);
+  if (compress2(compressed_.data(), &compressed_len, block_.data(), block_.size(),
+                Z_DEFAULT_COMPRESSION) != Z_OK) {
+    IEX_LOG("Failed compressing an event log block.");
+    failed_ = true;
+    return false;
+  }
+  std::vector<uint8_t> header;
+  AppendValue<uint32_t>(header, compressed_len);
+  AppendValue<uint32_t>(header, block_.size());
+  AppendValue<uint32_t>(header, block_messages_);
+  file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+  file_.write(reinterpret_cast<const char*>(compressed_.data()), compressed_len);
+  if (!file_) {
+    IEX_LOG("Failed writing the event log.");
+    failed_ = true;
+  }
+  block_.clear();
+  block_messages_ = 0;
+  return !failed_;
+}
+
+bool EventLogReader::Open(const std::string& filename) {
+  Close();
+  file_.open(filename, std::ios::binary);
+  if (!file_) {
+    IEX_LOG("Cannot open " + filename + " for reading.");
+    return false;
+  }
+  char magic[sizeof(log_magic)];
+  file_.read(magic, sizeof(magic));
+  if (!file_ || std::memcmp(magic, log_magic, sizeof(magic)) != 0) {
+    IEX_LOG(filename + " is not an event log.");
+    Close();
+    return false;
+  }
+  const std::streampos data_start = file_.tellg();
+  file_.seekg(0, std::ios::end);
+  file_size_ = static_cast<uint64_t>(file_.tellg());
+  file_.seekg(data_start);
+  return true;
+}
+
+void EventLogReader::Close() {
+  file_.close();
+  file_.clear();
+  file_size_ = 0;
+  block_.clear();
+  block_pos_ = 0;
+  block_messages_left_ = 0;
+  last_timestamp_ = 0;
+  symbols_.clear();
+}
+
+ReturnCode EventLogReader::ReadBlock() {
+  uint32_t header[3];
+  file_.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (file_.gcount() == 0 && file_.eof()) {
+    return ReturnCode::EndOfStream;
+  }
+  if (!file_) {
+    IEX_LOG("Truncated event log block header.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  const uint64_t remaining = file_size_ - static_cast<uint64_t>(file_.tellg());
+  if (header[1] > event_log::max_block_size || header[0] > compressBound(header[1]) ||
+      header[0] > remaining) {
+    IEX_LOG("Corrupt event log block header.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  compressed_.resize(header[0]);
+  block_.resize(header[1]);
+  file_.read(reinterpret_cast<char*>(compressed_.data()), compressed_.size());
+  uLongf block_len = block_.size();
+  if (!file_ ||
+      uncompress(block_.data(), &block_len, compressed_.data(), compressed_.size()) != Z_OK ||
+      block_len != block_.size()) {
+    IEX_LOG("Corrupt event log block.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  block_pos_ = 0;
+  block_messages_left_ = header[2];
+  return ReturnCode::Success;
+}
+
+ReturnCode EventLogReader::GetNextRawMessage(const uint8_t*& msg_data_ptr, size_t& msg_len) {
+  if (!file_.is_open()) {
+    IEX_LOG("The reader has not opened a log yet, call Open first.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  while (block_messages_left_ == 0) {
+    const ReturnCode ret_code = ReadBlock();
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+  }
+  --block_messages_left_;
+
+  const uint8_t* data = block_.data() + block_pos_;
+  const uint8_t* const end = block_.data() + block_.size();
+  const auto fail = []() {
+    IEX_LOG("Corrupt event log message.");
+    return ReturnCode::FailedParsingPacket;
+  };
+  if (data >= end) {
+    return fail();
+  }
+  const uint8_t type = *data++;
+  if (type == raw_marker) {
+    uint64_t len = 0;
+    if (!GetVarint(data, end, len) || len > static_cast<uint64_t>(end - data) || len == 0) {
+      return fail();
+    }
+    message_.assign(data, data + len);
+    data += len;
+  } else {
+    const Layout& layout = GetLayouts()[type];
+    uint64_t delta = 0;
+    if (layout.wire_len == 0 || data >= end) {
+      return fail();
+    }
+    message_.assign(layout.wire_len, 0);
+    message_[0] = type;
+    message_[1] = *data++;
+    if (!GetVarint(data, end, delta)) {
+      return fail();
+    }
+    last_timestamp_ += static_cast<uint64_t>(UnZigZag(delta));
+    std::memcpy(&message_[2], &last_timestamp_, 8);
+
+    uint8_t* field_ptr = &message_[symbol_offset];
+    if (layout.has_symbol) {
+      uint64_t id = 0;
+      if (!GetVarint(data, end, id) || id > symbols_.size()) {
+        return fail();
+      }
+      if (id == symbols_.size()) {
+        if (end - data < static_cast<ptrdiff_t>(Symbol::length)) {
+          return fail();
+        }
+        symbols_.push_back(Symbol::FromWire(data));
+        data += Symbol::length;
+      }
+      const uint64_t packed = symbols_[id].GetPacked();
+      std::memcpy(field_ptr, &packed, Symbol::length);
+      field_ptr = &message_[fields_offset];
+    }
+    for (const char* field = layout.fields; *field != '\0'; ++field) {
+      if (*field == '1' || *field == 'r') {
+        const size_t width = *field == '1' ? 1 : 4;
+        if (end - data < static_cast<ptrdiff_t>(width)) {
+          return fail();
+        }
+        std::memcpy(field_ptr, data, width);
+        data += width;
+        field_ptr += width;
+      } else {
+        const size_t width = *field - '0';
+        uint64_t value = 0;
+        if (!GetVarint(data, end, value)) {
+          return fail();
+        }
+        std::memcpy(field_ptr, &value, width);
+        field_ptr += width;
+      }
+    }
+  }
+  block_pos_ = data - block_.data();
+  msg_data_ptr = message_.data();
+  msg_len = message_.size();
+  return ReturnCode::Success;
+}
+
+ReturnCode EventLogReader::GetNextMessage(IEXMessage& msg) {
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  const ReturnCode ret_code = GetNextRawMessage(msg_data_ptr, msg_len);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  return DecodeMessage(msg_data_ptr, msg);
+}
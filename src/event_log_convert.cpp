@@ -0,0 +1,36 @@
+#include <iostream>
+#include <string>
+
+#include "event_log.h"
+#include "iex_decoder.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: event_log_convert <input_pcap> <output_log>" << std::endl;
+        return 1;
+    }
+
+    IEXDecoder decoder;
+    if (!decoder.OpenFileForDecoding(argv[1])) {
+        std::cout << "Failed to open file '" << argv[1] << "'." << std::endl;
+        return 1;
+    }
+
+    EventLogWriter writer;
+    if (!writer.Open(argv[2])) {
+        std::cout << "Failed to create '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+
+    const ReturnCode ret_code = writer.WriteAll(decoder);
+    if (ret_code != ReturnCode::EndOfStream) {
+        std::cout << "Conversion stopped early: " << ReturnCodeToString(ret_code) << std::endl;
+    }
+    if (!writer.Close()) {
+        std::cout << "Failed to finish writing '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << writer.GetMessageCount() << " messages to " << argv[2] << "."
+              << std::endl;
+    return 0;
+}
@@ -1,23 +1,73 @@
 #include "iex_decoder.h"
+#include "compressed_pcap_source.h"
 #include "sale_condition.h"
-#include "Packet.h"
-#include "PayloadLayer.h"
-#include "PcapFileDevice.h"
 
-bool IEXDecoder::OpenFileForDecoding(const std::string& filename) {
-  reader_ptr_.reset(pcpp::IFileReaderDevice::getReader(filename.c_str()));
+#include <algorithm>
 
-  // Check the reader was successfully created.
-  if (reader_ptr_ == NULL) {
-    IEX_LOG("Cannot determine reader for file type\n");
-    return false;
+namespace {
+
+/// \brief Construct a T inside the variant and decode into it.
+template <typename T, typename... Args>
+ReturnCode EmplaceAndDecode(const uint8_t* msg_data_ptr, IEXMessage& msg, Args... args) {
+  if (!msg.emplace<T>(args...).Decode(msg_data_ptr)) {
+    return ReturnCode::FailedDecodingPacket;
   }
+  return ReturnCode::Success;
+}
+
+}  // namespace
+
+ReturnCode DecodeMessage(const uint8_t* msg_data_ptr, IEXMessage& msg) {
+  return DispatchMessageType(msg_data_ptr, [&](auto tag, auto... args) {
+    using T = typename decltype(tag)::type;
+    return EmplaceAndDecode<T>(msg_data_ptr, msg, args...);
+  });
+}
 
-  // Open the reader for reading.
-  if (!reader_ptr_->open()) {
-    IEX_LOG("Cannot open " + filename + " for reading.");
+bool IEXDecoder::OpenSourceForDecoding(std::unique_ptr<PacketSource> source_ptr) {
+  ResetStream();
+  source_ptr_ = std::move(source_ptr);
+  if (!source_ptr_) {
+    IEX_LOG("No packet source given.");
     return false;
   }
+  return true;
+}
+
+void IEXDecoder::ResetStream() {
+  source_ptr_.reset();
+  packet_ptr_ = nullptr;
+  filename_.clear();
+  index_ = PacketIndex();
+  in_regular_hours_ = false;
+  past_window_ = false;
+}
+
+bool IEXDecoder::OpenFileForDecoding(const std::string& filename, ReaderBackend backend) {
+  ResetStream();
+  filename_ = filename;
+
+  if (CompressedPcapSource::IsCompressed(filename)) {
+    // Compressed captures are streamed whatever the requested backend.
+    source_ptr_.reset(new CompressedPcapSource());
+    if (!source_ptr_->Open(filename)) {
+      source_ptr_.reset();
+      return false;
+    }
+  } else if (backend == ReaderBackend::MemoryMapped) {
+    source_ptr_.reset(new MmapPcapSource());
+    if (!source_ptr_->Open(filename)) {
+      IEX_LOG("Falling back to the PcapPlusPlus reader.");
+      source_ptr_.reset();
+    }
+  }
+  if (!source_ptr_) {
+    source_ptr_.reset(new PcapPlusPlusSource());
+    if (!source_ptr_->Open(filename)) {
+      source_ptr_.reset();
+      return false;
+    }
+  }
 
   // After initializing the reader, go ahead and decode the first packet already, this should just
   // contain the header.
@@ -38,28 +88,24 @@ bool IEXDecoder::OpenFileForDecoding(const std::string& filename) {
 }
 
 ReturnCode IEXDecoder::ParseNextPacket(IEXTPHeader& header) {
-  if (!reader_ptr_) {
+  if (!source_ptr_) {
     IEX_LOG("The class has not opened a file for reading yet, call OpenFileForDecoding first.");
     return ReturnCode::ClassNotInitialized;
   }
 
-  // Parse the packet.
-  pcpp::RawPacket raw_packet;
-  if (!reader_ptr_->getNextPacket(raw_packet)) {
-    // IEX_LOG("Packet reader returned no more packets to decode.");
-    return ReturnCode::EndOfStream;
-  };
-  parsed_packet_ = pcpp::Packet(&raw_packet);
-
-  // Extract the payload layer. This is used by IEX for message data.
-  pcpp::PayloadLayer* payload_layer = parsed_packet_.getLayerOfType<pcpp::PayloadLayer>();
-  if (payload_layer == NULL) {
-    printf("Couldn't find a generic payload layer for IEX message data.");
-    return ReturnCode::FailedParsingPacket;
+  // Get the UDP payload of the next packet, this is the IEX-TP segment.
+  auto ret_code = source_ptr_->GetNextPayload(packet_ptr_, packet_len_);
+  if (ret_code != ReturnCode::Success) {
+    packet_ptr_ = nullptr;
+    return ret_code;
   }
-  packet_ptr_ = payload_layer->getData();
-  packet_len_ = payload_layer->getDataLen();
   block_offset_ = first_block_start;
+  block_index_ = 0;
+  if (packet_len_ < first_block_start) {
+    IEX_LOG("Packet is too short to contain an IEX-TP header.");
+    packet_ptr_ = nullptr;
+    return ReturnCode::FailedParsingPacket;
+  }
 
   // Handle header packet.
   bool success = header.Decode(packet_ptr_);
@@ -70,53 +116,381 @@ ReturnCode IEXDecoder::ParseNextPacket(IEXTPHeader& header) {
   return ReturnCode::Success;
 }
 
-ReturnCode IEXDecoder::GetNextMessage(std::unique_ptr<IEXMessageBase>& msg_ptr) {
-  if (!reader_ptr_) {
+ReturnCode IEXDecoder::GetNextBlock(const uint8_t*& msg_data_ptr, size_t& msg_len) {
+  while (true) {
+    auto ret_code = AdvanceBlock(msg_data_ptr, msg_len);
+    if (ret_code != ReturnCode::Success || subscription_.Matches(msg_data_ptr, msg_len)) {
+      return ret_code;
+    }
+  }
+}
+
+ReturnCode IEXDecoder::AdvanceBlock(const uint8_t*& msg_data_ptr, size_t& msg_len) {
+  if (!source_ptr_) {
     IEX_LOG("The class has not opened a file for reading yet, " << "call OpenFileForDecoding first.");
     return ReturnCode::ClassNotInitialized;
   }
 
   // Check if the packet pointer is valid.  If not, the next packet needs to be parsed.
   if (!packet_ptr_) {
-    do {
-      // Parse the next packet.  This reset block_offset_, packet_len and packet_ptr.
-      auto ret_code = ParseNextPacket(last_decoded_header_);
-      if (ret_code != ReturnCode::Success) {
-        return ret_code;
-      }
-      // Sometimes the packet is empty. This is a heartbeat from the server every second
-      // when there are no new messages.  There is nothing to decode so this loop will skip them.
-    } while (last_decoded_header_.payload_len == 0);
+    auto ret_code = GetNextSegment();
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
   }
 
   // Get a pointer to the current block.
   const uint8_t* block_ptr = packet_ptr_ + block_offset_;
 
+  // The length prefix and the block must both lie inside the segment.
+  if (packet_len_ - block_offset_ < 2 || packet_len_ - block_offset_ - 2 < GetBlockSize(block_ptr)) {
+    IEX_LOG("Block " << block_index_ << " runs past the end of its segment.");
+    packet_ptr_ = nullptr;
+    return ReturnCode::FailedParsingPacket;
+  }
+
   // Get the length of current block.
   const int block_len = GetBlockSize(block_ptr);
 
   // Get the pointer to the data within this block.
-  const uint8_t* msg_data_ptr = GetBlockData(block_ptr);
+  msg_data_ptr = GetBlockData(block_ptr);
+  msg_len = block_len;
 
   // Move the block offset to the next block.
   // The +2 is for the two bytes containing the block size not counted in the block length.
   block_offset_ += block_len + 2;
+  ++block_index_;
 
   // If we have gone through the whole packet, reset the pointer.
   if (block_offset_ >= packet_len_) {
     packet_ptr_ = 0;
   }
+  // The end of regular hours is still delivered, everything after it is dropped.
+  if (IsEndOfRegularHours(msg_data_ptr)) {
+    past_window_ = true;
+    packet_ptr_ = nullptr;
+  }
+  return ReturnCode::Success;
+}
 
-  msg_ptr = IEXMessageFactory(msg_data_ptr);
-  if (!msg_ptr) {
-    IEX_LOG("Unknown message type " << PRINTHEX(*msg_data_ptr));
-    IEX_LOG("Block len " << block_len);
-    return ReturnCode::UnknownMessageType;
+ReturnCode IEXDecoder::GetNextSegment() {
+  while (true) {
+    if (past_window_) {
+      packet_ptr_ = nullptr;
+      return ReturnCode::EndOfStream;
+    }
+    // Parse the next packet.  This reset block_offset_, packet_len and packet_ptr.
+    auto ret_code = ParseNextPacket(last_decoded_header_);
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+    // Sometimes the packet is empty. This is a heartbeat from the server every second
+    // when there are no new messages.  There is nothing to decode so this loop will skip them.
+    if (last_decoded_header_.payload_len == 0) {
+      continue;
+    }
+    // Segments outside the time window are dropped on their header alone.
+    if (last_decoded_header_.send_time < window_start_) {
+      continue;
+    }
+    if (last_decoded_header_.send_time >= window_end_) {
+      past_window_ = true;
+      continue;
+    }
+    if (regular_hours_only_ && !in_regular_hours_ && !SkipToStartOfRegularHours()) {
+      continue;
+    }
+    return ReturnCode::Success;
   }
+}
 
-  if (!msg_ptr->Decode(msg_data_ptr)) {
-    return ReturnCode::FailedDecodingPacket;
+bool IEXDecoder::SkipToStartOfRegularHours() {
+  size_t offset = first_block_start;
+  for (size_t index = 0; index < last_decoded_header_.message_count && offset < packet_len_;
+       ++index) {
+    // The length prefix and the block must both lie inside the segment.
+    if (packet_len_ - offset < 2 || packet_len_ - offset - 2 < GetBlockSize(packet_ptr_ + offset)) {
+      IEX_LOG("Block " << index << " runs past the end of its segment.");
+      return false;
+    }
+    const uint16_t block_len = GetBlockSize(packet_ptr_ + offset);
+    const uint8_t* msg_data_ptr = GetBlockData(packet_ptr_ + offset);
+    if (block_len >= 2 && msg_data_ptr[0] == static_cast<uint8_t>(MessageType::SystemEvent) &&
+        msg_data_ptr[1] ==
+            static_cast<uint8_t>(SystemEventMessage::Code::StartOfRegularMarketHours)) {
+      block_offset_ = offset;
+      block_index_ = index;
+      in_regular_hours_ = true;
+      return true;
+    }
+    offset += block_len + 2;
+  }
+  return false;
+}
+
+void IEXDecoder::SetTimeWindow(int64_t start, int64_t end) {
+  window_start_ = start;
+  window_end_ = end;
+  past_window_ = false;
+}
+
+void IEXDecoder::SetRegularHoursOnly(bool regular_hours_only) {
+  regular_hours_only_ = regular_hours_only;
+  in_regular_hours_ = false;
+  past_window_ = false;
+}
+
+ReturnCode IEXDecoder::DecodeBatch(IEXMessage* msgs, size_t capacity, size_t& count) {
+  count = 0;
+  if (!source_ptr_) {
+    IEX_LOG("The class has not opened a file for reading yet, " << "call OpenFileForDecoding first.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  // Nothing could be decoded, a caller looping until the end of the stream would never get there.
+  if (capacity == 0) {
+    IEX_LOG("DecodeBatch needs room for at least one message.");
+    return ReturnCode::InvalidArgument;
+  }
+  if (!packet_ptr_) {
+    auto ret_code = GetNextSegment();
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+  }
+
+  // The header tells how many blocks there are, so the loop needs no per block state checks.
+  const size_t segment_blocks = last_decoded_header_.message_count;
+  const size_t remaining_blocks = segment_blocks - std::min(segment_blocks, block_index_);
+  const uint8_t* block_ptr = packet_ptr_ + block_offset_;
+  const uint8_t* const packet_end = packet_ptr_ + packet_len_;
+  auto ret_code = ReturnCode::Success;
+  size_t consumed = 0;
+  while (consumed < remaining_blocks && count < capacity && block_ptr < packet_end) {
+    // The length prefix and the block must both lie inside the segment.
+    if (packet_end - block_ptr < 2 || packet_end - block_ptr - 2 < GetBlockSize(block_ptr)) {
+      IEX_LOG("Block " << block_index_ + consumed << " runs past the end of its segment.");
+      ret_code = ReturnCode::FailedParsingPacket;
+      block_ptr = packet_end;
+      break;
+    }
+    const uint16_t block_len = GetBlockSize(block_ptr);
+    const uint8_t* msg_data_ptr = GetBlockData(block_ptr);
+    block_ptr += block_len + 2;
+    ++consumed;
+    if (IsEndOfRegularHours(msg_data_ptr)) {
+      past_window_ = true;
+    }
+    if (subscription_.Matches(msg_data_ptr, block_len)) {
+      ret_code = DecodeMessage(msg_data_ptr, msgs[count]);
+      if (ret_code != ReturnCode::Success) {
+        break;
+      }
+      ++count;
+    }
+    if (past_window_) {
+      break;
+    }
+  }
+
+  block_offset_ = block_ptr - packet_ptr_;
+  block_index_ += consumed;
+  if (past_window_ || block_index_ >= segment_blocks || block_offset_ >= packet_len_) {
+    packet_ptr_ = nullptr;
+  }
+  return ret_code;
+}
+
+ReturnCode IEXDecoder::GetNextMessage(std::unique_ptr<IEXMessageBase>& msg_ptr) {
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  auto ret_code = GetNextBlock(msg_data_ptr, msg_len);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+
+  // Decode on the stack as ForEachMessage does, then move the result to the heap.
+  auto to_heap = [&msg_ptr](const auto& msg) {
+    msg_ptr.reset(new std::decay_t<decltype(msg)>(msg));
+  };
+  bool keep_going = true;
+  return DispatchMessage(msg_data_ptr, to_heap, keep_going);
+}
+
+ReturnCode IEXDecoder::GetNextRawMessage(const uint8_t*& msg_data_ptr, size_t& msg_len,
+                                         int64_t& sq_num) {
+  auto ret_code = GetNextBlock(msg_data_ptr, msg_len);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  // block_index_ already counts the block just returned.
+  sq_num = last_decoded_header_.first_msg_sq_num + static_cast<int64_t>(block_index_) - 1;
+  return ReturnCode::Success;
+}
+
+ReturnCode IEXDecoder::GetNextMessage(IEXMessage& msg) {
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  auto ret_code = GetNextBlock(msg_data_ptr, msg_len);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  return DecodeMessage(msg_data_ptr, msg);
+}
+
+ReturnCode IEXDecoder::PrepareIndex(MmapPcapSource*& mmap_source) {
+  mmap_source = dynamic_cast<MmapPcapSource*>(source_ptr_.get());
+  if (!mmap_source || filename_.empty()) {
+    IEX_LOG("Seeking requires a file opened with ReaderBackend::MemoryMapped.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  if (!index_.Empty()) {
+    return ReturnCode::Success;
+  }
+
+  const std::string index_path = PacketIndex::GetSidecarPath(filename_);
+  if (index_.Load(index_path, mmap_source->GetFileSize())) {
+    return ReturnCode::Success;
+  }
+  if (!index_.Build(*mmap_source)) {
+    IEX_LOG("Failed to index " + filename_ + ".");
+    return ReturnCode::FailedParsingPacket;
+  }
+  // Seeking still works without the sidecar, it is just rebuilt on the next open.
+  if (!index_.Save(index_path)) {
+    IEX_LOG("Could not save the index of " + filename_ + ".");
+  }
+  return ReturnCode::Success;
+}
+
+ReturnCode IEXDecoder::GetPosition(DecoderPosition& position) const {
+  const auto* mmap_source = dynamic_cast<const MmapPcapSource*>(source_ptr_.get());
+  if (!mmap_source) {
+    IEX_LOG("Positions require a file opened with ReaderBackend::MemoryMapped.");
+    return ReturnCode::ClassNotInitialized;
   }
+  position = DecoderPosition();
+  position.in_regular_hours = in_regular_hours_;
+  position.past_window = past_window_;
+  if (packet_ptr_) {
+    position.file_offset = mmap_source->GetLastOffset();
+    position.block_offset = block_offset_;
+    position.block_index = block_index_;
+    position.next_sq_num =
+        last_decoded_header_.first_msg_sq_num + static_cast<int64_t>(block_index_);
+    return ReturnCode::Success;
+  }
+
+  // Between segments, the next message is the first of the next segment. Heartbeats carry the
+  // sequence number of the next message as well, so the next record tells it either way.
+  position.file_offset = mmap_source->GetOffset();
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  uint64_t next_offset = 0;
+  IEXTPHeader header;
+  if (mmap_source->GetPayloadAt(position.file_offset, data, len, next_offset) ==
+          ReturnCode::Success &&
+      len >= first_block_start && header.Decode(data)) {
+    position.next_sq_num = header.first_msg_sq_num;
+  }
+  return ReturnCode::Success;
+}
 
+ReturnCode IEXDecoder::RestorePosition(const DecoderPosition& position) {
+  auto* mmap_source = dynamic_cast<MmapPcapSource*>(source_ptr_.get());
+  if (!mmap_source) {
+    IEX_LOG("Positions require a file opened with ReaderBackend::MemoryMapped.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  if (position.file_offset > mmap_source->GetFileSize()) {
+    IEX_LOG("Position is past the end of " + filename_ + ".");
+    return ReturnCode::FailedParsingPacket;
+  }
+  packet_ptr_ = nullptr;
+  in_regular_hours_ = position.in_regular_hours;
+  past_window_ = position.past_window;
+  mmap_source->Seek(position.file_offset);
+  if (position.block_offset == 0) {
+    return ReturnCode::Success;
+  }
+
+  // Reopen the segment the position points into and skip the blocks already consumed.
+  auto ret_code = ParseNextPacket(last_decoded_header_);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  if (position.block_offset < first_block_start || position.block_offset >= packet_len_ ||
+      position.block_index >= last_decoded_header_.message_count ||
+      last_decoded_header_.first_msg_sq_num + static_cast<int64_t>(position.block_index) !=
+          position.next_sq_num) {
+    IEX_LOG("Position does not match a segment of " + filename_ + ".");
+    packet_ptr_ = nullptr;
+    return ReturnCode::FailedParsingPacket;
+  }
+  block_offset_ = position.block_offset;
+  block_index_ = position.block_index;
+  return ReturnCode::Success;
+}
+
+template <typename Predicate>
+ReturnCode IEXDecoder::SeekToSegment(MmapPcapSource& mmap_source, uint64_t offset,
+                                     Predicate is_target) {
+  packet_ptr_ = nullptr;
+  past_window_ = false;
+  IEXTPHeader header;
+  while (true) {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    uint64_t next_offset = 0;
+    const auto ret_code = mmap_source.GetPayloadAt(offset, data, len, next_offset);
+    if (ret_code == ReturnCode::EndOfStream) {
+      mmap_source.Seek(offset);
+      return ret_code;
+    }
+    if (ret_code == ReturnCode::Success && len >= first_block_start && header.Decode(data) &&
+        is_target(header)) {
+      mmap_source.Seek(offset);
+      return ReturnCode::Success;
+    }
+    offset = next_offset;
+  }
+}
+
+ReturnCode IEXDecoder::SeekToTime(int64_t send_time) {
+  MmapPcapSource* mmap_source = nullptr;
+  auto ret_code = PrepareIndex(mmap_source);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  return SeekToSegment(*mmap_source, index_.FindTime(send_time), [&](const IEXTPHeader& header) {
+    return header.message_count > 0 && header.send_time >= send_time;
+  });
+}
+
+ReturnCode IEXDecoder::SeekToSequence(int64_t sq_num) {
+  MmapPcapSource* mmap_source = nullptr;
+  auto ret_code = PrepareIndex(mmap_source);
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  ret_code = SeekToSegment(*mmap_source, index_.FindSequence(sq_num), [&](const IEXTPHeader& header) {
+    return header.message_count > 0 && header.first_msg_sq_num + header.message_count > sq_num;
+  });
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+
+  // Open the segment and skip the blocks before sq_num.
+  ret_code = GetNextSegment();
+  if (ret_code != ReturnCode::Success) {
+    return ret_code;
+  }
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  for (int64_t sq = last_decoded_header_.first_msg_sq_num; sq < sq_num; ++sq) {
+    ret_code = AdvanceBlock(msg_data_ptr, msg_len);
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+  }
   return ReturnCode::Success;
 }
@@ -17,9 +17,9 @@ T GetNumeric(const uint8_t* data_ptr, const int offset) {
 ///
 /// \param data_ptr  Pointer to the data.
 /// \param offset    An offset to first apply to the pointer before dereferencing.
-/// \return The price in dollars, returned as a double.
-double GetPrice(const uint8_t* data_ptr, const int offset) {
-  return *(reinterpret_cast<const int64_t*>(&data_ptr[offset])) / 10000.0;
+/// \return The price in its native fixed point format, 1/10000 dollars.
+Price GetPrice(const uint8_t* data_ptr, const int offset) {
+  return Price::FromTicks(*(reinterpret_cast<const int64_t*>(&data_ptr[offset])));
 }
 
 /// \brief Similar to GetNumeric, however specialized for string data.
@@ -96,7 +96,7 @@ void SystemEventMessage::Print() const {
 bool SecurityDirectoryMessage::Decode(const uint8_t* data_ptr) {
   flags = GetNumeric<uint8_t>(data_ptr, 1);
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   round_lot_size = GetNumeric<uint32_t>(data_ptr, 18);
   adjusted_POC_price = GetPrice(data_ptr, 22);
   LULD_tier = static_cast<LULDTier>(GetNumeric<uint8_t>(data_ptr, 30));
@@ -117,7 +117,7 @@ void SecurityDirectoryMessage::Print() const {
 bool TradingStatusMessage::Decode(const uint8_t* data_ptr) {
   trading_status = static_cast<TradingStatusMessage::Status>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   reason = GetString(data_ptr, 18, 4);
 
   return ValidateTimestamp(timestamp);
@@ -135,7 +135,7 @@ bool OperationalHaltStatusMessage::Decode(const uint8_t* data_ptr) {
   operational_halt_status =
       static_cast<OperationalHaltStatusMessage::Status>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
 
   return ValidateTimestamp(timestamp);
 }
@@ -150,7 +150,7 @@ void OperationalHaltStatusMessage::Print() const {
 bool ShortSalePriceTestStatusMessage::Decode(const uint8_t* data_ptr) {
   short_sale_test_in_effect = static_cast<bool>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   detail = static_cast<Detail>(GetNumeric<uint8_t>(data_ptr, 18));
 
   return ValidateTimestamp(timestamp);
@@ -167,7 +167,7 @@ void ShortSalePriceTestStatusMessage::Print() const {
 bool QuoteUpdateMessage::Decode(const uint8_t* data_ptr) {
   flags = GetNumeric<uint8_t>(data_ptr, 1);
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   bid_size = GetNumeric<uint32_t>(data_ptr, 18);
   bid_price = GetPrice(data_ptr, 22);
   ask_size = GetNumeric<uint32_t>(data_ptr, 38);
@@ -190,7 +190,7 @@ void QuoteUpdateMessage::Print() const {
 bool TradeReportMessage::Decode(const uint8_t* data_ptr) {
   flags = GetNumeric<uint8_t>(data_ptr, 1);
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   size = GetNumeric<uint32_t>(data_ptr, 18);
   price = GetPrice(data_ptr, 22);
   trade_id = GetNumeric<uint64_t>(data_ptr, 30);
@@ -211,7 +211,7 @@ void TradeReportMessage::Print() const {
 bool OfficialPriceMessage::Decode(const uint8_t* data_ptr) {
   price_type = static_cast<PriceType>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   price = GetPrice(data_ptr, 18);
 
   return ValidateTimestamp(timestamp);
@@ -230,7 +230,7 @@ void OfficialPriceMessage::Print() const {
 bool AuctionInformationMessage::Decode(const uint8_t* data_ptr) {
   auction_type = static_cast<AuctionType>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   paired_shares = GetNumeric<uint32_t>(data_ptr, 18);
   reference_price = GetPrice(data_ptr, 22);
   indicative_clearing_price = GetPrice(data_ptr, 30);
@@ -268,7 +268,7 @@ void AuctionInformationMessage::Print() const {
 bool PriceLevelUpdateMessage::Decode(const uint8_t* data_ptr) {
   flags = GetNumeric<uint8_t>(data_ptr, 1);
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
   size = GetNumeric<uint32_t>(data_ptr, 18);
   price = GetPrice(data_ptr, 22);
 
@@ -288,7 +288,7 @@ bool SecurityEventMessage::Decode(const uint8_t* data_ptr) {
   security_event =
       static_cast<SecurityEventMessage::SecurityMessageType>(GetNumeric<uint8_t>(data_ptr, 1));
   timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-  symbol = GetString(data_ptr, 10, 8);
+  symbol = Symbol::FromWire(data_ptr + 10);
 
   return ValidateTimestamp(timestamp);
 }
@@ -301,8 +301,9 @@ void SecurityEventMessage::Print() const {
 }
 
 bool RetailLiquidityIndicatorMessage::Decode(const uint8_t* data_ptr) {
+    retail_liquidity_indicator = static_cast<RetailLiquidityInd>(GetNumeric<uint8_t>(data_ptr, 1));
     timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-    symbol = GetString(data_ptr, 10, 8);
+    symbol = Symbol::FromWire(data_ptr + 10);
     return ValidateTimestamp(timestamp);
 }
 
@@ -310,70 +311,97 @@ void RetailLiquidityIndicatorMessage::Print() const {
     IEX_LOG("Message type      : " << MessageTypeToString(message_type));
     IEX_LOG("Timestamp         : " << timestamp);
     IEX_LOG("Symbol            : " << symbol);
+    IEX_LOG("Indicator         : " << static_cast<char>(retail_liquidity_indicator));
 }
 
 bool AddOrderMessage::Decode(const uint8_t* data_ptr) {
+    side = static_cast<Side>(GetNumeric<uint8_t>(data_ptr, 1));
     timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-    order_id = GetNumeric<uint64_t>(data_ptr, 10);
-    size = GetNumeric<uint32_t>(data_ptr, 18);
-    price = GetPrice(data_ptr, 22);
+    symbol = Symbol::FromWire(data_ptr + 10);
+    order_id = GetNumeric<uint64_t>(data_ptr, 18);
+    size = GetNumeric<uint32_t>(data_ptr, 26);
+    price = GetPrice(data_ptr, 30);
     return ValidateTimestamp(timestamp);
 }
 
 void AddOrderMessage::Print() const {
     IEX_LOG("Message type      : " << MessageTypeToString(message_type));
     IEX_LOG("Timestamp         : " << timestamp);
+    IEX_LOG("Symbol            : " << symbol);
     IEX_LOG("Order ID          : " << order_id);
+    IEX_LOG("Side              : " << static_cast<char>(side));
     IEX_LOG("Size              : " << size);
     IEX_LOG("Price             : " << price);
 }
 
 bool OrderModifyMessage::Decode(const uint8_t* data_ptr) {
+    flags = static_cast<ModifyFlags>(GetNumeric<uint8_t>(data_ptr, 1));
     timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-    order_id_ref = GetNumeric<uint64_t>(data_ptr, 10);
-    size = GetNumeric<uint32_t>(data_ptr, 18);
-    price = GetPrice(data_ptr, 22);
+    symbol = Symbol::FromWire(data_ptr + 10);
+    order_id_ref = GetNumeric<uint64_t>(data_ptr, 18);
+    size = GetNumeric<uint32_t>(data_ptr, 26);
+    price = GetPrice(data_ptr, 30);
     return ValidateTimestamp(timestamp);
 }
 
 void OrderModifyMessage::Print() const {
     IEX_LOG("Message type      : " << MessageTypeToString(message_type));
     IEX_LOG("Timestamp         : " << timestamp);
+    IEX_LOG("Symbol            : " << symbol);
     IEX_LOG("Order ID Ref      : " << order_id_ref);
     IEX_LOG("Size              : " << size);
     IEX_LOG("Price             : " << price);
 }
 
 bool OrderDeleteMessage::Decode(const uint8_t* data_ptr) {
+    reserved1 = GetNumeric<uint8_t>(data_ptr, 1);
     timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-    order_id_ref = GetNumeric<uint64_t>(data_ptr, 10);
+    symbol = Symbol::FromWire(data_ptr + 10);
+    order_id_ref = GetNumeric<uint64_t>(data_ptr, 18);
     return ValidateTimestamp(timestamp);
 }
 
 void OrderDeleteMessage::Print() const {
     IEX_LOG("Message type      : " << MessageTypeToString(message_type));
     IEX_LOG("Timestamp         : " << timestamp);
+    IEX_LOG("Symbol            : " << symbol);
     IEX_LOG("Order ID Ref      : " << order_id_ref);
 }
 
 bool OrderExecutedMessage::Decode(const uint8_t* data_ptr) {
+    sale_condition = static_cast<SaleCondition>(GetNumeric<uint8_t>(data_ptr, 1));
     timestamp = GetNumeric<uint64_t>(data_ptr, 2);
-    order_id_ref = GetNumeric<uint64_t>(data_ptr, 10);
-    size = GetNumeric<uint32_t>(data_ptr, 18);
-    price = GetPrice(data_ptr, 22);
-    trade_id = GetNumeric<uint64_t>(data_ptr, 30);
+    symbol = Symbol::FromWire(data_ptr + 10);
+    order_id_ref = GetNumeric<uint64_t>(data_ptr, 18);
+    size = GetNumeric<uint32_t>(data_ptr, 26);
+    price = GetPrice(data_ptr, 30);
+    trade_id = GetNumeric<uint64_t>(data_ptr, 38);
     return ValidateTimestamp(timestamp);
 }
 
 void OrderExecutedMessage::Print() const {
     IEX_LOG("Message type      : " << MessageTypeToString(message_type));
     IEX_LOG("Timestamp         : " << timestamp);
+    IEX_LOG("Symbol            : " << symbol);
     IEX_LOG("Order ID Ref      : " << order_id_ref);
     IEX_LOG("Size              : " << size);
     IEX_LOG("Price             : " << price);
     IEX_LOG("Trade ID          : " << trade_id);
 }
 
+bool ClearBookMessage::Decode(const uint8_t* data_ptr) {
+    reserved1 = GetNumeric<uint8_t>(data_ptr, 1);
+    timestamp = GetNumeric<uint64_t>(data_ptr, 2);
+    symbol = Symbol::FromWire(data_ptr + 10);
+    return ValidateTimestamp(timestamp);
+}
+
+void ClearBookMessage::Print() const {
+    IEX_LOG("Message type      : " << MessageTypeToString(message_type));
+    IEX_LOG("Timestamp         : " << timestamp);
+    IEX_LOG("Symbol            : " << symbol);
+}
+
 std::unique_ptr<IEXMessageBase> IEXMessageFactory(const uint8_t* msg_data_ptr) {
   int msg_type = *msg_data_ptr;
   auto msg_enum = static_cast<MessageType>(msg_type);
@@ -402,6 +430,18 @@ std::unique_ptr<IEXMessageBase> IEXMessageFactory(const uint8_t* msg_data_ptr) {
       return std::unique_ptr<IEXMessageBase>(new PriceLevelUpdateMessage(msg_enum));
     case MessageType::SecurityEvent:
       return std::unique_ptr<IEXMessageBase>(new SecurityEventMessage(msg_enum));
+    case MessageType::RetailLiquidityIndicator:
+      return std::unique_ptr<IEXMessageBase>(new RetailLiquidityIndicatorMessage());
+    case MessageType::AddOrder:
+      return std::unique_ptr<IEXMessageBase>(new AddOrderMessage());
+    case MessageType::OrderModify:
+      return std::unique_ptr<IEXMessageBase>(new OrderModifyMessage());
+    case MessageType::OrderDelete:
+      return std::unique_ptr<IEXMessageBase>(new OrderDeleteMessage());
+    case MessageType::OrderExecuted:
+      return std::unique_ptr<IEXMessageBase>(new OrderExecutedMessage());
+    case MessageType::ClearBook:
+      return std::unique_ptr<IEXMessageBase>(new ClearBookMessage());
     default:
       return NULL;
   }
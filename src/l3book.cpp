@@ -10,13 +10,16 @@
 #include "iex_messages.h" // Include the necessary headers for message types
 #include "order.h"
 #include "l3book.h"
+#include "book_listener.h"
+#include "snapshot_io.h"
 
 
-size_t L3OrderBook::GetPriceLevelIndex(double price) const {
+size_t L3OrderBook::GetPriceLevelIndex(Price price) const {
     if (price < min_price || price > max_price) {
         throw std::out_of_range("Price out of range");
     }
-    return static_cast<size_t>((price - min_price) / price_increment);
+    // Exact integer arithmetic on ticks, no rounding at level boundaries.
+    return static_cast<size_t>((price - min_price).GetTicks() / price_increment.GetTicks());
 }
 
 void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
@@ -26,7 +29,7 @@ void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
             if (add_order) {
                 AddOrder(*add_order);
             } else {
-                std::cerr << "Failed to cast to AddOrderMessage" << std::endl;
+                IEX_ERROR("Failed to cast to AddOrderMessage");
             }
             break;
         }
@@ -35,7 +38,7 @@ void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
             if (modify_order) {
                 ModifyOrder(*modify_order);
             } else {
-                std::cerr << "Failed to cast to OrderModifyMessage" << std::endl;
+                IEX_ERROR("Failed to cast to OrderModifyMessage");
             }
             break;
         }
@@ -44,7 +47,7 @@ void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
             if (delete_order) {
                 DeleteOrder(*delete_order);
             } else {
-                std::cerr << "Failed to cast to OrderDeleteMessage" << std::endl;
+                IEX_ERROR("Failed to cast to OrderDeleteMessage");
             }
             break;
         }
@@ -53,7 +56,7 @@ void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
             if (executed_order) {
                 ExecuteOrder(*executed_order);
             } else {
-                std::cerr << "Failed to cast to OrderExecutedMessage" << std::endl;
+                IEX_ERROR("Failed to cast to OrderExecutedMessage");
             }
             break;
         }
@@ -62,32 +65,51 @@ void L3OrderBook::ProcessMessage(const IEXMessageBase& message) {
             if (trade_message) {
                 HandleTrade(*trade_message);
             } else {
-                std::cerr << "Failed to cast to TradeReportMessage" << std::endl;
+                IEX_ERROR("Failed to cast to TradeReportMessage");
             }
             break;
         }
         default:
-            std::cerr << "Unknown message type" << std::endl;
+            IEX_DEBUG("Unknown message type");
             break;
     }
 }
 
+void L3OrderBook::ProcessMessage(const IEXMessage& message) {
+    std::visit(Overloaded{
+        [this](const AddOrderMessage& add_order) { AddOrder(add_order); },
+        [this](const OrderModifyMessage& modify_order) { ModifyOrder(modify_order); },
+        [this](const OrderDeleteMessage& delete_order) { DeleteOrder(delete_order); },
+        [this](const OrderExecutedMessage& executed_order) { ExecuteOrder(executed_order); },
+        [this](const TradeReportMessage& trade_message) {
+            if (trade_message.GetMessageType() == MessageType::TradeReport) {
+                HandleTrade(trade_message);
+            } else {
+                IEX_DEBUG("Unknown message type");
+            }
+        },
+        [](const auto&) { IEX_DEBUG("Unknown message type"); }
+    }, message);
+}
+
 void L3OrderBook::AddOrder(const AddOrderMessage& message) {
     // Create a new order based on the incoming message
     Order new_order = { message.order_id, message.size, message.price, message.side };
 
+    // Determine the price level index first, so an order outside the grid throws before the book changes
+    size_t index = GetPriceLevelIndex(new_order.price);
+
     // Insert the new order into the global orders map
     orders[message.order_id] = new_order;
-
-    // Determine the price level index
-    size_t index = GetPriceLevelIndex(new_order.price);
     price_levels[index].push_back(new_order); // Insert into the corresponding price level
 
-    std::cout << "Added Order: ID: " << (int)new_order.order_id 
-              << ", Size: " << (int)new_order.size 
-              << ", Price: " << new_order.price 
-              << ", Side: " << (new_order.side == Side::Buy ? "Buy" : "Sell") 
-              << std::endl;
+    IEX_DEBUG("Added Order: ID: " << new_order.order_id
+              << ", Size: " << new_order.size
+              << ", Price: " << new_order.price
+              << ", Side: " << (new_order.side == Side::Buy ? "Buy" : "Sell"));
+    if (listener) {
+        listener->OnOrderAdded(message.symbol, new_order);
+    }
 }
 
 void L3OrderBook::ModifyOrder(const OrderModifyMessage& message) {
@@ -95,6 +117,9 @@ void L3OrderBook::ModifyOrder(const OrderModifyMessage& message) {
     if (it != orders.end()) {
         Order& order = it->second;
 
+        // Validate the new price first, so a price outside the grid throws before the book changes
+        size_t new_index = GetPriceLevelIndex(message.price);
+
         // Remove the existing order from the appropriate price level
         size_t index = GetPriceLevelIndex(order.price);
         auto& level_orders = price_levels[index];
@@ -107,17 +132,16 @@ void L3OrderBook::ModifyOrder(const OrderModifyMessage& message) {
         order.price = message.price;
 
         // Reinsert the modified order to the new price level
-        size_t new_index = GetPriceLevelIndex(order.price);
         price_levels[new_index].push_back(order);
 
-        std::cout << "Modified Order: ID: " << (int)order.order_id
-                  << ", Size: " << (int)order.size 
-                  << ", Price: " << order.price 
-                  << std::endl;
-
+        IEX_DEBUG("Modified Order: ID: " << order.order_id
+                  << ", Size: " << order.size
+                  << ", Price: " << order.price);
+        if (listener) {
+            listener->OnOrderModified(message.symbol, order);
+        }
     } else {
-        std::cerr << "Order ID: " << (int)message.order_id_ref 
-                  << " not found for modification." << std::endl;
+        IEX_ERROR("Order ID: " << message.order_id_ref << " not found for modification.");
     }
 }
 
@@ -133,11 +157,15 @@ void L3OrderBook::DeleteOrder(const OrderDeleteMessage& message) {
                                            [&order](const Order& o) { return o.order_id == order.order_id; }),
                            level_orders.end());
 
+        if (listener) {
+            listener->OnOrderDeleted(message.symbol, order);
+        }
+
         // Now remove the order from the global orders map
         orders.erase(it);
-        std::cout << "Removed Order ID: " << (int)message.order_id_ref << " from orders." << std::endl;
+        IEX_DEBUG("Removed Order ID: " << message.order_id_ref << " from orders.");
     } else {
-        std::cerr << "Order ID: " << (int)message.order_id_ref << " not found for removal." << std::endl;
+        IEX_ERROR("Order ID: " << message.order_id_ref << " not found for removal.");
     }
 }
 
@@ -150,12 +178,12 @@ void L3OrderBook::ExecuteOrder(const OrderExecutedMessage& message) {
         // Check if the order is of the right side
         if ((order.side == Side::Buy && message.price < order.price) || 
             (order.side == Side::Sell && message.price > order.price)) {
-            std::cerr << "Executed price does not match order type. Cannot execute." << std::endl;
+            IEX_ERROR("Executed price does not match order type. Cannot execute.");
             return; // Ignore the execution if the price does not match the order side
         }
 
         // Calculate the remaining quantity
-        uint8_t remaining_size = order.size - message.size;
+        uint32_t remaining_size = order.size - message.size;
 
         if (remaining_size == 0) {
             // If quantity reduces to zero, remove the order from the order book
@@ -165,29 +193,41 @@ void L3OrderBook::ExecuteOrder(const OrderExecutedMessage& message) {
                                                [&order](const Order& o) { return o.order_id == order.order_id; }),
                                level_orders.end());
 
+            if (listener) {
+                Order executed = order;
+                executed.size = 0;
+                listener->OnOrderExecuted(message.symbol, executed, message.size, message.price);
+                listener->OnOrderDeleted(message.symbol, executed);
+            }
+
             // Remove the order from the global orders map
             orders.erase(it);
-            std::cout << "Order ID: " << (int)message.order_id_ref << " executed completely and removed from the order book." << std::endl;
+            IEX_DEBUG("Order ID: " << message.order_id_ref << " executed completely and removed from the order book.");
         } else {
             // Update the order's remaining quantity but keep it in the order book
             order.size = remaining_size;
-            std::cout << "Order ID: " << (int)message.order_id_ref << " executed partially. Remaining size: " 
-                      << (int)remaining_size << std::endl;
+            IEX_DEBUG("Order ID: " << message.order_id_ref << " executed partially. Remaining size: "
+                      << remaining_size);
+            if (listener) {
+                listener->OnOrderExecuted(message.symbol, order, message.size, message.price);
+            }
         }
     } else {
-        std::cerr << "Order ID: " << (int)message.order_id_ref << " not found for execution." << std::endl;
+        IEX_ERROR("Order ID: " << message.order_id_ref << " not found for execution.");
     }
 }
 
 void L3OrderBook::HandleTrade(const TradeReportMessage& message) {
-    std::cout << "Trade executed: ID: " << (int)message.trade_id 
-              << ", Price: " << message.price 
-              << ", Size: " << (int)message.size 
-              << std::endl;
+    IEX_DEBUG("Trade executed: ID: " << message.trade_id
+              << ", Price: " << message.price
+              << ", Size: " << message.size);
+    if (listener) {
+        listener->OnTrade(message);
+    }
 
     // Check if the trade price and size are valid
     if (message.size == 0) {
-        std::cerr << "Trade size is zero. Ignoring trade." << std::endl;
+        IEX_ERROR("Trade size is zero. Ignoring trade.");
         return; // Ignore if the trade size is zero
     }
 
@@ -204,25 +244,33 @@ void L3OrderBook::HandleTrade(const TradeReportMessage& message) {
                 // Match against buy orders
                 if (order.side == Side::Buy && message.price >= order.price) {
                     // Check if we can fill the order
-                    if (order.size >= message.size) {
+                    if (order.size >= static_cast<uint32_t>(message.size)) {
                         // Partially or completely fill the order
                         order.size -= message.size;
 
-                        std::cout << "Matched Buy Order ID: " << (int)order.order_id 
-                                  << ", Remaining Size: " << (int)order.size << std::endl;
+                        IEX_DEBUG("Matched Buy Order ID: " << order.order_id
+                                  << ", Remaining Size: " << order.size);
+                        if (listener) {
+                            listener->OnOrderExecuted(message.symbol, order, message.size, message.price);
+                        }
 
                         // If the order is completely filled, remove it from the order book
                         if (order.size == 0) {
-                            size_t index = GetPriceLevelIndex(order.price);
+                            // Copied, the erase below invalidates order
+                            const Order filled = order;
+                            size_t index = GetPriceLevelIndex(filled.price);
                             auto& level_orders = price_levels[index];
                             level_orders.erase(std::remove_if(level_orders.begin(), level_orders.end(),
-                                                               [&order](const Order& o) { return o.order_id == order.order_id; }),
+                                                               [&filled](const Order& o) { return o.order_id == filled.order_id; }),
                                                level_orders.end());
 
                             // Remove from global orders map
-                            orders.erase(order.order_id);
-                            std::cout << "Buy Order ID: " << (int)order.order_id 
-                                      << " completely filled and removed from the order book." << std::endl;
+                            orders.erase(filled.order_id);
+                            if (listener) {
+                                listener->OnOrderDeleted(message.symbol, filled);
+                            }
+                            IEX_DEBUG("Buy Order ID: " << filled.order_id
+                                      << " completely filled and removed from the order book.");
                         }
                         return; // Exit after processing the trade
                     }
@@ -230,25 +278,33 @@ void L3OrderBook::HandleTrade(const TradeReportMessage& message) {
                 // Match against sell orders
                 else if (order.side == Side::Sell && message.price <= order.price) {
                     // Check if we can fill the order
-                    if (order.size >= message.size) {
+                    if (order.size >= static_cast<uint32_t>(message.size)) {
                         // Partially or completely fill the order
                         order.size -= message.size;
 
-                        std::cout << "Matched Sell Order ID: " << (int)order.order_id 
-                                  << ", Remaining Size: " << (int)order.size << std::endl;
+                        IEX_DEBUG("Matched Sell Order ID: " << order.order_id
+                                  << ", Remaining Size: " << order.size);
+                        if (listener) {
+                            listener->OnOrderExecuted(message.symbol, order, message.size, message.price);
+                        }
 
                         // If the order is completely filled, remove it from the order book
                         if (order.size == 0) {
-                            size_t index = GetPriceLevelIndex(order.price);
+                            // Copied, the erase below invalidates order
+                            const Order filled = order;
+                            size_t index = GetPriceLevelIndex(filled.price);
                             auto& level_orders = price_levels[index];
                             level_orders.erase(std::remove_if(level_orders.begin(), level_orders.end(),
-                                                               [&order](const Order& o) { return o.order_id == order.order_id; }),
+                                                               [&filled](const Order& o) { return o.order_id == filled.order_id; }),
                                                level_orders.end());
 
                             // Remove from global orders map
-                            orders.erase(order.order_id);
-                            std::cout << "Sell Order ID: " << (int)order.order_id 
-                                      << " completely filled and removed from the order book." << std::endl;
+                            orders.erase(filled.order_id);
+                            if (listener) {
+                                listener->OnOrderDeleted(message.symbol, filled);
+                            }
+                            IEX_DEBUG("Sell Order ID: " << filled.order_id
+                                      << " completely filled and removed from the order book.");
                         }
                         return; // Exit after processing the trade
                     }
@@ -257,14 +313,14 @@ void L3OrderBook::HandleTrade(const TradeReportMessage& message) {
         }
     }
 
-    std::cerr << "No matching order found for Trade ID: " << (int)message.trade_id << std::endl;
+    IEX_ERROR("No matching order found for Trade ID: " << message.trade_id);
 }
 
 void L3OrderBook::PrintOrderBook() const {
     std::cout << "Current Order Book:" << std::endl;
     for (size_t i = 0; i < price_levels.size(); ++i) {
         if (!price_levels[i].empty()) {
-            std::cout << "Price Level " << (min_price + i * price_increment) << ": ";
+            std::cout << "Price Level " << (min_price + price_increment * i) << ": ";
             for (const auto& order : price_levels[i]) {
                 std::cout << "[ID: " << (int)order.order_id << ", Size: " << (int)order.size 
                           << ", Side: " << (order.side == Side::Buy ? "Buy" : "Sell") << "] ";
@@ -273,3 +329,125 @@ void L3OrderBook::PrintOrderBook() const {
         }
     }
 }
+
+size_t L3OrderBook::GetMemoryUsage() const {
+    // A hash node holds the value and a next pointer, plus a bucket pointer per bucket
+    size_t bytes = orders.size() * (sizeof(std::pair<const uint64_t, Order>) + sizeof(void*)) +
+                   orders.bucket_count() * sizeof(void*);
+    bytes += price_levels.capacity() * sizeof(std::vector<Order>);
+    for (const auto& level : price_levels) {
+        bytes += level.capacity() * sizeof(Order);
+    }
+    return bytes;
+}
+
+namespace {
+
+void WriteOrder(std::ostream& out, const Order& order) {
+    snapshot_io::Write<uint64_t>(out, order.order_id);
+    snapshot_io::Write<uint32_t>(out, order.size);
+    snapshot_io::Write<int64_t>(out, order.price.GetTicks());
+    snapshot_io::Write<uint8_t>(out, static_cast<uint8_t>(order.side));
+}
+
+bool ReadOrder(std::istream& in, Order& order) {
+    int64_t ticks = 0;
+    uint8_t side = 0;
+    if (!snapshot_io::Read(in, order.order_id) || !snapshot_io::Read(in, order.size) ||
+        !snapshot_io::Read(in, ticks) || !snapshot_io::Read(in, side)) {
+        return false;
+    }
+    order.price = Price::FromTicks(ticks);
+    order.side = static_cast<Side>(side);
+    return true;
+}
+
+}  // namespace
+
+void L3OrderBook::SaveSnapshot(std::ostream& out) const {
+    snapshot_io::Write<int64_t>(out, min_price.GetTicks());
+    snapshot_io::Write<int64_t>(out, max_price.GetTicks());
+    snapshot_io::Write<int64_t>(out, price_increment.GetTicks());
+
+    // Orders are written by id, so equal books give equal snapshots
+    std::vector<const Order*> sorted_orders;
+    sorted_orders.reserve(orders.size());
+    for (const auto& entry : orders) {
+        sorted_orders.push_back(&entry.second);
+    }
+    std::sort(sorted_orders.begin(), sorted_orders.end(),
+              [](const Order* a, const Order* b) { return a->order_id < b->order_id; });
+    snapshot_io::Write<uint64_t>(out, sorted_orders.size());
+    for (const Order* order : sorted_orders) {
+        WriteOrder(out, *order);
+    }
+
+    // The grid is mostly empty, so only occupied levels are written, keeping queue order
+    snapshot_io::Write<uint64_t>(out, price_levels.size());
+    uint64_t occupied = 0;
+    for (const auto& level : price_levels) {
+        occupied += !level.empty();
+    }
+    snapshot_io::Write<uint64_t>(out, occupied);
+    for (size_t index = 0; index < price_levels.size(); ++index) {
+        if (price_levels[index].empty()) {
+            continue;
+        }
+        snapshot_io::Write<uint64_t>(out, index);
+        snapshot_io::Write<uint64_t>(out, price_levels[index].size());
+        for (const auto& order : price_levels[index]) {
+            WriteOrder(out, order);
+        }
+    }
+}
+
+bool L3OrderBook::LoadSnapshot(std::istream& in) {
+    orders.clear();
+    price_levels.clear();
+    int64_t min_ticks = 0;
+    int64_t max_ticks = 0;
+    int64_t increment_ticks = 0;
+    if (!snapshot_io::Read(in, min_ticks) || !snapshot_io::Read(in, max_ticks) ||
+        !snapshot_io::Read(in, increment_ticks)) {
+        return false;
+    }
+    min_price = Price::FromTicks(min_ticks);
+    max_price = Price::FromTicks(max_ticks);
+    price_increment = Price::FromTicks(increment_ticks);
+
+    uint64_t order_count = 0;
+    if (!snapshot_io::ReadCount(in, order_count)) {
+        return false;
+    }
+    orders.reserve(order_count);
+    for (uint64_t i = 0; i < order_count; ++i) {
+        Order order;
+        if (!ReadOrder(in, order)) {
+            return false;
+        }
+        orders[order.order_id] = order;
+    }
+
+    uint64_t level_count = 0;
+    uint64_t occupied = 0;
+    if (!snapshot_io::ReadCount(in, level_count) || !snapshot_io::ReadCount(in, occupied)) {
+        return false;
+    }
+    price_levels.resize(level_count);
+    for (uint64_t i = 0; i < occupied; ++i) {
+        uint64_t index = 0;
+        uint64_t count = 0;
+        if (!snapshot_io::Read(in, index) || index >= level_count ||
+            !snapshot_io::ReadCount(in, count)) {
+            return false;
+        }
+        auto& level = price_levels[index];
+        level.resize(count);
+        for (auto& order : level) {
+            if (!ReadOrder(in, order)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#include "message_merger.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+constexpr size_t no_input = std::numeric_limits<size_t>::max();
+
+}  // namespace
+
+MessageMerger::MessageMerger(size_t batch_size)
+    : batch_size_(std::max<size_t>(1, batch_size)), pending_(no_input) {}
+
+size_t MessageMerger::AddDecoder(IEXDecoder& decoder) {
+  Input input;
+  input.decoder = &decoder;
+  input.messages.resize(batch_size_);
+  inputs_.push_back(std::move(input));
+  refill_.push_back(inputs_.size() - 1);
+  return inputs_.size() - 1;
+}
+
+ReturnCode MessageMerger::Refill(Input& input) {
+  input.pos = 0;
+  input.count = 0;
+  if (input.ret_code != ReturnCode::Success) {
+    // The previous batch ended on this code, report it now that the batch was delivered.
+    const ReturnCode ret_code = input.ret_code;
+    input.ret_code = ReturnCode::Success;
+    return ret_code;
+  }
+  ReturnCode ret_code;
+  do {
+    ret_code = input.decoder->DecodeBatch(input.messages.data(), input.messages.size(), input.count);
+  } while (ret_code == ReturnCode::Success && input.count == 0);
+  if (input.count == 0) {
+    return ret_code;
+  }
+  input.ret_code = ret_code;
+  return ReturnCode::Success;
+}
+
+void MessageMerger::Push(size_t index) {
+  const Input& input = inputs_[index];
+  heap_.emplace_back(GetMessageBase(input.messages[input.pos]).timestamp, index);
+  std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+}
+
+ReturnCode MessageMerger::GetNextMessage(const IEXMessage*& msg, size_t& source) {
+  if (pending_ != no_input) {
+    Input& input = inputs_[pending_];
+    if (++input.pos < input.count) {
+      Push(pending_);
+    } else {
+      refill_.push_back(pending_);
+    }
+    pending_ = no_input;
+  }
+
+  // Every input must have its next message on the heap before the lowest one is known.
+  while (!refill_.empty()) {
+    const size_t index = refill_.back();
+    const ReturnCode ret_code = Refill(inputs_[index]);
+    if (ret_code == ReturnCode::Success) {
+      refill_.pop_back();
+      Push(index);
+    } else if (ret_code == ReturnCode::EndOfStream) {
+      refill_.pop_back();
+    } else {
+      // The input stays in refill_, its decoder resumes after the failed block next time.
+      return ret_code;
+    }
+  }
+
+  if (heap_.empty()) {
+    return ReturnCode::EndOfStream;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), std::greater<>());
+  source = heap_.back().second;
+  heap_.pop_back();
+  const Input& input = inputs_[source];
+  msg = &input.messages[input.pos];
+  pending_ = source;
+  return ReturnCode::Success;
+}
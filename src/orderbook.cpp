@@ -6,15 +6,22 @@
 #include <string>
 #include <sstream>
 #include <orderbook.h>
+#include "book_listener.h"
+#include "snapshot_io.h"
+#include "depth_features.h"
+#include <algorithm>
+#include <cstring>
 
 
 // Retrieve the current Best Bid and Offer
-std::optional<BBO> OrderBook::GetBbo() const {
+template <typename Levels>
+std::optional<BBO> BasicOrderBook<Levels>::GetBbo() const {
     return current_bbo;
 }
 
 // Process incoming messages
-void OrderBook::ProcessMessage(const IEXMessageBase& message) {
+template <typename Levels>
+void BasicOrderBook<Levels>::ProcessMessage(const IEXMessageBase& message) {
     auto message_type = message.GetMessageType();
 
     if (message_type == MessageType::PriceLevelUpdateBuy || message_type == MessageType::PriceLevelUpdateSell) {
@@ -22,63 +29,157 @@ void OrderBook::ProcessMessage(const IEXMessageBase& message) {
         auto* price_level_update = dynamic_cast<const PriceLevelUpdateMessage*>(&message);
 
         if (price_level_update) {
-            if (price_level_update->flags == 0) {
-                // Start of an atomic event
-                startAtomicUpdate(price_level_update);
-            } else {
-                // End of a transaction
-                if (atomicUpdates.find(price_level_update->symbol) != atomicUpdates.end()) {
-                    endAtomicUpdate(price_level_update);
-                } else {
-                    // No atomic update, process directly
-                    UpdateOrderBook(
-                        price_level_update->GetMessageType(),
-                        price_level_update->symbol,
-                        price_level_update->price,
-                        price_level_update->size
-                    );
-                    price_level_update->Print();
-                    std::cout << "update BBO when it is 1 level take out" << std::endl;
-                    UpdateBBO(); // Update BBO immediately for non-atomic updates
-                }
+            ProcessPriceLevelUpdate(*price_level_update);
+        }
+    }
+}
+
+// Process incoming messages held by value
+template <typename Levels>
+void BasicOrderBook<Levels>::ProcessMessage(const IEXMessage& message) {
+    if (auto* price_level_update = std::get_if<PriceLevelUpdateMessage>(&message)) {
+        ProcessPriceLevelUpdate(*price_level_update);
+    }
+}
+
+// Apply a single price level update, staging it if it is part of an atomic event
+template <typename Levels>
+void BasicOrderBook<Levels>::ProcessPriceLevelUpdate(const PriceLevelUpdateMessage& update) {
+    const auto* price_level_update = &update;
+    top_of_book_changed = false; // Only a completed event can move the BBO
+    if (price_level_update->flags == 0) {
+        // Start of an atomic event
+        startAtomicUpdate(update);
+    } else {
+        // End of a transaction
+        if (atomicUpdateCount > 0) {
+            endAtomicUpdate(update);
+        } else {
+            // No atomic update, process directly
+            UpdateOrderBook(
+                price_level_update->GetMessageType(),
+                price_level_update->symbol,
+                price_level_update->price,
+                price_level_update->size
+            );
+            IEX_DEBUG("Applying single price level update for " << price_level_update->symbol);
+            UpdateBBO(); // Update BBO immediately for non-atomic updates
+        }
+    }
+}
+
+
+namespace {
+
+// Keep the top levels of a side current after one of its levels changed, levels already holds the
+// change. The side is only walked when a top level is removed and the one behind has to move up.
+template <typename Levels, typename TopLevels>
+void TrackTopLevels(const Levels& levels, TopLevels& top, Price price, int size, bool is_bid) {
+    const int64_t ticks = price.GetTicks();
+    const size_t capacity = top.prices.size();
+    // First cached level that is not better than price
+    size_t i = 0;
+    while (i < top.count && (is_bid ? top.prices[i] > ticks : top.prices[i] < ticks)) {
+        ++i;
+    }
+    const bool cached = i < top.count && top.prices[i] == ticks;
+    if (size != 0) {
+        if (cached) {
+            top.sizes[i] = size;
+        } else if (i < capacity) {
+            // Insert, dropping the last level if the cache is full
+            const size_t moved = std::min(top.count, capacity - 1) - i;
+            std::memmove(&top.prices[i + 1], &top.prices[i], moved * sizeof(top.prices[0]));
+            std::memmove(&top.sizes[i + 1], &top.sizes[i], moved * sizeof(top.sizes[0]));
+            top.prices[i] = ticks;
+            top.sizes[i] = size;
+            top.count = std::min(top.count + 1, capacity);
+        }
+        return;
+    }
+    if (!cached) {
+        return;
+    }
+    const size_t moved = top.count - i - 1;
+    std::memmove(&top.prices[i], &top.prices[i + 1], moved * sizeof(top.prices[0]));
+    std::memmove(&top.sizes[i], &top.sizes[i + 1], moved * sizeof(top.sizes[0]));
+    --top.count;
+    if (levels.Size() > top.count) {
+        // The first level behind the cached ones moves up
+        size_t skipped = 0;
+        auto refill = [&](Price level_price, int level_size) {
+            if (skipped++ < top.count) {
+                return true;
             }
+            top.prices[top.count] = level_price.GetTicks();
+            top.sizes[top.count] = level_size;
+            ++top.count;
+            return false;
+        };
+        if (is_bid) {
+            levels.ForEachDescending(refill);
+        } else {
+            levels.ForEachAscending(refill);
         }
     }
 }
 
+// Rebuild the top levels of a side from scratch
+template <typename Levels, typename TopLevels>
+void FillTopLevels(const Levels& levels, TopLevels& top, bool is_bid) {
+    top.count = 0;
+    auto fill = [&top](Price price, int size) {
+        top.prices[top.count] = price.GetTicks();
+        top.sizes[top.count] = size;
+        return ++top.count < top.prices.size();
+    };
+    if (is_bid) {
+        levels.ForEachDescending(fill);
+    } else {
+        levels.ForEachAscending(fill);
+    }
+}
+
+}  // namespace
 
 // Update the order book based on the message type
-void OrderBook::UpdateOrderBook(MessageType type, const std::string& symbol, double price, int size) {
+template <typename Levels>
+void BasicOrderBook<Levels>::UpdateOrderBook(MessageType type, const Symbol& symbol, Price price, int size) {
+    last_symbol = symbol;
     if (type == MessageType::PriceLevelUpdateBuy) {
-        if (size == 0) {
-            bid_levels.erase(price); // Remove price level if size is zero
-        } else {
-            bid_levels[price] = size; // Update bid level
+        bid_levels.Set(price, size); // A size of zero removes the level
+        TrackTopLevels(bid_levels, top_bids, price, size, true);
+        if (listener) {
+            listener->OnLevelChange(symbol, Side::Buy, price, size);
         }
     } else if (type == MessageType::PriceLevelUpdateSell) {
-        if (size == 0) {
-            ask_levels.erase(price); // Remove price level if size is zero
-        } else {
-            ask_levels[price] = size; // Update ask level
+        ask_levels.Set(price, size); // A size of zero removes the level
+        TrackTopLevels(ask_levels, top_asks, price, size, false);
+        if (listener) {
+            listener->OnLevelChange(symbol, Side::Sell, price, size);
         }
     }
 }
 
-void OrderBook::PrintOrderBook() const {
+template <typename Levels>
+void BasicOrderBook<Levels>::PrintOrderBook() const {
     std::cout << "Bids:" << std::endl;
-    for (auto it = bid_levels.rbegin(); it != bid_levels.rend(); ++it) {
-        std::cout << "Price: " << it->first << ", Size: " << it->second << "\n";
-    }
+    bid_levels.ForEachDescending([](Price price, int size) {
+        std::cout << "Price: " << price << ", Size: " << size << "\n";
+        return true;
+    });
 
     std::cout << "Asks:" << std::endl;
-    for (auto it = ask_levels.begin(); it != ask_levels.end(); ++it) {
-        std::cout << "Price: " << it->first << ", Size: " << it->second << "\n";
-    }
+    ask_levels.ForEachAscending([](Price price, int size) {
+        std::cout << "Price: " << price << ", Size: " << size << "\n";
+        return true;
+    });
     std::cout << std::endl;
 }
 
 // Print the Best Bid and Offer
-void OrderBook::PrintBbo() const {
+template <typename Levels>
+void BasicOrderBook<Levels>::PrintBbo() const {
     if (current_bbo) {
         std::cout << "Best Bid: Price = " << current_bbo -> getBidPrice() << ", Size = " << current_bbo -> getBidSize()<< "\n";
         std::cout << "Best Ask: Price = " << current_bbo->getAskPrice() << ", Size = " << current_bbo->getAskSize() << "\n";
@@ -87,74 +188,195 @@ void OrderBook::PrintBbo() const {
     }
 }
 
-// Start atomic update by adding the message to the atomic update map
-void OrderBook::startAtomicUpdate(const PriceLevelUpdateMessage* update) {
-    atomicUpdates[update->symbol].push_back(*update);
+// Stage an update of an atomic event in the reused buffer
+template <typename Levels>
+void BasicOrderBook<Levels>::startAtomicUpdate(const PriceLevelUpdateMessage& update) {
+    if (atomicUpdateCount == atomicUpdates.size()) {
+        // Full, apply what is staged so far. GetBbo keeps the last published BBO until the end.
+        applyAtomicUpdates(update.symbol);
+    }
+    const Side side = update.GetMessageType() == MessageType::PriceLevelUpdateBuy ? Side::Buy : Side::Sell;
+    atomicUpdates[atomicUpdateCount++] = AtomicUpdate{update.price, static_cast<int32_t>(update.size), side};
 }
 
-// End atomic update and apply all updates for the symbol
-void OrderBook::endAtomicUpdate(const PriceLevelUpdateMessage* update) {
-    auto& updates = atomicUpdates[update->symbol];
-    updates.push_back(*update);
-    applyAtomicUpdates(update->symbol);
-    atomicUpdates.erase(update->symbol);
+// End atomic update and apply all staged updates with a single BBO evaluation
+template <typename Levels>
+void BasicOrderBook<Levels>::endAtomicUpdate(const PriceLevelUpdateMessage& update) {
+    startAtomicUpdate(update);
+    applyAtomicUpdates(update.symbol);
+    IEX_DEBUG("Updating BBO after applying atomic updates for " << update.symbol);
+    UpdateBBO(); // Update BBO after atomic updates are applied
 }
 
-// Apply all atomic updates for a symbol, then update the BBO
-void OrderBook::applyAtomicUpdates(const std::string& symbol) {
-    auto& updates = atomicUpdates[symbol];
-    for (const auto& update : updates) {
-        UpdateOrderBook(update.GetMessageType(), update.symbol, update.price, update.size);
+// Apply all staged updates in one pass and empty the buffer
+template <typename Levels>
+void BasicOrderBook<Levels>::applyAtomicUpdates(const Symbol& symbol) {
+    for (size_t i = 0; i < atomicUpdateCount; ++i) {
+        const AtomicUpdate& update = atomicUpdates[i];
+        const MessageType type = update.side == Side::Buy ? MessageType::PriceLevelUpdateBuy
+                                                          : MessageType::PriceLevelUpdateSell;
+        UpdateOrderBook(type, symbol, update.price, update.size);
     }
-    std::cout << "updating bbo after applying" << std::endl;
-    UpdateBBO(); // Update BBO after atomic updates are applied
+    atomicUpdateCount = 0;
 }
 
-// Update the Best Bid and Offer (BBO)
-void OrderBook::UpdateBBO() {
-    if (!bid_levels.empty() && !ask_levels.empty()) {
-        auto best_bid = *bid_levels.rbegin(); // Highest bid
-        auto best_ask = *ask_levels.begin();   // Lowest ask
+// Update the Best Bid and Offer (BBO) from the best levels kept by UpdateOrderBook
+template <typename Levels>
+void BasicOrderBook<Levels>::UpdateBBO() {
+    std::optional<BBO> bbo;
+    if (top_bids.count > 0 && top_asks.count > 0) {
+        const Price bid_price = Price::FromTicks(top_bids.prices[0]);
+        const Price ask_price = Price::FromTicks(top_asks.prices[0]);
 
         // Debug outputs
-        std::cout << "Updating BBO..." << std::endl;
-        std::cout << "Best Bid: " << best_bid.first << " (Size: " << best_bid.second << ")" << std::endl;
-        std::cout << "Best Ask: " << best_ask.first << " (Size: " << best_ask.second << ")" << std::endl;
-        for (auto x: ask_levels){
-            std::cout  << "ask price: " <<  x.first << " ask qty" << x.second<<std::endl;
+        IEX_DEBUG("Best Bid: " << bid_price << " (Size: " << top_bids.sizes[0] << ")");
+        IEX_DEBUG("Best Ask: " << ask_price << " (Size: " << top_asks.sizes[0] << ")");
+
+        // Keep the fast part of the level containers where the trading is
+        bid_levels.KeepNear(bid_price);
+        ask_levels.KeepNear(ask_price);
+
+        // A crossed book has no valid BBO, checked here so BBO never throws
+        if (bid_price <= ask_price) {
+            bbo.emplace(bid_price, top_bids.sizes[0], ask_price, top_asks.sizes[0]);
         }
-        // Create a new BBO instance
-        current_bbo = BBO{
-            best_bid.first, // Bid price
-            best_bid.second, // Bid size
-            best_ask.first,  // Ask price
-            best_ask.second  // Ask size
-        };
     } else {
-        std::cout << "Resetting current BBO: No Bids or Asks available." << std::endl;
-        current_bbo.reset(); // No BBO available if either bid or ask levels are empty
+        IEX_DEBUG("Resetting current BBO: No Bids or Asks available.");
     }
+    top_of_book_changed = bbo != current_bbo;
+    current_bbo = bbo;
+    if (top_of_book_changed && listener) {
+        listener->OnBboChange(last_symbol, current_bbo ? &*current_bbo : nullptr);
+    }
+}
+
+template <typename Levels>
+double BasicOrderBook<Levels>::GetBookPressure() const {
+    // Size imbalance over the top 5 levels of each side, read straight from the top levels
+    return DepthImbalance(top_bids.sizes.data(), std::min<size_t>(top_bids.count, 5),
+                          top_asks.sizes.data(), std::min<size_t>(top_asks.count, 5));
+}
+
+template <typename Levels>
+void BasicOrderBook<Levels>::GetDepth(size_t n, DepthArrays& out) const {
+    out.bid_count = std::min(n, top_bids.count);
+    out.ask_count = std::min(n, top_asks.count);
+    // copy_n, not memcpy, as the arrays may be null when nothing is copied
+    std::copy_n(top_bids.prices.data(), out.bid_count, out.bid_prices);
+    std::copy_n(top_bids.sizes.data(), out.bid_count, out.bid_sizes);
+    std::copy_n(top_asks.prices.data(), out.ask_count, out.ask_prices);
+    std::copy_n(top_asks.sizes.data(), out.ask_count, out.ask_sizes);
+}
+
+template <typename Levels>
+size_t BasicOrderBook<Levels>::GetMemoryUsage() const {
+    // The atomic update buffer is part of the book itself
+    return bid_levels.GetMemoryUsage() + ask_levels.GetMemoryUsage();
 }
 
-double OrderBook::GetBookPressure() const {
-    int buy_pressure = 0;
-    int sell_pressure = 0;
+// Price levels are written as (ticks, size) pairs in price order
+namespace {
+
+template <typename Levels>
+void WriteLevels(std::ostream& out, const Levels& levels) {
+    snapshot_io::Write<uint64_t>(out, levels.Size());
+    levels.ForEachAscending([&out](Price price, int size) {
+        snapshot_io::Write<int64_t>(out, price.GetTicks());
+        snapshot_io::Write<int32_t>(out, size);
+        return true;
+    });
+}
 
-    // Accumulate sizes for the top 5 buy levels
-    int count = 0;
-    for (auto it = bid_levels.rbegin(); it != bid_levels.rend() && count < 5; ++it, ++count) {
-        buy_pressure += it -> second;
+template <typename Levels>
+bool ReadLevels(std::istream& in, Levels& levels) {
+    uint64_t count = 0;
+    if (!snapshot_io::ReadCount(in, count)) {
+        return false;
     }
-    count = 0;
-    for (auto it = ask_levels.begin(); it!=ask_levels.end() &&count<5; ++it,++count)
-    {
-        sell_pressure += it -> second;
+    for (uint64_t i = 0; i < count; ++i) {
+        int64_t ticks = 0;
+        int32_t size = 0;
+        if (!snapshot_io::Read(in, ticks) || !snapshot_io::Read(in, size)) {
+            return false;
+        }
+        levels.Set(Price::FromTicks(ticks), size);
     }
+    return true;
+}
+
+}  // namespace
 
-    // Calculate the book pressure ratio
-    int total_pressure = buy_pressure + sell_pressure;
-    if (total_pressure == 0) return 0.0; // Avoid division by zero
+template <typename Levels>
+void BasicOrderBook<Levels>::SaveSnapshot(std::ostream& out) const {
+    WriteLevels(out, bid_levels);
+    WriteLevels(out, ask_levels);
 
-    return static_cast<double>(buy_pressure - sell_pressure) / total_pressure;
+    snapshot_io::Write<uint64_t>(out, atomicUpdateCount);
+    for (size_t i = 0; i < atomicUpdateCount; ++i) {
+        snapshot_io::Write<uint8_t>(out, static_cast<uint8_t>(atomicUpdates[i].side));
+        snapshot_io::Write<int64_t>(out, atomicUpdates[i].price.GetTicks());
+        snapshot_io::Write<int32_t>(out, atomicUpdates[i].size);
+    }
+
+    snapshot_io::Write<uint8_t>(out, current_bbo.has_value());
+    if (current_bbo) {
+        snapshot_io::Write<int64_t>(out, current_bbo->getBidTicks().GetTicks());
+        snapshot_io::Write<int32_t>(out, current_bbo->getBidSize());
+        snapshot_io::Write<int64_t>(out, current_bbo->getAskTicks().GetTicks());
+        snapshot_io::Write<int32_t>(out, current_bbo->getAskSize());
+    }
+}
+
+template <typename Levels>
+bool BasicOrderBook<Levels>::LoadSnapshot(std::istream& in) {
+    bid_levels.Clear();
+    ask_levels.Clear();
+    atomicUpdateCount = 0;
+    current_bbo.reset();
+    top_bids.count = 0;
+    top_asks.count = 0;
+    top_of_book_changed = false;
+    if (!ReadLevels(in, bid_levels) || !ReadLevels(in, ask_levels)) {
+        return false;
+    }
+    FillTopLevels(bid_levels, top_bids, true);
+    FillTopLevels(ask_levels, top_asks, false);
+
+    uint64_t update_count = 0;
+    if (!snapshot_io::Read(in, update_count) || update_count > atomicUpdates.size()) {
+        return false;
+    }
+    for (uint64_t i = 0; i < update_count; ++i) {
+        uint8_t side = 0;
+        int64_t ticks = 0;
+        int32_t size = 0;
+        if (!snapshot_io::Read(in, side) || !snapshot_io::Read(in, ticks) ||
+            !snapshot_io::Read(in, size)) {
+            return false;
+        }
+        atomicUpdates[i] = AtomicUpdate{Price::FromTicks(ticks), size, static_cast<Side>(side)};
+    }
+    atomicUpdateCount = update_count;
+
+    uint8_t has_bbo = 0;
+    if (!snapshot_io::Read(in, has_bbo)) {
+        return false;
+    }
+    if (has_bbo) {
+        int64_t bid_ticks = 0;
+        int32_t bid_size = 0;
+        int64_t ask_ticks = 0;
+        int32_t ask_size = 0;
+        if (!snapshot_io::Read(in, bid_ticks) || !snapshot_io::Read(in, bid_size) ||
+            !snapshot_io::Read(in, ask_ticks) || !snapshot_io::Read(in, ask_size) ||
+            bid_ticks > ask_ticks) {
+            return false;
+        }
+        current_bbo = BBO{Price::FromTicks(bid_ticks), bid_size, Price::FromTicks(ask_ticks),
+                          ask_size};
+    }
+    return true;
 }
 
+template class BasicOrderBook<MapPriceLevels>;
+template class BasicOrderBook<TickLadderPriceLevels>;
@@ -0,0 +1,121 @@
+#include "packet_index.h"
+#include "snapshot_io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+/// \brief Identifies the sidecar format. Entries are stored in host byte order.
+constexpr char index_magic[8] = {'I', 'E', 'X', 'P', 'I', 'D', 'X', '1'};
+
+/// \brief Length of the IEX-TP header at the start of each payload.
+constexpr size_t segment_header_len = 40;
+
+}  // namespace
+
+bool PacketIndex::Build(const MmapPcapSource& source, size_t interval) {
+  entries_.clear();
+  file_size_ = source.GetFileSize();
+  if (file_size_ == 0) {
+    IEX_LOG("Cannot index a source that is not open.");
+    return false;
+  }
+  interval = std::max<size_t>(interval, 1);
+
+  IEXTPHeader header;
+  size_t segments = 0;
+  uint64_t offset = pcap_file_header_len;
+  while (true) {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    uint64_t next_offset = 0;
+    const auto ret_code = source.GetPayloadAt(offset, data, len, next_offset);
+    if (ret_code == ReturnCode::EndOfStream) {
+      break;
+    }
+    // Frames that are not IEX-TP segments are skipped rather than failing the whole index.
+    if (ret_code == ReturnCode::Success && len >= segment_header_len && header.Decode(data)) {
+      if (segments % interval == 0) {
+        entries_.push_back({header.send_time, header.first_msg_sq_num, offset});
+      }
+      ++segments;
+    }
+    offset = next_offset;
+  }
+  return !entries_.empty();
+}
+
+bool PacketIndex::Save(const std::string& path) const {
+  const uint64_t count = entries_.size();
+  return snapshot_io::WriteFileAtomically(
+      path, {std::string_view(index_magic, sizeof(index_magic)),
+             std::string_view(reinterpret_cast<const char*>(&file_size_), sizeof(file_size_)),
+             std::string_view(reinterpret_cast<const char*>(&count), sizeof(count)),
+             std::string_view(reinterpret_cast<const char*>(entries_.data()),
+                              count * sizeof(Entry))});
+}
+
+bool PacketIndex::Load(const std::string& path, uint64_t file_size) {
+  entries_.clear();
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  char magic[sizeof(index_magic)];
+  uint64_t indexed_size = 0;
+  uint64_t count = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&indexed_size), sizeof(indexed_size));
+  in.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if (!in || std::memcmp(magic, index_magic, sizeof(magic)) != 0) {
+    IEX_LOG(path + " is not a packet index.");
+    return false;
+  }
+  if (indexed_size != file_size) {
+    IEX_LOG(path + " belongs to a different version of the capture.");
+    return false;
+  }
+  // The count must match the rest of the file before anything is allocated for it.
+  const std::streamoff header_end = in.tellg();
+  in.seekg(0, std::ios::end);
+  const std::streamoff entries_len = in.tellg() - header_end;
+  in.seekg(header_end);
+  if (count == 0 || entries_len < 0 || entries_len % sizeof(Entry) != 0 ||
+      count != static_cast<uint64_t>(entries_len) / sizeof(Entry)) {
+    IEX_LOG(path + " is truncated or corrupt.");
+    return false;
+  }
+  entries_.resize(count);
+  in.read(reinterpret_cast<char*>(entries_.data()), count * sizeof(Entry));
+  if (!in) {
+    IEX_LOG(path + " is truncated.");
+    entries_.clear();
+    return false;
+  }
+  file_size_ = indexed_size;
+  return true;
+}
+
+uint64_t PacketIndex::FindTime(int64_t send_time) const {
+  // The last entry sent strictly before send_time, segments sent exactly at send_time may start
+  // just before the following entry.
+  auto it = std::lower_bound(entries_.begin(), entries_.end(), send_time,
+                             [](const Entry& entry, int64_t value) { return entry.send_time < value; });
+  if (it == entries_.begin()) {
+    return pcap_file_header_len;
+  }
+  return std::prev(it)->offset;
+}
+
+uint64_t PacketIndex::FindSequence(int64_t sq_num) const {
+  // The last entry whose segment starts at or before sq_num.
+  auto it = std::upper_bound(entries_.begin(), entries_.end(), sq_num,
+                             [](int64_t value, const Entry& entry) { return value < entry.first_msg_sq_num; });
+  if (it == entries_.begin()) {
+    return pcap_file_header_len;
+  }
+  return std::prev(it)->offset;
+}
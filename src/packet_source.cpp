@@ -0,0 +1,250 @@
+#include "packet_source.h"
+#include "Packet.h"
+#include "PayloadLayer.h"
+#include "PcapFileDevice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/// \brief Link layer types handled by GetUdpPayload, see https://www.tcpdump.org/linktypes.html
+constexpr uint32_t link_type_ethernet = 1;
+constexpr uint32_t link_type_raw = 101;
+constexpr uint32_t link_type_linux_sll = 113;
+constexpr uint32_t link_type_ipv4 = 228;
+
+constexpr uint16_t ether_type_ipv4 = 0x0800;
+constexpr uint16_t ether_type_vlan = 0x8100;
+constexpr uint8_t ip_protocol_udp = 17;
+constexpr size_t udp_header_len = 8;
+
+/// \brief Read a little endian (host order) field from a possibly unaligned address.
+inline uint32_t LoadU32(const uint8_t* data_ptr, bool swapped) {
+  uint32_t value;
+  std::memcpy(&value, data_ptr, sizeof(value));
+  return swapped ? __builtin_bswap32(value) : value;
+}
+
+/// \brief Read a network order (big endian) 16 bit field.
+inline uint16_t LoadBE16(const uint8_t* data_ptr) {
+  return static_cast<uint16_t>((data_ptr[0] << 8) | data_ptr[1]);
+}
+
+}  // namespace
+
+bool ParsePcapFileHeader(const uint8_t* data, size_t len, uint32_t& link_type, bool& swapped) {
+  uint32_t snaplen = 0;
+  return ParsePcapFileHeader(data, len, link_type, swapped, snaplen);
+}
+
+bool ParsePcapFileHeader(const uint8_t* data, size_t len, uint32_t& link_type, bool& swapped,
+                         uint32_t& snaplen) {
+  if (len < pcap_file_header_len) {
+    return false;
+  }
+  const uint32_t magic = LoadU32(data, false);
+  switch (magic) {
+    case 0xa1b2c3d4:  // Microsecond timestamps.
+    case 0xa1b23c4d:  // Nanosecond timestamps.
+      swapped = false;
+      break;
+    case 0xd4c3b2a1:
+    case 0x4d3cb2a1:
+      swapped = true;
+      break;
+    default:
+      return false;
+  }
+  snaplen = LoadU32(data + 16, swapped);
+  link_type = LoadU32(data + 20, swapped) & 0x0fffffff;
+  return true;
+}
+
+bool GetUdpPayload(const uint8_t* frame, size_t caplen, uint32_t link_type, const uint8_t*& data,
+                   size_t& len) {
+  size_t ip_offset = 0;
+  switch (link_type) {
+    case link_type_ethernet: {
+      ip_offset = 14;
+      if (caplen < ip_offset) return false;
+      uint16_t ether_type = LoadBE16(frame + 12);
+      while (ether_type == ether_type_vlan && caplen >= ip_offset + 4) {
+        ether_type = LoadBE16(frame + ip_offset + 2);
+        ip_offset += 4;
+      }
+      if (ether_type != ether_type_ipv4) return false;
+      break;
+    }
+    case link_type_linux_sll:
+      ip_offset = 16;
+      if (caplen < ip_offset || LoadBE16(frame + 14) != ether_type_ipv4) return false;
+      break;
+    case link_type_raw:
+    case link_type_ipv4:
+      break;
+    default:
+      return false;
+  }
+
+  if (caplen < ip_offset + 20) return false;
+  const uint8_t* ip_ptr = frame + ip_offset;
+  const size_t ip_header_len = (ip_ptr[0] & 0x0f) * 4;
+  if ((ip_ptr[0] >> 4) != 4 || ip_ptr[9] != ip_protocol_udp) return false;
+
+  const size_t udp_offset = ip_offset + ip_header_len;
+  if (caplen < udp_offset + udp_header_len) return false;
+  const size_t udp_len = LoadBE16(frame + udp_offset + 4);
+  if (udp_len < udp_header_len) return false;
+
+  data = frame + udp_offset + udp_header_len;
+  len = std::min(udp_len - udp_header_len, caplen - udp_offset - udp_header_len);
+  return true;
+}
+
+bool PcapPlusPlusSource::Open(const std::string& filename) {
+  reader_ptr_.reset(pcpp::IFileReaderDevice::getReader(filename.c_str()));
+
+  // Check the reader was successfully created.
+  if (reader_ptr_ == NULL) {
+    IEX_LOG("Cannot determine reader for file type\n");
+    return false;
+  }
+
+  // Open the reader for reading.
+  if (!reader_ptr_->open()) {
+    IEX_LOG("Cannot open " + filename + " for reading.");
+    reader_ptr_.reset();
+    return false;
+  }
+  return true;
+}
+
+void PcapPlusPlusSource::Close() {
+  if (reader_ptr_) {
+    reader_ptr_->close();
+    reader_ptr_.reset();
+  }
+}
+
+ReturnCode PcapPlusPlusSource::GetNextPayload(const uint8_t*& data, size_t& len) {
+  if (!reader_ptr_) {
+    return ReturnCode::ClassNotInitialized;
+  }
+
+  // Parse the packet.
+  if (!reader_ptr_->getNextPacket(raw_packet_)) {
+    return ReturnCode::EndOfStream;
+  };
+  parsed_packet_ = pcpp::Packet(&raw_packet_);
+
+  // Extract the payload layer. This is used by IEX for message data.
+  pcpp::PayloadLayer* payload_layer = parsed_packet_.getLayerOfType<pcpp::PayloadLayer>();
+  if (payload_layer == NULL) {
+    printf("Couldn't find a generic payload layer for IEX message data.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  data = payload_layer->getData();
+  len = payload_layer->getDataLen();
+  return ReturnCode::Success;
+}
+
+bool MmapPcapSource::Open(const std::string& filename) {
+  Close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    IEX_LOG("Cannot open " + filename + " for reading.");
+    return false;
+  }
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(pcap_file_header_len)) {
+    IEX_LOG("Cannot map " + filename + ", file is too small to be a pcap file.");
+    ::close(fd);
+    return false;
+  }
+  const size_t file_len = static_cast<size_t>(file_stat.st_size);
+  void* map = ::mmap(nullptr, file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file.
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    IEX_LOG("Failed to memory map " + filename + ".");
+    return false;
+  }
+  ::madvise(map, file_len, MADV_SEQUENTIAL);
+
+  map_ptr_ = static_cast<const uint8_t*>(map);
+  map_len_ = file_len;
+  if (!ParsePcapFileHeader(map_ptr_, map_len_, link_type_, swapped_)) {
+    IEX_LOG(filename + " is not a classic pcap file, it cannot be memory mapped.");
+    Close();
+    return false;
+  }
+  offset_ = pcap_file_header_len;
+  return true;
+}
+
+void MmapPcapSource::Close() {
+  if (map_ptr_) {
+    ::munmap(const_cast<uint8_t*>(map_ptr_), map_len_);
+  }
+  map_ptr_ = nullptr;
+  map_len_ = 0;
+  offset_ = 0;
+}
+
+ReturnCode MmapPcapSource::GetNextPayload(const uint8_t*& data, size_t& len) {
+  uint64_t next_offset = offset_;
+  const auto ret_code = GetPayloadAt(offset_, data, len, next_offset);
+  last_offset_ = offset_;
+  offset_ = next_offset;
+  return ret_code;
+}
+
+void MmapPcapSource::ScanRecordOffsets(std::vector<uint64_t>& offsets) const {
+  offsets.clear();
+  if (!map_ptr_) {
+    return;
+  }
+  // Stop at a truncated last record, like GetPayloadAt does.
+  size_t offset = pcap_file_header_len;
+  while (offset + pcap_record_header_len <= map_len_) {
+    const size_t caplen = LoadU32(map_ptr_ + offset + 8, swapped_);
+    if (offset + pcap_record_header_len + caplen > map_len_) {
+      break;
+    }
+    offsets.push_back(offset);
+    offset += pcap_record_header_len + caplen;
+  }
+}
+
+ReturnCode MmapPcapSource::GetPayloadAt(uint64_t offset, const uint8_t*& data, size_t& len,
+                                        uint64_t& next_offset) const {
+  if (!map_ptr_) {
+    return ReturnCode::ClassNotInitialized;
+  }
+  if (offset + pcap_record_header_len > map_len_) {
+    next_offset = map_len_;
+    return ReturnCode::EndOfStream;
+  }
+
+  const uint8_t* record_ptr = map_ptr_ + offset;
+  const size_t caplen = LoadU32(record_ptr + 8, swapped_);
+  const uint8_t* frame_ptr = record_ptr + pcap_record_header_len;
+  if (offset + pcap_record_header_len + caplen > map_len_) {
+    // A truncated last record, typically from a capture that was not shut down cleanly.
+    next_offset = map_len_;
+    return ReturnCode::EndOfStream;
+  }
+  next_offset = offset + pcap_record_header_len + caplen;
+
+  if (!GetUdpPayload(frame_ptr, caplen, link_type_, data, len)) {
+    IEX_LOG("Couldn't find a UDP payload for IEX message data.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  return ReturnCode::Success;
+}
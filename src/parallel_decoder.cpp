@@ -0,0 +1,102 @@
+#include "parallel_decoder.h"
+
+#include <cstring>
+
+namespace {
+
+/// \brief Length of the IEX-TP header preceding the first block of each segment.
+constexpr size_t segment_header_len = 40;
+
+}  // namespace
+
+ParallelDecoder::ParallelDecoder(size_t thread_count, size_t packets_per_chunk)
+    : thread_count_(std::max<size_t>(thread_count, 1)),
+      packets_per_chunk_(std::max<size_t>(packets_per_chunk, 1)) {}
+
+bool ParallelDecoder::OpenFileForDecoding(const std::string& filename) {
+  record_offsets_.clear();
+  if (!source_.Open(filename)) {
+    return false;
+  }
+  source_.ScanRecordOffsets(record_offsets_);
+  if (record_offsets_.empty()) {
+    IEX_LOG(filename + " does not contain any packets.");
+    return false;
+  }
+  return true;
+}
+
+std::future<ParallelDecoder::Chunk> ParallelDecoder::LaunchChunk(
+    size_t& next_packet, const std::atomic<bool>* cancelled) const {
+  const size_t first = next_packet;
+  next_packet = std::min(first + packets_per_chunk_, record_offsets_.size());
+  return std::async(std::launch::async, &ParallelDecoder::DecodeChunk, this, first, next_packet,
+                    cancelled);
+}
+
+ParallelDecoder::Chunk ParallelDecoder::DecodeChunk(size_t first, size_t last,
+                                                    const std::atomic<bool>* cancelled) const {
+  Chunk chunk;
+  // A rough guess of a few messages per packet saves most of the regrowth.
+  chunk.messages.reserve((last - first) * 4);
+  chunk.segments.reserve(last - first);
+
+  IEXTPHeader header;
+  for (size_t packet = first; packet < last; ++packet) {
+    if (cancelled->load(std::memory_order_relaxed)) {
+      return chunk;
+    }
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    uint64_t next_offset = 0;
+    auto ret_code = source_.GetPayloadAt(record_offsets_[packet], data, len, next_offset);
+    if (ret_code == ReturnCode::Success && len < segment_header_len) {
+      IEX_LOG("Packet is too short to contain an IEX-TP header.");
+      ret_code = ReturnCode::FailedParsingPacket;
+    }
+    if (ret_code == ReturnCode::Success && !header.Decode(data)) {
+      IEX_LOG("Header decode failed.");
+      ret_code = ReturnCode::FailedDecodingPacket;
+    }
+    if (ret_code != ReturnCode::Success) {
+      chunk.ret_code = ret_code;
+      return chunk;
+    }
+
+    // Heartbeats carry no messages.
+    if (header.message_count == 0) {
+      continue;
+    }
+    Segment segment{header.first_msg_sq_num, header.message_count, chunk.messages.size(),
+                    chunk.messages.size()};
+    size_t block_offset = segment_header_len;
+    for (size_t block = 0; block < header.message_count && block_offset + 2 <= len; ++block) {
+      uint16_t block_len;
+      std::memcpy(&block_len, data + block_offset, sizeof(block_len));
+      // The block must lie inside the segment, its length comes straight from the capture.
+      if (block_offset + 2 + block_len > len) {
+        IEX_LOG("Block " << block << " runs past the end of its segment.");
+        ret_code = ReturnCode::FailedParsingPacket;
+        break;
+      }
+      const uint8_t* msg_data_ptr = data + block_offset + 2;
+      block_offset += block_len + 2;
+      if (!subscription_.Matches(msg_data_ptr, block_len)) {
+        continue;
+      }
+      chunk.messages.emplace_back();
+      ret_code = DecodeMessage(msg_data_ptr, chunk.messages.back());
+      if (ret_code != ReturnCode::Success) {
+        chunk.messages.pop_back();
+        break;
+      }
+    }
+    segment.end = chunk.messages.size();
+    chunk.segments.push_back(segment);
+    if (ret_code != ReturnCode::Success) {
+      chunk.ret_code = ret_code;
+      return chunk;
+    }
+  }
+  return chunk;
+}
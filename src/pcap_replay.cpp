@@ -0,0 +1,23 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "pcap_replayer.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: pcap_replay <input_pcap> <ip:port> [packets_per_second]" << std::endl;
+        return 1;
+    }
+
+    const double packets_per_second = argc > 3 ? std::atof(argv[3]) : 0;
+    PcapReplayer replayer;
+    if (!replayer.Open(argv[1], argv[2])) {
+        std::cout << "Failed to open '" << argv[1] << "' for replay." << std::endl;
+        return 1;
+    }
+
+    const size_t sent = replayer.Run(packets_per_second);
+    std::cout << "Sent " << sent << " packets to " << argv[2] << "." << std::endl;
+    return 0;
+}
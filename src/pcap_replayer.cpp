@@ -0,0 +1,95 @@
+#include "pcap_replayer.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+bool PcapReplayer::Open(const std::string& filename, const std::string& destination) {
+  Close();
+
+  const size_t colon = destination.rfind(':');
+  std::memset(&destination_, 0, sizeof(destination_));
+  destination_.sin_family = AF_INET;
+  if (colon == std::string::npos ||
+      inet_pton(AF_INET, destination.substr(0, colon).c_str(), &destination_.sin_addr) != 1) {
+    IEX_LOG("Cannot parse '" + destination + "', expected ip:port.");
+    return false;
+  }
+  // The whole port must be a number in 1..65535, a typo is not silently sent to port 0.
+  const char* port_begin = destination.c_str() + colon + 1;
+  const char* port_end = destination.c_str() + destination.size();
+  unsigned long port = 0;
+  const auto result = std::from_chars(port_begin, port_end, port);
+  if (result.ec != std::errc() || result.ptr != port_end || port == 0 || port > 65535) {
+    IEX_LOG("Cannot parse the port of '" + destination + "', expected a number in 1..65535.");
+    return false;
+  }
+  destination_.sin_port = htons(static_cast<uint16_t>(port));
+
+  if (!source_.Open(filename)) {
+    return false;
+  }
+  socket_fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_fd_ < 0) {
+    IEX_LOG("Cannot create a UDP socket: " << std::strerror(errno));
+    source_.Close();
+    return false;
+  }
+  // Keep multicast replays on the local machine.
+  const unsigned char ttl = 0;
+  ::setsockopt(socket_fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  return true;
+}
+
+void PcapReplayer::Close() {
+  if (socket_fd_ >= 0) {
+    ::close(socket_fd_);
+  }
+  socket_fd_ = -1;
+  source_.Close();
+}
+
+size_t PcapReplayer::Run(double packets_per_second, size_t max_packets, size_t skip_every) {
+  if (socket_fd_ < 0) {
+    IEX_LOG("The replayer has not opened a file yet, call Open first.");
+    return 0;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  size_t sent = 0;
+  size_t read = 0;
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  ReturnCode ret_code;
+  while ((ret_code = source_.GetNextPayload(data, len)) != ReturnCode::EndOfStream) {
+    if (ret_code != ReturnCode::Success) {
+      continue;
+    }
+    if (max_packets != 0 && sent >= max_packets) {
+      break;
+    }
+    ++read;
+    if (skip_every != 0 && read % skip_every == 0) {
+      continue;
+    }
+    if (packets_per_second > 0) {
+      // Pace against the start time, so sleep overshoot does not accumulate.
+      const auto due = start + std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>(sent / packets_per_second));
+      std::this_thread::sleep_until(due);
+    }
+    if (::sendto(socket_fd_, data, len, 0, reinterpret_cast<const sockaddr*>(&destination_),
+                 sizeof(destination_)) < 0) {
+      IEX_LOG("Sending failed: " << std::strerror(errno));
+      break;
+    }
+    ++sent;
+  }
+  return sent;
+}
@@ -0,0 +1,52 @@
+#include "price_levels.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+TickLadderPriceLevels::TickLadderPriceLevels(int64_t tick_size, size_t slot_count)
+    : tick_size_(tick_size) {
+  if (tick_size <= 0) {
+    throw std::invalid_argument("Tick size must be greater than zero.");
+  }
+  const size_t word_count = std::max<size_t>(1, (slot_count + 63) / 64);
+  sizes_.assign(word_count * 64, 0);
+  occupied_.assign(word_count, 0);
+  summary_.assign((word_count + 63) / 64, 0);
+}
+
+void TickLadderPriceLevels::Clear() {
+  std::fill(sizes_.begin(), sizes_.end(), 0);
+  std::fill(occupied_.begin(), occupied_.end(), 0);
+  std::fill(summary_.begin(), summary_.end(), 0);
+  ladder_count_ = 0;
+  sparse_.clear();
+}
+
+void TickLadderPriceLevels::Anchor(Price price) {
+  // Everything in the old window goes to the sparse map first, then whatever is on the grid
+  // within the new window comes back. Re-anchoring happens once per half window of drift, so
+  // the moves are rare next to the updates they speed up.
+  for (size_t word = 0; word < occupied_.size(); ++word) {
+    for (uint64_t bits = occupied_[word]; bits != 0; bits &= bits - 1) {
+      const size_t slot = word * 64 + __builtin_ctzll(bits);
+      sparse_.emplace(SlotPrice(slot), sizes_[slot]);
+      sizes_[slot] = 0;
+    }
+    occupied_[word] = 0;
+  }
+  std::fill(summary_.begin(), summary_.end(), 0);
+  ladder_count_ = 0;
+
+  anchor_step_ = price.GetTicks() / tick_size_ - static_cast<int64_t>(sizes_.size() / 2);
+  const Price first = SlotPrice(0);
+  const Price last = SlotPrice(sizes_.size() - 1);
+  for (auto it = sparse_.lower_bound(first); it != sparse_.end() && it->first <= last;) {
+    size_t slot = 0;
+    if (ToSlot(it->first, slot)) {
+      SetSlot(slot, it->second);
+      it = sparse_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,154 @@
+#include "quote_csv_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char header[] = "Timestamp,Symbol,BidSize,BidPrice,AskSize,AskPrice\n";
+
+constexpr uint64_t nanos_per_second = 1000000000;
+
+/// \brief Write the decimal digits of a value.
+///
+/// \return Pointer one past the last digit.
+char* FormatUnsigned(uint64_t value, char* out) {
+  char digits[20];
+  char* digit = digits + sizeof(digits);
+  do {
+    *--digit = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  const size_t len = digits + sizeof(digits) - digit;
+  std::memcpy(out, digit, len);
+  return out + len;
+}
+
+char* FormatSigned(int64_t value, char* out) {
+  if (value < 0) {
+    *out++ = '-';
+    return FormatUnsigned(0 - static_cast<uint64_t>(value), out);
+  }
+  return FormatUnsigned(static_cast<uint64_t>(value), out);
+}
+
+}  // namespace
+
+QuoteCsvWriter::QuoteCsvWriter(size_t buffer_size)
+    : buffer_(std::max(buffer_size, 4 * max_row_len)) {}
+
+bool QuoteCsvWriter::Open(const std::string& filename) {
+  Close();
+  fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    IEX_LOG("Cannot open " + filename + " for writing: " << std::strerror(errno));
+    return false;
+  }
+  failed_ = false;
+  used_ = sizeof(header) - 1;
+  std::memcpy(buffer_.data(), header, used_);
+  return true;
+}
+
+bool QuoteCsvWriter::Close() {
+  if (fd_ < 0) {
+    return true;
+  }
+  const bool success = Flush();
+  ::close(fd_);
+  fd_ = -1;
+  return success;
+}
+
+bool QuoteCsvWriter::Flush() {
+  size_t written = 0;
+  while (!failed_ && written < used_) {
+    const ssize_t ret = ::write(fd_, buffer_.data() + written, used_ - written);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      IEX_LOG("Failed writing quotes: " << std::strerror(errno));
+      failed_ = true;
+    } else {
+      written += static_cast<size_t>(ret);
+    }
+  }
+  used_ = 0;
+  return !failed_;
+}
+
+char* QuoteCsvWriter::FormatPrice(Price price, char* out) {
+  int64_t ticks = price.GetTicks();
+  if (ticks < 0) {
+    *out++ = '-';
+    ticks = -ticks;
+  }
+  out = FormatUnsigned(static_cast<uint64_t>(ticks) / Price::ticks_per_dollar, out);
+  int64_t fraction = ticks % Price::ticks_per_dollar;
+  if (fraction == 0) {
+    return out;
+  }
+  *out++ = '.';
+  for (int64_t digit = Price::ticks_per_dollar / 10; fraction != 0; digit /= 10) {
+    *out++ = static_cast<char>('0' + fraction / digit);
+    fraction %= digit;
+  }
+  return out;
+}
+
+char* QuoteCsvWriter::FormatTimestamp(uint64_t timestamp, char* out) {
+  const int64_t second = static_cast<int64_t>(timestamp / nanos_per_second);
+  if (second != cached_second_) {
+    const std::time_t time = static_cast<std::time_t>(second);
+    std::tm local_time;
+    localtime_r(&time, &local_time);
+    std::strftime(date_time_, sizeof(date_time_), "%F %T", &local_time);
+    cached_second_ = second;
+  }
+  std::memcpy(out, date_time_, date_time_len);
+  out += date_time_len;
+  *out++ = '.';
+  uint64_t nanos = timestamp % nanos_per_second;
+  for (int i = 8; i >= 0; --i) {
+    out[i] = static_cast<char>('0' + nanos % 10);
+    nanos /= 10;
+  }
+  return out + 9;
+}
+
+bool QuoteCsvWriter::WriteQuote(uint64_t timestamp, const Symbol& symbol, int bid_size,
+                                Price bid_price, int ask_size, Price ask_price) {
+  if (fd_ < 0 || (buffer_.size() - used_ < max_row_len && !Flush())) {
+    return false;
+  }
+  char* out = buffer_.data() + used_;
+  out = FormatTimestamp(timestamp, out);
+  *out++ = ',';
+  // The packed symbol is the padded wire field, copy it and drop the padding.
+  char symbol_chars[Symbol::length];
+  const uint64_t packed = symbol.GetPacked();
+  std::memcpy(symbol_chars, &packed, Symbol::length);
+  size_t symbol_len = Symbol::length;
+  while (symbol_len > 0 &&
+         (symbol_chars[symbol_len - 1] == ' ' || symbol_chars[symbol_len - 1] == '\0')) {
+    --symbol_len;
+  }
+  std::memcpy(out, symbol_chars, symbol_len);
+  out += symbol_len;
+  *out++ = ',';
+  out = FormatSigned(bid_size, out);
+  *out++ = ',';
+  out = FormatPrice(bid_price, out);
+  *out++ = ',';
+  out = FormatSigned(ask_size, out);
+  *out++ = ',';
+  out = FormatPrice(ask_price, out);
+  *out++ = '\n';
+  used_ = out - buffer_.data();
+  return true;
+}
@@ -0,0 +1,37 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "iex_decoder.h"
+#include "shm_ring.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: shm_publish <input_pcap> <ring_name> [capacity]" << std::endl;
+        return 1;
+    }
+
+    IEXDecoder decoder;
+    if (!decoder.OpenFileForDecoding(argv[1])) {
+        std::cout << "Failed to open file '" << argv[1] << "'." << std::endl;
+        return 1;
+    }
+
+    ShmRingPublisher publisher(argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1 << 20);
+    if (!publisher.Open(argv[2])) {
+        std::cout << "Failed to create ring '" << argv[2] << "'." << std::endl;
+        return 1;
+    }
+
+    const ReturnCode ret_code = publisher.PublishAll(decoder);
+    if (ret_code == ReturnCode::EndOfStream) {
+        std::cout << "Published all messages to " << argv[2] << "." << std::endl;
+    } else {
+        std::cout << "Publishing stopped early: " << ReturnCodeToString(ret_code) << std::endl;
+    }
+
+    // Give consumers the chance to drain the ring before its name disappears.
+    std::cout << "Press enter to exit." << std::endl;
+    std::cin.get();
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "shm_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmRingPublisher::ShmRingPublisher(size_t capacity) : capacity_(1) {
+  while (capacity_ < capacity) {
+    capacity_ *= 2;
+  }
+}
+
+bool ShmRingPublisher::Open(const std::string& name) {
+  Close();
+
+  // A ring left behind by a crashed publisher is replaced, consumers still attached to it keep
+  // their old mapping.
+  ::shm_unlink(name.c_str());
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    IEX_LOG("Cannot create shared memory " + name + ": " << std::strerror(errno));
+    return false;
+  }
+  const size_t mapping_len = shm_ring::GetMappingSize(capacity_);
+  if (::ftruncate(fd, mapping_len) != 0) {
+    IEX_LOG("Cannot size shared memory " + name + ": " << std::strerror(errno));
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  void* map = ::mmap(nullptr, mapping_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    IEX_LOG("Cannot map shared memory " + name + ": " << std::strerror(errno));
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+
+  // The object starts zeroed, so every slot sequence reads as "being written" until published.
+  header_ = new (map) shm_ring::Header();
+  slots_ = reinterpret_cast<shm_ring::Slot*>(static_cast<uint8_t*>(map) + sizeof(shm_ring::Header));
+  header_->capacity = capacity_;
+  header_->finished.store(0, std::memory_order_relaxed);
+  header_->write_count.store(0, std::memory_order_relaxed);
+  write_count_ = 0;
+  name_ = name;
+  header_->magic = shm_ring::magic;
+  return true;
+}
+
+void ShmRingPublisher::Close() {
+  if (!header_) {
+    return;
+  }
+  Finish();
+  ::munmap(header_, shm_ring::GetMappingSize(capacity_));
+  ::shm_unlink(name_.c_str());
+  header_ = nullptr;
+  slots_ = nullptr;
+  name_.clear();
+}
+
+bool ShmRingPublisher::Publish(const uint8_t* msg_data_ptr, size_t msg_len, int64_t sq_num) {
+  if (msg_len > shm_ring::max_message_len) {
+    IEX_LOG("Message of " << msg_len << " bytes does not fit a ring slot.");
+    return false;
+  }
+  shm_ring::Slot& slot = slots_[write_count_ & (capacity_ - 1)];
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.sq_num = sq_num;
+  slot.len = static_cast<uint16_t>(msg_len);
+  std::memcpy(slot.data, msg_data_ptr, msg_len);
+  ++write_count_;
+  slot.seq.store(write_count_, std::memory_order_release);
+  header_->write_count.store(write_count_, std::memory_order_release);
+  return true;
+}
+
+ReturnCode ShmRingPublisher::PublishAll(IEXDecoder& decoder) {
+  if (!header_) {
+    IEX_LOG("The publisher has not opened a ring yet, call Open first.");
+    return ReturnCode::ClassNotInitialized;
+  }
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  int64_t sq_num = 0;
+  ReturnCode ret_code;
+  while ((ret_code = decoder.GetNextRawMessage(msg_data_ptr, msg_len, sq_num)) ==
+         ReturnCode::Success) {
+    if (!Publish(msg_data_ptr, msg_len, sq_num)) {
+      return ReturnCode::FailedWriting;
+    }
+  }
+  return ret_code;
+}
+
+void ShmRingPublisher::Finish() {
+  if (header_) {
+    header_->finished.store(1, std::memory_order_release);
+  }
+}
+
+bool ShmRingConsumer::Open(const std::string& name, bool from_oldest) {
+  Close();
+
+  int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    IEX_LOG("Cannot open shared memory " + name + ": " << std::strerror(errno));
+    return false;
+  }
+  struct stat shm_stat;
+  if (::fstat(fd, &shm_stat) != 0 ||
+      shm_stat.st_size < static_cast<off_t>(sizeof(shm_ring::Header))) {
+    IEX_LOG(name + " is not a message ring.");
+    ::close(fd);
+    return false;
+  }
+  mapping_len_ = static_cast<size_t>(shm_stat.st_size);
+  void* map = ::mmap(nullptr, mapping_len_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    IEX_LOG("Cannot map shared memory " + name + ": " << std::strerror(errno));
+    return false;
+  }
+
+  header_ = static_cast<const shm_ring::Header*>(map);
+  capacity_ = header_->capacity;
+  if (header_->magic != shm_ring::magic || capacity_ == 0 || (capacity_ & (capacity_ - 1)) != 0 ||
+      mapping_len_ < shm_ring::GetMappingSize(capacity_)) {
+    IEX_LOG(name + " is not a message ring.");
+    Close();
+    return false;
+  }
+  slots_ = reinterpret_cast<const shm_ring::Slot*>(static_cast<const uint8_t*>(map) +
+                                                   sizeof(shm_ring::Header));
+
+  const uint64_t write_count = header_->write_count.load(std::memory_order_acquire);
+  read_count_ = from_oldest && write_count > capacity_ ? write_count - capacity_
+                : from_oldest                         ? 0
+                                                      : write_count;
+  last_sq_num_ = 0;
+  overrun_count_ = 0;
+  missed_count_ = 0;
+  return true;
+}
+
+void ShmRingConsumer::Close() {
+  if (header_) {
+    ::munmap(const_cast<shm_ring::Header*>(header_), mapping_len_);
+  }
+  header_ = nullptr;
+  slots_ = nullptr;
+}
+
+uint64_t ShmRingConsumer::GetLag() const {
+  if (!header_) {
+    return 0;
+  }
+  return header_->write_count.load(std::memory_order_acquire) - read_count_;
+}
+
+void ShmRingConsumer::Resync() {
+  const uint64_t write_count = header_->write_count.load(std::memory_order_acquire);
+  // Leave some headroom, the publisher keeps writing while this consumer catches up.
+  const uint64_t oldest = write_count > capacity_ ? write_count - capacity_ + capacity_ / 8 : 0;
+  if (oldest > read_count_) {
+    ++overrun_count_;
+    missed_count_ += oldest - read_count_;
+    read_count_ = oldest;
+  }
+}
+
+ReturnCode ShmRingConsumer::GetNextMessage(IEXMessage& msg) {
+  if (!header_) {
+    return ReturnCode::ClassNotInitialized;
+  }
+  while (true) {
+    const shm_ring::Slot& slot = slots_[read_count_ & (capacity_ - 1)];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == read_count_ + 1) {
+      // Copy first and check the sequence again afterwards, the publisher may have started
+      // overwriting the slot in the meantime.
+      const size_t len = std::min<size_t>(slot.len, shm_ring::max_message_len);
+      const int64_t sq_num = slot.sq_num;
+      std::memcpy(buffer_, slot.data, len);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == seq) {
+        ++read_count_;
+        last_sq_num_ = sq_num;
+        return DecodeMessage(buffer_, msg);
+      }
+    } else if (seq <= read_count_ && seq != 0) {
+      // The slot still holds an older message, nothing new was published.
+      if (header_->finished.load(std::memory_order_acquire) &&
+          header_->write_count.load(std::memory_order_acquire) == read_count_) {
+        return ReturnCode::EndOfStream;
+      }
+      return ReturnCode::WouldBlock;
+    } else if (header_->write_count.load(std::memory_order_acquire) <= read_count_) {
+      // A slot that was never written, or the message this consumer waits for is being written.
+      if (header_->finished.load(std::memory_order_acquire)) {
+        return ReturnCode::EndOfStream;
+      }
+      return ReturnCode::WouldBlock;
+    }
+    // The slot was overwritten by a later lap of the publisher.
+    Resync();
+  }
+}
@@ -0,0 +1,60 @@
+#include "snapshot_io.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "iex_messages.h"
+
+namespace {
+
+/// \brief Write all of data to fd, retrying short writes.
+bool WriteFully(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    const ssize_t written = ::write(fd, data, len);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    len -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace snapshot_io {
+
+bool WriteFileAtomically(const std::string& path, std::initializer_list<std::string_view> parts) {
+  const std::string tmp_path = path + ".tmp";
+  const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    IEX_LOG("Cannot open " + tmp_path + " for writing: " + std::strerror(errno));
+    return false;
+  }
+  bool success = true;
+  for (const std::string_view part : parts) {
+    success = success && WriteFully(fd, part.data(), part.size());
+  }
+  success = success && ::fsync(fd) == 0;
+  ::close(fd);
+  if (!success) {
+    IEX_LOG("Failed writing " + tmp_path + ": " + std::strerror(errno));
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    IEX_LOG("Cannot rename " + tmp_path + " to " + path + ".");
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace snapshot_io
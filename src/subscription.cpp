@@ -0,0 +1,27 @@
+#include "subscription.h"
+
+Subscription::Subscription() : symbols_(16) {
+  for (auto type : {MessageType::SecurityDirectory, MessageType::SecurityEvent,
+                    MessageType::TradingStatus, MessageType::RetailLiquidityIndicator,
+                    MessageType::OperationalHaltStatus, MessageType::ShortSalePriceTestStatus,
+                    MessageType::QuoteUpdate, MessageType::TradeReport, MessageType::OfficialPrice,
+                    MessageType::TradeBreak, MessageType::AuctionInformation,
+                    MessageType::PriceLevelUpdateBuy, MessageType::PriceLevelUpdateSell,
+                    MessageType::AddOrder, MessageType::OrderModify, MessageType::OrderDelete,
+                    MessageType::OrderExecuted, MessageType::ClearBook}) {
+    symbol_types_.set(static_cast<uint8_t>(type));
+  }
+}
+
+Subscription& Subscription::AddMessageType(MessageType type) {
+  types_.set(static_cast<uint8_t>(type));
+  filter_types_ = true;
+  match_all_ = false;
+  return *this;
+}
+
+Subscription& Subscription::AddSymbol(const Symbol& symbol) {
+  symbols_.Intern(symbol);
+  match_all_ = false;
+  return *this;
+}
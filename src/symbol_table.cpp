@@ -0,0 +1,60 @@
+#include "symbol_table.h"
+
+#include <functional>
+
+SymbolTable::SymbolTable(size_t expected_symbols) {
+  // Keep the load factor at or below one half.
+  size_t capacity = 16;
+  while (capacity < expected_symbols * 2) {
+    capacity *= 2;
+  }
+  slot_keys_.assign(capacity, 0);
+  slot_ids_.assign(capacity, invalid_id);
+  symbols_.reserve(expected_symbols);
+}
+
+size_t SymbolTable::Probe(uint64_t packed) const {
+  const size_t mask = slot_keys_.size() - 1;
+  size_t slot = std::hash<Symbol>()(Symbol::FromPacked(packed)) & mask;
+  while (slot_keys_[slot] != 0 && slot_keys_[slot] != packed) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+size_t SymbolTable::GetProbeLength(const Symbol& symbol) const {
+  const size_t mask = slot_keys_.size() - 1;
+  const size_t home = std::hash<Symbol>()(symbol) & mask;
+  return ((Probe(symbol.GetPacked()) - home) & mask) + 1;
+}
+
+uint32_t SymbolTable::Intern(const Symbol& symbol) {
+  size_t slot = Probe(symbol.GetPacked());
+  if (slot_keys_[slot] != 0) {
+    return slot_ids_[slot];
+  }
+  if ((symbols_.size() + 1) * 2 > slot_keys_.size()) {
+    Grow();
+    slot = Probe(symbol.GetPacked());
+  }
+  const uint32_t id = static_cast<uint32_t>(symbols_.size());
+  slot_keys_[slot] = symbol.GetPacked();
+  slot_ids_[slot] = id;
+  symbols_.push_back(symbol);
+  return id;
+}
+
+uint32_t SymbolTable::Find(const Symbol& symbol) const {
+  const size_t slot = Probe(symbol.GetPacked());
+  return slot_keys_[slot] != 0 ? slot_ids_[slot] : invalid_id;
+}
+
+void SymbolTable::Grow() {
+  slot_keys_.assign(slot_keys_.size() * 2, 0);
+  slot_ids_.assign(slot_keys_.size(), invalid_id);
+  for (uint32_t id = 0; id < symbols_.size(); ++id) {
+    const size_t slot = Probe(symbols_[id].GetPacked());
+    slot_keys_[slot] = symbols_[id].GetPacked();
+    slot_ids_[slot] = id;
+  }
+}
@@ -0,0 +1,184 @@
+#include "udp_packet_source.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+/// \brief Split "ip:port" into a socket address.
+bool ParseAddress(const std::string& address, sockaddr_in& sock_addr) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+  std::memset(&sock_addr, 0, sizeof(sock_addr));
+  sock_addr.sin_family = AF_INET;
+  const char* port_end = address.c_str() + address.size();
+  unsigned long port = 0;
+  const auto result = std::from_chars(address.c_str() + colon + 1, port_end, port);
+  if (result.ec != std::errc() || result.ptr != port_end || port > 65535) {
+    return false;
+  }
+  sock_addr.sin_port = htons(static_cast<uint16_t>(port));
+  return inet_pton(AF_INET, address.substr(0, colon).c_str(), &sock_addr.sin_addr) == 1;
+}
+
+/// \brief Length of the IEX-TP header at the start of each segment.
+constexpr size_t segment_header_len = 40;
+
+}  // namespace
+
+UdpPacketSource::UdpPacketSource(size_t batch_size, int timeout_ms)
+    : timeout_ms_(timeout_ms),
+      buffer_(std::max<size_t>(batch_size, 1) * max_datagram_len),
+      headers_(std::max<size_t>(batch_size, 1)),
+      iovecs_(std::max<size_t>(batch_size, 1)) {
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    iovecs_[i].iov_base = buffer_.data() + i * max_datagram_len;
+    iovecs_[i].iov_len = max_datagram_len;
+    std::memset(&headers_[i], 0, sizeof(headers_[i]));
+    headers_[i].msg_hdr.msg_iov = &iovecs_[i];
+    headers_[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+bool UdpPacketSource::Open(const std::string& address) {
+  Close();
+
+  sockaddr_in sock_addr;
+  if (!ParseAddress(address, sock_addr)) {
+    IEX_LOG("Cannot parse '" + address + "', expected ip:port.");
+    return false;
+  }
+  const bool multicast = IN_MULTICAST(ntohl(sock_addr.sin_addr.s_addr));
+
+  socket_fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_fd_ < 0) {
+    IEX_LOG("Cannot create a UDP socket: " << std::strerror(errno));
+    return false;
+  }
+  const int reuse = 1;
+  ::setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  // A large kernel buffer absorbs bursts while the decoder is busy. The kernel may cap the size.
+  const int receive_buffer = 16 << 20;
+  ::setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+  if (timeout_ms_ > 0) {
+    timeval timeout;
+    timeout.tv_sec = timeout_ms_ / 1000;
+    timeout.tv_usec = (timeout_ms_ % 1000) * 1000;
+    ::setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  // Multicast groups are received by binding the group port on any address.
+  sockaddr_in bind_addr = sock_addr;
+  if (multicast) {
+    bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  }
+  if (::bind(socket_fd_, reinterpret_cast<sockaddr*>(&bind_addr), sizeof(bind_addr)) != 0) {
+    IEX_LOG("Cannot bind to " + address + ": " << std::strerror(errno));
+    Close();
+    return false;
+  }
+  if (multicast) {
+    ip_mreq membership;
+    membership.imr_multiaddr = sock_addr.sin_addr;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (::setsockopt(socket_fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership,
+                     sizeof(membership)) != 0) {
+      IEX_LOG("Cannot join multicast group " + address + ": " << std::strerror(errno));
+      Close();
+      return false;
+    }
+  }
+
+  sockaddr_in bound_addr;
+  socklen_t bound_len = sizeof(bound_addr);
+  ::getsockname(socket_fd_, reinterpret_cast<sockaddr*>(&bound_addr), &bound_len);
+  port_ = ntohs(bound_addr.sin_port);
+
+  batch_count_ = 0;
+  batch_pos_ = 0;
+  expected_sq_num_ = 0;
+  gap_count_ = 0;
+  missed_messages_ = 0;
+  return true;
+}
+
+void UdpPacketSource::Close() {
+  if (socket_fd_ >= 0) {
+    ::close(socket_fd_);
+  }
+  socket_fd_ = -1;
+  port_ = 0;
+}
+
+ReturnCode UdpPacketSource::ReceiveBatch() {
+  batch_count_ = 0;
+  batch_pos_ = 0;
+  while (true) {
+    // Block for the first datagram only, then take whatever else is already queued.
+    const int received = ::recvmmsg(socket_fd_, headers_.data(), headers_.size(), MSG_WAITFORONE,
+                                    nullptr);
+    if (received > 0) {
+      batch_count_ = static_cast<size_t>(received);
+      return ReturnCode::Success;
+    }
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      IEX_LOG("No data received for " << timeout_ms_ << " ms, treating the feed as ended.");
+      return ReturnCode::EndOfStream;
+    }
+    IEX_LOG("Receiving from the feed failed: " << std::strerror(errno));
+    return ReturnCode::FailedParsingPacket;
+  }
+}
+
+void UdpPacketSource::TrackSequence(const uint8_t* data, size_t len) {
+  if (len < segment_header_len) {
+    return;
+  }
+  uint16_t message_count;
+  int64_t first_msg_sq_num;
+  std::memcpy(&message_count, data + 14, sizeof(message_count));
+  std::memcpy(&first_msg_sq_num, data + 24, sizeof(first_msg_sq_num));
+
+  if (expected_sq_num_ != 0 && first_msg_sq_num > expected_sq_num_) {
+    ++gap_count_;
+    missed_messages_ += first_msg_sq_num - expected_sq_num_;
+    IEX_LOG("Gap in the feed, expected sequence " << expected_sq_num_ << " but received "
+                                                  << first_msg_sq_num << ".");
+  }
+  // Late or duplicated segments do not move the expectation backwards.
+  expected_sq_num_ = std::max(expected_sq_num_, first_msg_sq_num + message_count);
+}
+
+ReturnCode UdpPacketSource::GetNextPayload(const uint8_t*& data, size_t& len) {
+  if (socket_fd_ < 0) {
+    return ReturnCode::ClassNotInitialized;
+  }
+  if (batch_pos_ == batch_count_) {
+    auto ret_code = ReceiveBatch();
+    if (ret_code != ReturnCode::Success) {
+      return ret_code;
+    }
+  }
+
+  const auto& header = headers_[batch_pos_];
+  data = static_cast<const uint8_t*>(iovecs_[batch_pos_].iov_base);
+  len = header.msg_len;
+  ++batch_pos_;
+  if (header.msg_hdr.msg_flags & MSG_TRUNC) {
+    IEX_LOG("Received a datagram larger than " << max_datagram_len << " bytes.");
+    return ReturnCode::FailedParsingPacket;
+  }
+  TrackSequence(data, len);
+  return ReturnCode::Success;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "symbol.h"
+
+// Helpers writing small synthetic captures for the tests that cannot rely on the sample data.
+
+inline void AppendBytes(std::vector<uint8_t>& out, const void* data, size_t len) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  out.insert(out.end(), bytes, bytes + len);
+}
+
+template <typename T>
+inline void AppendValue(std::vector<uint8_t>& out, T value) {
+  AppendBytes(out, &value, sizeof(value));
+}
+
+// Build a raw IPv4 (link type 101) pcap with one UDP datagram per payload.
+inline std::vector<uint8_t> BuildPcap(const std::vector<std::string>& payloads) {
+  std::vector<uint8_t> pcap;
+  AppendValue<uint32_t>(pcap, 0xa1b2c3d4);
+  AppendValue<uint32_t>(pcap, 0x00040002);
+  AppendValue<uint32_t>(pcap, 0);
+  AppendValue<uint32_t>(pcap, 0);
+  AppendValue<uint32_t>(pcap, 65535);
+  AppendValue<uint32_t>(pcap, 101);
+  for (const auto& payload : payloads) {
+    const uint32_t frame_len = 20 + 8 + payload.size();
+    AppendValue<uint32_t>(pcap, 0);
+    AppendValue<uint32_t>(pcap, 0);
+    AppendValue<uint32_t>(pcap, frame_len);
+    AppendValue<uint32_t>(pcap, frame_len);
+    std::vector<uint8_t> frame(28, 0);
+    frame[0] = 0x45;
+    frame[9] = 17;
+    const uint16_t udp_len = 8 + payload.size();
+    frame[24] = udp_len >> 8;
+    frame[25] = udp_len & 0xff;
+    pcap.insert(pcap.end(), frame.begin(), frame.end());
+    pcap.insert(pcap.end(), payload.begin(), payload.end());
+  }
+  return pcap;
+}
+
+// Write a pcap of the payloads to a file.
+inline bool WritePcapFile(const std::string& filename, const std::vector<std::string>& payloads) {
+  const std::vector<uint8_t> pcap = BuildPcap(payloads);
+  std::ofstream out(filename, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(pcap.data()), pcap.size());
+  return static_cast<bool>(out);
+}
+
+// Build an IEX-TP segment carrying the given message blocks.
+inline std::string BuildSegment(int64_t first_msg_sq_num, int64_t send_time,
+                                const std::vector<std::string>& messages) {
+  std::vector<uint8_t> body;
+  for (const auto& message : messages) {
+    AppendValue<uint16_t>(body, message.size());
+    AppendBytes(body, message.data(), message.size());
+  }
+  std::vector<uint8_t> segment;
+  AppendValue<uint8_t>(segment, 1);
+  AppendValue<uint8_t>(segment, 0);
+  AppendValue<uint16_t>(segment, 0x8004);
+  AppendValue<uint32_t>(segment, 1);
+  AppendValue<uint32_t>(segment, 1);
+  AppendValue<uint16_t>(segment, body.size());
+  AppendValue<uint16_t>(segment, messages.size());
+  AppendValue<int64_t>(segment, 0);
+  AppendValue<int64_t>(segment, first_msg_sq_num);
+  AppendValue<int64_t>(segment, send_time);
+  segment.insert(segment.end(), body.begin(), body.end());
+  return std::string(segment.begin(), segment.end());
+}
+
+// Write a capture of the segments, preceded by a header only segment as real captures start.
+inline bool WriteSegmentCapture(const std::string& filename, int64_t send_time,
+                                const std::vector<std::string>& segments) {
+  std::vector<std::string> payloads = {BuildSegment(1, send_time, {})};
+  payloads.insert(payloads.end(), segments.begin(), segments.end());
+  return WritePcapFile(filename, payloads);
+}
+
+// Build a SystemEvent message.
+inline std::string BuildSystemEvent(char code, int64_t timestamp) {
+  std::vector<uint8_t> message;
+  AppendValue<uint8_t>(message, 0x53);
+  AppendValue<uint8_t>(message, code);
+  AppendValue<int64_t>(message, timestamp);
+  return std::string(message.begin(), message.end());
+}
+
+// Build a PriceLevelUpdate message, type 0x38 for the buy side or 0x35 for the sell side.
+inline std::string BuildPriceLevelUpdate(uint8_t type, int64_t timestamp, const char* symbol,
+                                         uint32_t size, int64_t price_ticks) {
+  std::vector<uint8_t> message;
+  AppendValue<uint8_t>(message, type);
+  AppendValue<uint8_t>(message, 1);
+  AppendValue<int64_t>(message, timestamp);
+  AppendValue<uint64_t>(message, Symbol(symbol).GetPacked());
+  AppendValue<uint32_t>(message, size);
+  AppendValue<int64_t>(message, price_ticks);
+  return std::string(message.begin(), message.end());
+}
+
+// Build an AddOrder message for the buy side.
+inline std::string BuildAddOrder(int64_t timestamp, const char* symbol, uint64_t order_id,
+                                 uint32_t size, int64_t price_ticks) {
+  std::vector<uint8_t> message;
+  AppendValue<uint8_t>(message, 0x61);
+  AppendValue<uint8_t>(message, '8');
+  AppendValue<int64_t>(message, timestamp);
+  AppendValue<uint64_t>(message, Symbol(symbol).GetPacked());
+  AppendValue<uint64_t>(message, order_id);
+  AppendValue<uint32_t>(message, size);
+  AppendValue<int64_t>(message, price_ticks);
+  return std::string(message.begin(), message.end());
+}
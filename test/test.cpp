@@ -1,11 +1,21 @@
 #include <iostream>
 #include "gtest/gtest.h"
 
+#include "book_pipeline.h"
 #include "iex_decoder.h"
 #include "iex_messages.h"
+#include "message_merger.h"
+#include "parallel_decoder.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -256,3 +266,357 @@ TEST_F(DecoderTest, SecurityEventTest) {
             SecurityEventMessage::SecurityMessageType::OpeningProcessComplete);
 }
 
+
+// The memory mapped reader must yield exactly the same message stream as the PcapPlusPlus reader.
+TEST_F(DecoderTest, MemoryMappedReaderTest) {
+  IEXDecoder mmap_decoder;
+  ASSERT_TRUE(mmap_decoder.OpenFileForDecoding(deep_pcap_filepath, ReaderBackend::MemoryMapped));
+  ASSERT_EQ(msgs_.size(), 105068u);
+  for (const auto& expected : msgs_) {
+    std::unique_ptr<IEXMessageBase> msg_ptr;
+    ASSERT_EQ(mmap_decoder.GetNextMessage(msg_ptr), ReturnCode::Success);
+    EXPECT_EQ(msg_ptr->GetMessageType(), expected->GetMessageType());
+    EXPECT_EQ(msg_ptr->timestamp, expected->timestamp);
+    EXPECT_EQ(msg_ptr->GetSymbol(), expected->GetSymbol());
+  }
+  std::unique_ptr<IEXMessageBase> msg_ptr;
+  EXPECT_EQ(mmap_decoder.GetNextMessage(msg_ptr), ReturnCode::EndOfStream);
+  EXPECT_EQ(mmap_decoder.GetLastDecodedHeader().first_msg_sq_num,
+            decoder_.GetLastDecodedHeader().first_msg_sq_num);
+}
+
+// ForEachMessage must visit the same messages as GetNextMessage, in the same order.
+TEST_F(DecoderTest, ForEachMessageTest) {
+  struct Visitor {
+    const std::vector<std::unique_ptr<IEXMessageBase>>& expected;
+    size_t idx = 0;
+    size_t price_level_updates = 0;
+
+    void operator()(const PriceLevelUpdateMessage& msg) {
+      ++price_level_updates;
+      (*this)(static_cast<const IEXMessageBase&>(msg));
+    }
+    void operator()(const IEXMessageBase& msg) {
+      ASSERT_LT(idx, expected.size());
+      EXPECT_EQ(msg.GetMessageType(), expected[idx]->GetMessageType());
+      EXPECT_EQ(msg.timestamp, expected[idx]->timestamp);
+      ++idx;
+    }
+  };
+
+  IEXDecoder visit_decoder;
+  ASSERT_TRUE(visit_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  Visitor visitor{msgs_};
+  EXPECT_EQ(visit_decoder.ForEachMessage(visitor), ReturnCode::EndOfStream);
+  EXPECT_EQ(visitor.idx, msgs_.size());
+  EXPECT_GT(visitor.price_level_updates, 0u);
+}
+
+// Decoding in place into an IEXMessage variant yields the same messages as the factory path.
+TEST_F(DecoderTest, VariantDecodeTest) {
+  IEXDecoder variant_decoder;
+  ASSERT_TRUE(variant_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  IEXMessage msg;
+  for (const auto& expected : msgs_) {
+    ASSERT_EQ(variant_decoder.GetNextMessage(msg), ReturnCode::Success);
+    EXPECT_EQ(GetMessageBase(msg).GetMessageType(), expected->GetMessageType());
+    EXPECT_EQ(GetMessageBase(msg).timestamp, expected->timestamp);
+  }
+  EXPECT_EQ(variant_decoder.GetNextMessage(msg), ReturnCode::EndOfStream);
+
+  constexpr int msg_idx = 25781;
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(deep_pcap_filepath));
+  for (int i = 0; i <= msg_idx; ++i) {
+    ASSERT_EQ(decoder.GetNextMessage(msg), ReturnCode::Success);
+  }
+  auto* price_lvl_msg = std::get_if<PriceLevelUpdateMessage>(&msg);
+  ASSERT_NE(price_lvl_msg, nullptr);
+  EXPECT_EQ(price_lvl_msg->symbol, "ZIEXT");
+  EXPECT_EQ(price_lvl_msg->size, 351);
+}
+
+// DecodeBatch must yield the same message stream, one segment at a time.
+TEST_F(DecoderTest, DecodeBatchTest) {
+  IEXDecoder batch_decoder;
+  ASSERT_TRUE(batch_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  // Deliberately small, so some segments need more than one call.
+  std::vector<IEXMessage> batch(4);
+  size_t count = 0;
+  size_t idx = 0;
+  ReturnCode ret_code;
+  while ((ret_code = batch_decoder.DecodeBatch(batch.data(), batch.size(), count)) ==
+         ReturnCode::Success) {
+    ASSERT_LE(idx + count, msgs_.size());
+    EXPECT_LE(count, batch_decoder.GetLastDecodedHeader().message_count);
+    for (size_t i = 0; i < count; ++i, ++idx) {
+      EXPECT_EQ(GetMessageBase(batch[i]).GetMessageType(), msgs_[idx]->GetMessageType());
+      EXPECT_EQ(GetMessageBase(batch[i]).timestamp, msgs_[idx]->timestamp);
+    }
+  }
+  EXPECT_EQ(ret_code, ReturnCode::EndOfStream);
+  EXPECT_EQ(idx, msgs_.size());
+}
+
+// Decoding with several threads must deliver the same stream as the sequential decoder.
+TEST_F(DecoderTest, ParallelDecoderTest) {
+  // Small chunks, so the file is spread over many of them.
+  ParallelDecoder parallel_decoder(4, 16);
+  ASSERT_TRUE(parallel_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  EXPECT_GT(parallel_decoder.GetPacketCount(), 0u);
+  size_t idx = 0;
+  auto ret_code = parallel_decoder.ForEachMessage([&](const IEXMessage& msg) {
+    ASSERT_LT(idx, msgs_.size());
+    EXPECT_EQ(GetMessageBase(msg).GetMessageType(), msgs_[idx]->GetMessageType());
+    EXPECT_EQ(GetMessageBase(msg).timestamp, msgs_[idx]->timestamp);
+    ++idx;
+  });
+  EXPECT_EQ(ret_code, ReturnCode::EndOfStream);
+  EXPECT_EQ(idx, msgs_.size());
+}
+
+// Seeking must land on the same messages a full sequential decode reaches.
+TEST_F(DecoderTest, SeekTest) {
+  struct SegmentStart {
+    int64_t send_time;
+    int64_t first_msg_sq_num;
+    uint16_t message_count;
+    std::vector<uint64_t> timestamps;
+  };
+  std::vector<SegmentStart> segments;
+  {
+    IEXDecoder scan_decoder;
+    ASSERT_TRUE(scan_decoder.OpenFileForDecoding(deep_pcap_filepath, ReaderBackend::MemoryMapped));
+    std::vector<IEXMessage> batch(1024);
+    size_t count = 0;
+    while (scan_decoder.DecodeBatch(batch.data(), batch.size(), count) == ReturnCode::Success) {
+      const auto& header = scan_decoder.GetLastDecodedHeader();
+      SegmentStart segment{header.send_time, header.first_msg_sq_num, header.message_count, {}};
+      for (size_t i = 0; i < count; ++i) {
+        segment.timestamps.push_back(GetMessageBase(batch[i]).timestamp);
+      }
+      segments.push_back(segment);
+    }
+  }
+  ASSERT_GT(segments.size(), 2u);
+  const SegmentStart& target = segments[segments.size() / 2];
+
+  // The sidecar index is written next to the capture, so seek through a link in the temp dir.
+  char* real_path = ::realpath(deep_pcap_filepath.c_str(), nullptr);
+  ASSERT_NE(real_path, nullptr);
+  const std::string link_path = ::testing::TempDir() + "seek_test_" + deep_pcap_filename;
+  std::remove(link_path.c_str());
+  const int linked = ::symlink(real_path, link_path.c_str());
+  std::free(real_path);
+  ASSERT_EQ(linked, 0);
+
+  // The first seek builds and saves the sidecar index, the second open loads it.
+  for (int pass = 0; pass < 2; ++pass) {
+    IEXDecoder seek_decoder;
+    ASSERT_TRUE(seek_decoder.OpenFileForDecoding(link_path, ReaderBackend::MemoryMapped));
+    IEXMessage msg;
+    ASSERT_EQ(seek_decoder.SeekToTime(target.send_time), ReturnCode::Success);
+    ASSERT_EQ(seek_decoder.GetNextMessage(msg), ReturnCode::Success);
+    EXPECT_EQ(GetMessageBase(msg).timestamp, target.timestamps.front());
+
+    if (target.message_count > 1) {
+      ASSERT_EQ(seek_decoder.SeekToSequence(target.first_msg_sq_num + 1), ReturnCode::Success);
+      ASSERT_EQ(seek_decoder.GetNextMessage(msg), ReturnCode::Success);
+      EXPECT_EQ(GetMessageBase(msg).timestamp, target.timestamps[1]);
+    }
+  }
+  std::remove(PacketIndex::GetSidecarPath(link_path).c_str());
+  std::remove(link_path.c_str());
+}
+
+// A subscription must deliver exactly the matching subset of the full stream.
+TEST_F(DecoderTest, SubscriptionTest) {
+  const Symbol symbol = "ZIEXT";
+  std::vector<uint64_t> expected;
+  for (const auto& msg : msgs_) {
+    if (msg->GetMessageType() == MessageType::SystemEvent ||
+        (msg->GetMessageType() == MessageType::PriceLevelUpdateBuy && msg->GetSymbol() == symbol)) {
+      expected.push_back(msg->timestamp);
+    }
+  }
+
+  IEXDecoder filtered_decoder;
+  ASSERT_TRUE(filtered_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  filtered_decoder.SetSubscription(Subscription()
+                                       .AddSymbol(symbol)
+                                       .AddMessageType(MessageType::PriceLevelUpdateBuy)
+                                       .AddMessageType(MessageType::SystemEvent));
+  IEXMessage msg;
+  size_t idx = 0;
+  while (filtered_decoder.GetNextMessage(msg) == ReturnCode::Success) {
+    ASSERT_LT(idx, expected.size());
+    EXPECT_EQ(GetMessageBase(msg).timestamp, expected[idx++]);
+  }
+  EXPECT_EQ(idx, expected.size());
+}
+
+// Regular hours mode must deliver exactly the messages from the open to the close event.
+TEST_F(DecoderTest, RegularHoursTest) {
+  auto is_event = [](const IEXMessageBase& msg, SystemEventMessage::Code code) {
+    auto system_event = dynamic_cast<const SystemEventMessage*>(&msg);
+    return system_event && system_event->system_event == code;
+  };
+  std::vector<uint64_t> expected;
+  bool in_session = false;
+  for (const auto& msg : msgs_) {
+    in_session |= is_event(*msg, SystemEventMessage::Code::StartOfRegularMarketHours);
+    if (in_session) {
+      expected.push_back(msg->timestamp);
+    }
+    if (is_event(*msg, SystemEventMessage::Code::EndOfRegularMarketHours)) {
+      break;
+    }
+  }
+
+  IEXDecoder session_decoder;
+  ASSERT_TRUE(session_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  session_decoder.SetRegularHoursOnly(true);
+  IEXMessage msg;
+  size_t idx = 0;
+  while (session_decoder.GetNextMessage(msg) == ReturnCode::Success) {
+    ASSERT_LT(idx, expected.size());
+    EXPECT_EQ(GetMessageBase(msg).timestamp, expected[idx++]);
+  }
+  EXPECT_EQ(idx, expected.size());
+
+  // A time window keeps only segments sent inside it. Message timestamps are not later than the
+  // send time of their segment, so start the window at the earliest message of a segment sent
+  // after the previous one could be in it.
+  struct SegmentTimes {
+    int64_t send_time;
+    int64_t first_timestamp;
+    size_t message_count;
+  };
+  std::vector<SegmentTimes> segments;
+  {
+    IEXDecoder scan_decoder;
+    ASSERT_TRUE(scan_decoder.OpenFileForDecoding(deep_pcap_filepath, ReaderBackend::MemoryMapped));
+    std::vector<IEXMessage> batch(1024);
+    size_t count = 0;
+    while (scan_decoder.DecodeBatch(batch.data(), batch.size(), count) == ReturnCode::Success) {
+      const auto& header = scan_decoder.GetLastDecodedHeader();
+      if (segments.empty() || segments.back().send_time != header.send_time) {
+        segments.push_back({header.send_time, std::numeric_limits<int64_t>::max(), 0});
+      }
+      for (size_t i = 0; i < count; ++i) {
+        segments.back().first_timestamp = std::min<int64_t>(
+            segments.back().first_timestamp, GetMessageBase(batch[i]).timestamp);
+      }
+      segments.back().message_count += count;
+    }
+  }
+  ASSERT_GT(segments.size(), 3u);
+  size_t first = segments.size() / 3;
+  while (first < segments.size() && segments[first - 1].send_time >= segments[first].first_timestamp) {
+    ++first;
+  }
+  const size_t last = std::max(first + 1, 2 * segments.size() / 3);
+  ASSERT_LT(last, segments.size());
+  const int64_t start = segments[first].first_timestamp;
+  const int64_t end = segments[last].send_time;
+  size_t expected_count = 0;
+  for (size_t i = first; i < last; ++i) {
+    expected_count += segments[i].message_count;
+  }
+
+  IEXDecoder window_decoder;
+  ASSERT_TRUE(window_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  window_decoder.SetTimeWindow(start, end);
+  size_t count = 0;
+  while (window_decoder.GetNextMessage(msg) == ReturnCode::Success) {
+    const int64_t timestamp = GetMessageBase(msg).timestamp;
+    if (count == 0) {
+      EXPECT_GE(timestamp, start);
+    }
+    EXPECT_LT(timestamp, end);
+    EXPECT_GE(window_decoder.GetLastDecodedHeader().send_time, start);
+    EXPECT_LT(window_decoder.GetLastDecodedHeader().send_time, end);
+    ++count;
+  }
+  EXPECT_EQ(count, expected_count);
+}
+
+// Books built on the pipeline workers must end up identical to books built in a single thread.
+TEST_F(DecoderTest, BookPipelineTest) {
+  std::map<Symbol, OrderBook> expected;
+  for (const auto& msg : msgs_) {
+    const auto type = msg->GetMessageType();
+    if (type == MessageType::PriceLevelUpdateBuy || type == MessageType::PriceLevelUpdateSell) {
+      // The pipeline counts and skips updates a book rejects, do the same here.
+      try {
+        expected[msg->GetSymbol()].ProcessMessage(*msg);
+      } catch (const std::exception&) {
+      }
+    }
+  }
+  ASSERT_FALSE(expected.empty());
+
+  IEXDecoder pipeline_decoder;
+  ASSERT_TRUE(pipeline_decoder.OpenFileForDecoding(deep_pcap_filepath));
+  BookPipeline pipeline(3, 4);
+  EXPECT_EQ(pipeline.Run(pipeline_decoder), ReturnCode::EndOfStream);
+  EXPECT_EQ(pipeline.GetStats().messages, msgs_.size());
+
+  uint64_t applied = 0;
+  for (const auto& worker : pipeline.GetStats().workers) {
+    applied += worker.records;
+  }
+  EXPECT_EQ(applied, pipeline.GetStats().decoder.records);
+
+  for (const auto& entry : expected) {
+    const OrderBook* book = pipeline.GetOrderBook(entry.first);
+    ASSERT_NE(book, nullptr);
+    const auto bbo = book->GetBbo();
+    const auto expected_bbo = entry.second.GetBbo();
+    ASSERT_EQ(bbo.has_value(), expected_bbo.has_value());
+    if (bbo) {
+      EXPECT_EQ(bbo->getBidTicks(), expected_bbo->getBidTicks());
+      EXPECT_EQ(bbo->getBidSize(), expected_bbo->getBidSize());
+      EXPECT_EQ(bbo->getAskTicks(), expected_bbo->getAskTicks());
+      EXPECT_EQ(bbo->getAskSize(), expected_bbo->getAskSize());
+    }
+  }
+}
+
+// Merging two captures yields all their messages, ordered by timestamp, each feed in its order.
+TEST_F(DecoderTest, MessageMergerTest) {
+  const std::vector<std::string> files = {tops_pcap_filepath, deep_pcap_filepath};
+  std::vector<std::vector<uint64_t>> expected(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    IEXDecoder file_decoder;
+    ASSERT_TRUE(file_decoder.OpenFileForDecoding(files[i]));
+    IEXMessage msg;
+    while (file_decoder.GetNextMessage(msg) == ReturnCode::Success) {
+      expected[i].push_back(GetMessageBase(msg).timestamp);
+    }
+  }
+
+  IEXDecoder tops_decoder;
+  IEXDecoder deep_decoder;
+  ASSERT_TRUE(tops_decoder.OpenFileForDecoding(files[0]));
+  ASSERT_TRUE(deep_decoder.OpenFileForDecoding(files[1]));
+  // A small batch, so both inputs are refilled many times.
+  MessageMerger merger(3);
+  EXPECT_EQ(merger.AddDecoder(tops_decoder), 0u);
+  EXPECT_EQ(merger.AddDecoder(deep_decoder), 1u);
+
+  std::vector<size_t> positions(files.size(), 0);
+  uint64_t last_timestamp = 0;
+  const IEXMessage* msg = nullptr;
+  size_t source = 0;
+  while (merger.GetNextMessage(msg, source) == ReturnCode::Success) {
+    ASSERT_LT(source, files.size());
+    ASSERT_LT(positions[source], expected[source].size());
+    const uint64_t timestamp = GetMessageBase(*msg).timestamp;
+    EXPECT_EQ(timestamp, expected[source][positions[source]++]);
+    EXPECT_GE(timestamp, last_timestamp);
+    last_timestamp = timestamp;
+  }
+  EXPECT_EQ(positions[0], expected[0].size());
+  EXPECT_EQ(positions[1], expected[1].size());
+}
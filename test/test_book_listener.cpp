@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+#include "book_listener.h"
+#include "l3book.h"
+#include "orderbook.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Records every callback as a short line.
+class RecordingListener : public BookListener {
+ public:
+  void OnBboChange(const Symbol& symbol, const BBO* bbo) override {
+    events.push_back("bbo " + symbol.ToString() + " " +
+                     (bbo ? std::to_string(bbo->getBidTicks().GetTicks()) + "x" +
+                                std::to_string(bbo->getAskTicks().GetTicks())
+                          : "none"));
+  }
+  void OnLevelChange(const Symbol&, Side side, Price price, int size) override {
+    events.push_back(std::string("level ") + (side == Side::Buy ? "B " : "S ") +
+                     std::to_string(price.GetTicks()) + " " + std::to_string(size));
+  }
+  void OnOrderAdded(const Symbol&, const Order& order) override {
+    events.push_back("add " + std::to_string(order.order_id));
+  }
+  void OnOrderExecuted(const Symbol&, const Order& order, uint32_t executed_size,
+                       Price) override {
+    events.push_back("exec " + std::to_string(order.order_id) + " " +
+                     std::to_string(executed_size) + " " + std::to_string(order.size));
+  }
+  void OnOrderDeleted(const Symbol&, const Order& order) override {
+    events.push_back("delete " + std::to_string(order.order_id));
+  }
+
+  std::vector<std::string> events;
+};
+
+}  // namespace
+
+TEST(BookListenerTest, OrderBookEvents) {
+  RecordingListener listener;
+  OrderBook book;
+  book.SetListener(&listener);
+  book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.00, 100, 1));
+  book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 100, 1));
+  // Staged updates are reported when the event completes, the BBO once per event.
+  book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 0, 0));
+  EXPECT_EQ(listener.events.size(), 3u);
+  book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.20, 50, 1));
+
+  const std::vector<std::string> expected = {
+      "level B 250000 100", "level S 251000 100", "bbo ZIEXT 250000x251000",
+      "level S 251000 0",   "level S 252000 50",  "bbo ZIEXT 250000x252000"};
+  EXPECT_EQ(listener.events, expected);
+
+  book.SetListener(nullptr);
+  book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.00, 0, 1));
+  EXPECT_EQ(listener.events.size(), expected.size());
+}
+
+TEST(BookListenerTest, L3OrderBookEvents) {
+  RecordingListener listener;
+  L3OrderBook book(2000, 20.0, 30.0, 0.01);
+  book.SetListener(&listener);
+
+  AddOrderMessage add;
+  add.symbol = "ZIEXT";
+  add.order_id = 7;
+  add.size = 300;
+  add.side = Side::Buy;
+  add.price = 25.00;
+  book.ProcessMessage(IEXMessage(add));
+
+  OrderExecutedMessage executed;
+  executed.symbol = "ZIEXT";
+  executed.order_id_ref = 7;
+  executed.size = 100;
+  executed.price = 25.00;
+  book.ProcessMessage(IEXMessage(executed));
+  executed.size = 200;
+  book.ProcessMessage(IEXMessage(executed));
+
+  const std::vector<std::string> expected = {"add 7", "exec 7 100 200", "exec 7 200 0",
+                                             "delete 7"};
+  EXPECT_EQ(listener.events, expected);
+}
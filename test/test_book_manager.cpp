@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "book_manager.h"
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+SecurityDirectoryMessage MakeDirectory(const char* symbol, double close) {
+  SecurityDirectoryMessage directory;
+  directory.symbol = symbol;
+  directory.adjusted_POC_price = close;
+  return directory;
+}
+
+std::string Snapshot(const L3OrderBook& book) {
+  std::ostringstream out;
+  book.SaveSnapshot(out);
+  return out.str();
+}
+
+}  // namespace
+
+TEST(BookManagerTest, RoutesBySymbolId) {
+  BookManager manager;
+  manager.EnableL3Books(BookManager::PriceBandL3Books(0.1));
+  manager.ProcessMessage(MakeDirectory("AAPL", 150.0));
+  manager.ProcessMessage(MakeDirectory("TSLA", 250.0));
+  manager.ProcessMessage(MakeDirectory("NEWCO", 0.0));  // No close, no L3 book
+  ASSERT_EQ(manager.Size(), 3u);
+  const uint32_t tsla = manager.GetSymbolTable().Find("TSLA");
+  ASSERT_NE(tsla, SymbolTable::invalid_id);
+  ASSERT_NE(manager.GetL3OrderBook(tsla), nullptr);
+  EXPECT_EQ(manager.GetL3OrderBook(manager.GetSymbolTable().Find("NEWCO")), nullptr);
+
+  EXPECT_EQ(manager.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "TSLA", 249.90, 100, 1)), tsla);
+  EXPECT_EQ(manager.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "TSLA", 250.10, 200, 1)), tsla);
+  ASSERT_TRUE(manager.GetOrderBook(tsla).GetBbo().has_value());
+  EXPECT_EQ(manager.GetOrderBook(tsla).GetBbo()->getAskSize(), 200);
+  EXPECT_TRUE(manager.GetOrderBook(tsla).TopOfBookChanged());
+
+  AddOrderMessage add;
+  add.symbol = "TSLA";
+  add.order_id = 1;
+  add.size = 100;
+  add.side = Side::Buy;
+  add.price = 249.90;
+  EXPECT_EQ(manager.ProcessMessage(add), tsla);
+  // Outside the price band, the book throws and the error is counted.
+  add.order_id = 2;
+  add.price = 400.0;
+  EXPECT_EQ(manager.ProcessMessage(add), tsla);
+
+  // A symbol missing from the directory still gets an OrderBook.
+  const uint32_t late = manager.ProcessMessage(
+      PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "LATE", 10.0, 100, 1));
+  EXPECT_EQ(late, 3u);
+  EXPECT_EQ(manager.GetL3OrderBook(late), nullptr);
+  // Messages without a book to update are ignored.
+  EXPECT_EQ(manager.ProcessMessage(SystemEventMessage()), SymbolTable::invalid_id);
+
+  const BookUsage usage = manager.GetUsage(tsla);
+  EXPECT_EQ(usage.symbol, Symbol("TSLA"));
+  EXPECT_EQ(usage.updates, 2u);
+  EXPECT_EQ(usage.l3_updates, 2u);
+  EXPECT_EQ(usage.errors, 1u);
+  EXPECT_GT(usage.memory_bytes, manager.GetUsage(late).memory_bytes);
+  EXPECT_EQ(manager.GetUsage().size(), 4u);
+}
+
+// A message priced outside the L3 book is rejected before any order or level changes.
+TEST(BookManagerTest, OutOfBandOrderLeavesL3BookUnchanged) {
+  BookManager manager;
+  manager.EnableL3Books(BookManager::PriceBandL3Books(0.1));
+  const uint32_t tsla = manager.AddSecurity(MakeDirectory("TSLA", 250.0));
+  const L3OrderBook* book = manager.GetL3OrderBook(tsla);
+  ASSERT_NE(book, nullptr);
+
+  AddOrderMessage add;
+  add.symbol = "TSLA";
+  add.order_id = 1;
+  add.size = 100;
+  add.side = Side::Buy;
+  add.price = 249.90;
+  manager.ProcessMessage(add);
+  const std::string before = Snapshot(*book);
+
+  add.order_id = 2;
+  add.price = 400.0;
+  manager.ProcessMessage(add);
+  EXPECT_EQ(Snapshot(*book), before);
+
+  OrderModifyMessage modify;
+  modify.symbol = "TSLA";
+  modify.order_id_ref = 1;
+  modify.size = 50;
+  modify.price = 100.0;
+  manager.ProcessMessage(modify);
+  EXPECT_EQ(Snapshot(*book), before);
+  EXPECT_EQ(manager.GetUsage(tsla).errors, 2u);
+
+  // The order is still where it was, so it can be deleted without another error.
+  OrderDeleteMessage remove;
+  remove.symbol = "TSLA";
+  remove.order_id_ref = 1;
+  manager.ProcessMessage(remove);
+  EXPECT_EQ(manager.GetUsage(tsla).errors, 2u);
+  BookManager empty;
+  empty.EnableL3Books(BookManager::PriceBandL3Books(0.1));
+  const uint32_t empty_id = empty.AddSecurity(MakeDirectory("TSLA", 250.0));
+  EXPECT_EQ(Snapshot(*book), Snapshot(*empty.GetL3OrderBook(empty_id)));
+}
+
+// The dense level grid is capped, so a very high priced security does not get a huge book.
+TEST(BookManagerTest, PriceBandL3BooksCapsLevelCount) {
+  const auto factory = BookManager::PriceBandL3Books(0.2, 20000);
+  EXPECT_TRUE(factory(MakeDirectory("TSLA", 250.0)).has_value());       // 10,001 levels
+  EXPECT_FALSE(factory(MakeDirectory("BRK.A", 400000.0)).has_value());  // 16,000,001 levels
+  EXPECT_FALSE(BookManager::PriceBandL3Books()(MakeDirectory("BRK.A", 400000.0)).has_value());
+}
@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "checkpoint.h"
+#include "pcap_builder.h"
+#include "test_util.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t base_time = 1517058000000000000;
+
+using CheckpointTest = TempDirectoryTest;
+
+// Six segments of three messages, each building both kinds of book. Empty if writing failed.
+std::string WriteCapture(const std::string& directory) {
+  std::vector<std::string> payloads;
+  int64_t sq_num = 1;
+  for (int segment = 0; segment < 6; ++segment) {
+    std::vector<std::string> messages;
+    for (int i = 0; i < 3; ++i) {
+      const int n = segment * 3 + i;
+      const int64_t timestamp = base_time + n * 1000;
+      if (i == 2) {
+        messages.push_back(BuildAddOrder(timestamp, "TSLA", n, 100 + n, 2000000 + n * 100));
+      } else {
+        const int64_t price_ticks = i == 0 ? 2000000 - n * 100 : 2100000 + n * 100;
+        messages.push_back(BuildPriceLevelUpdate(i == 0 ? 0x38 : 0x35, timestamp, "TSLA",
+                                                 100 * (n + 1), price_ticks));
+      }
+    }
+    payloads.push_back(BuildSegment(sq_num, base_time + segment * 3000, messages));
+    sq_num += messages.size();
+  }
+  const std::string filename = directory + "/checkpoint_test.pcap";
+  return WritePcapFile(filename, payloads) ? filename : std::string();
+}
+
+struct Books {
+  std::unordered_map<Symbol, OrderBook> books;
+  std::unordered_map<Symbol, L3OrderBook> l3_books;
+
+  void Process(const IEXMessage& msg) {
+    const Symbol symbol = GetMessageBase(msg).GetSymbol();
+    if (std::holds_alternative<AddOrderMessage>(msg)) {
+      auto it = l3_books.find(symbol);
+      if (it == l3_books.end()) {
+        it = l3_books.emplace(symbol, L3OrderBook(2000, 190.0, 210.0, 0.01)).first;
+      }
+      it->second.ProcessMessage(msg);
+    } else {
+      books[symbol].ProcessMessage(msg);
+    }
+  }
+
+  std::string Serialize() const {
+    std::string data;
+    SaveBooks(books, l3_books, data);
+    return data;
+  }
+};
+
+}  // namespace
+
+// A run interrupted mid-segment and resumed from its checkpoint ends with the same books.
+TEST_F(CheckpointTest, ResumeMatchesUninterruptedRun) {
+  ASSERT_FALSE(directory.empty());
+  const std::string filename = WriteCapture(directory);
+  ASSERT_FALSE(filename.empty());
+  const std::string checkpoint_path = directory + "/checkpoint_test.ckpt";
+
+  Books expected;
+  {
+    IEXDecoder decoder;
+    ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+    IEXMessage msg;
+    while (decoder.GetNextMessage(msg) == ReturnCode::Success) {
+      expected.Process(msg);
+    }
+  }
+
+  // Stop inside the third segment, and at a segment boundary, and resume from both.
+  for (int stop_after : {7, 9}) {
+    {
+      Books partial;
+      IEXDecoder decoder;
+      ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+      IEXMessage msg;
+      CheckpointWriter writer(checkpoint_path);
+      for (int i = 0; i < stop_after; ++i) {
+        ASSERT_EQ(decoder.GetNextMessage(msg), ReturnCode::Success);
+        partial.Process(msg);
+        Checkpoint checkpoint;
+        ASSERT_EQ(decoder.GetPosition(checkpoint.position), ReturnCode::Success);
+        SaveBooks(partial.books, partial.l3_books, checkpoint.books);
+        writer.Submit(std::move(checkpoint));
+      }
+      ASSERT_TRUE(writer.Flush());
+      EXPECT_GE(writer.GetWrittenCount(), 1u);
+      EXPECT_EQ(writer.GetWrittenCount() + writer.GetReplacedCount(),
+                static_cast<uint64_t>(stop_after));
+    }
+
+    Checkpoint checkpoint;
+    ASSERT_TRUE(LoadCheckpoint(checkpoint_path, checkpoint));
+    EXPECT_EQ(checkpoint.position.next_sq_num, stop_after + 1);
+    Books resumed;
+    ASSERT_TRUE(LoadBooks(checkpoint.books, resumed.books, resumed.l3_books));
+    IEXDecoder decoder;
+    ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+    ASSERT_EQ(decoder.RestorePosition(checkpoint.position), ReturnCode::Success);
+    IEXMessage msg;
+    ASSERT_EQ(decoder.GetNextMessage(msg), ReturnCode::Success);
+    EXPECT_EQ(GetMessageBase(msg).timestamp, static_cast<uint64_t>(base_time + stop_after * 1000));
+    resumed.Process(msg);
+    while (decoder.GetNextMessage(msg) == ReturnCode::Success) {
+      resumed.Process(msg);
+    }
+    EXPECT_EQ(resumed.Serialize(), expected.Serialize());
+  }
+}
+
+TEST_F(CheckpointTest, RejectsCorruptFile) {
+  ASSERT_FALSE(directory.empty());
+  const std::string checkpoint_path = directory + "/checkpoint_corrupt_test.ckpt";
+  Checkpoint checkpoint;
+  checkpoint.position.file_offset = 24;
+  checkpoint.books = std::string(1000, 'b');
+  ASSERT_TRUE(SaveCheckpoint(checkpoint_path, checkpoint));
+
+  Checkpoint loaded;
+  ASSERT_TRUE(LoadCheckpoint(checkpoint_path, loaded));
+  EXPECT_EQ(loaded.books, checkpoint.books);
+  EXPECT_EQ(loaded.position.file_offset, 24u);
+
+  // Flip a byte of the compressed book data.
+  std::fstream file(checkpoint_path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(-4, std::ios::end);
+  file.put('\x5a');
+  file.close();
+  EXPECT_FALSE(LoadCheckpoint(checkpoint_path, loaded));
+}
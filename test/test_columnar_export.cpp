@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "columnar_export.h"
+#include "test_util.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using ColumnarExportTest = TempDirectoryTest;
+
+TEST_F(ColumnarExportTest, WriteAndReadBack) {
+  ASSERT_FALSE(directory.empty());
+  ColumnarWriter writer(4);
+  ASSERT_TRUE(writer.Open(directory));
+
+  // Ten quotes over two symbols, so there are three row groups of at most four rows.
+  for (int i = 0; i < 10; ++i) {
+    QuoteUpdateMessage quote;
+    quote.timestamp = 1000 + i * 10;
+    quote.flags = 0;
+    quote.symbol = i % 2 == 0 ? Symbol("AAPL") : Symbol("TSLA");
+    quote.bid_size = 100 + i;
+    quote.bid_price = Price::FromTicks(1000000 + i);
+    quote.ask_size = 200 + i;
+    quote.ask_price = Price::FromTicks(1000100 + i);
+    ASSERT_TRUE(writer.Write(IEXMessage(quote)));
+  }
+  ASSERT_TRUE(writer.Write(IEXMessage(SystemEventMessage())));
+  EXPECT_EQ(writer.GetRowCount(), 10u);
+  ASSERT_TRUE(writer.Close());
+
+  ColumnarTable table;
+  ASSERT_TRUE(table.Open(directory, "quote_update"));
+  EXPECT_EQ(table.GetRowCount(), 10u);
+  ASSERT_EQ(table.GetRowGroups().size(), 3u);
+  EXPECT_EQ(table.GetRowGroups()[2].first_row, 8u);
+  EXPECT_EQ(table.GetRowGroups()[2].row_count, 2u);
+
+  const size_t timestamp = table.FindColumn("timestamp");
+  const size_t bid_price = table.FindColumn("bid_price");
+  const size_t symbol_id = table.FindColumn("symbol_id");
+  ASSERT_NE(timestamp, ColumnarTable::no_column);
+  EXPECT_EQ(table.FindColumn("unknown"), ColumnarTable::no_column);
+  EXPECT_EQ(table.GetRowGroups()[1].min[timestamp], 1040);
+  EXPECT_EQ(table.GetRowGroups()[1].max[timestamp], 1070);
+
+  // Only the groups overlapping the time range are returned.
+  const auto groups = table.FindRowGroups(timestamp, 1045, 1085);
+  ASSERT_EQ(groups.size(), 2u);
+  EXPECT_EQ(groups[0], 1u);
+  EXPECT_EQ(groups[1], 2u);
+
+  const int64_t* prices = table.GetColumnData<int64_t>(bid_price);
+  const uint32_t* symbol_ids = table.GetColumnData<uint32_t>(symbol_id);
+  ASSERT_NE(prices, nullptr);
+  ASSERT_NE(symbol_ids, nullptr);
+  EXPECT_EQ(table.GetColumnData<uint8_t>(bid_price), nullptr);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(prices[i], 1000000 + i);
+    EXPECT_EQ(symbol_ids[i], static_cast<uint32_t>(i % 2));
+  }
+
+  ColumnarTable empty_table;
+  ASSERT_TRUE(empty_table.Open(directory, "add_order"));
+  EXPECT_EQ(empty_table.GetRowCount(), 0u);
+  EXPECT_TRUE(empty_table.GetRowGroups().empty());
+}
+
+// Counts in a corrupt .meta file are rejected before anything is allocated for them.
+TEST_F(ColumnarExportTest, RejectCorruptMetadata) {
+  ASSERT_FALSE(directory.empty());
+  ColumnarWriter writer(4);
+  ASSERT_TRUE(writer.Open(directory));
+  QuoteUpdateMessage quote;
+  quote.timestamp = 1000;
+  quote.flags = 0;
+  quote.symbol = "AAPL";
+  quote.bid_size = 100;
+  quote.bid_price = Price::FromTicks(1000000);
+  quote.ask_size = 200;
+  quote.ask_price = Price::FromTicks(1000100);
+  ASSERT_TRUE(writer.Write(IEXMessage(quote)));
+  ASSERT_TRUE(writer.Close());
+
+  const std::string meta_path = directory + "/quote_update.meta";
+  std::string meta;
+  {
+    std::ifstream in(meta_path, std::ios::binary);
+    meta.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  ASSERT_GT(meta.size(), 24u);
+  auto write_meta = [&meta_path](const std::string& data) {
+    std::ofstream out(meta_path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+  };
+
+  // The column count follows the 8 byte magic.
+  std::string corrupt = meta;
+  const uint32_t column_count = 0xffffffff;
+  corrupt.replace(8, sizeof(column_count), reinterpret_cast<const char*>(&column_count),
+                  sizeof(column_count));
+  write_meta(corrupt);
+  ColumnarTable table;
+  EXPECT_FALSE(table.Open(directory, "quote_update"));
+
+  // The row group count is the last field before the groups.
+  corrupt = meta;
+  const uint64_t group_count = uint64_t(1) << 60;
+  const size_t group_len = 16 + 16 * 7;
+  corrupt.replace(meta.size() - group_len - sizeof(group_count), sizeof(group_count),
+                  reinterpret_cast<const char*>(&group_count), sizeof(group_count));
+  write_meta(corrupt);
+  EXPECT_FALSE(table.Open(directory, "quote_update"));
+
+  write_meta(meta.substr(0, meta.size() - 1));
+  EXPECT_FALSE(table.Open(directory, "quote_update"));
+
+  write_meta(meta);
+  EXPECT_TRUE(table.Open(directory, "quote_update"));
+}
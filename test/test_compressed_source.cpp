@@ -0,0 +1,104 @@
+#include "gtest/gtest.h"
+#include "compressed_pcap_source.h"
+#include "pcap_builder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+// Write data gzip compressed to a file.
+bool WriteGzip(const std::string& filename, const std::vector<uint8_t>& data) {
+  gzFile file = gzopen(filename.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  const int written = gzwrite(file, data.data(), data.size());
+  gzclose(file);
+  return written == static_cast<int>(data.size());
+}
+
+}  // namespace
+
+TEST(CompressedPcapSourceTest, ReadGzipAcrossChunks) {
+  std::vector<std::string> payloads;
+  for (int i = 0; i < 500; ++i) {
+    payloads.push_back("segment " + std::to_string(i) + std::string(i % 300, 'x'));
+  }
+  const std::vector<uint8_t> pcap = BuildPcap(payloads);
+
+  const std::string filename = ::testing::TempDir() + "compressed_source_test.pcap.gz";
+  ASSERT_TRUE(WriteGzip(filename, pcap));
+
+  EXPECT_TRUE(CompressedPcapSource::IsCompressed(filename));
+
+  // Use buffers smaller than the larger records, so some records straddle buffers.
+  CompressedPcapSource source(256, 3);
+  ASSERT_TRUE(source.Open(filename));
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  for (const auto& payload : payloads) {
+    ASSERT_EQ(source.GetNextPayload(data, len), ReturnCode::Success);
+    ASSERT_EQ(std::string(reinterpret_cast<const char*>(data), len), payload);
+  }
+  EXPECT_EQ(source.GetNextPayload(data, len), ReturnCode::EndOfStream);
+
+  // Closing while the decompression thread is blocked on a full ring must not hang.
+  ASSERT_TRUE(source.Open(filename));
+  source.Close();
+  std::remove(filename.c_str());
+}
+
+// A corrupt record length must not make the source allocate or read the rest of the stream.
+TEST(CompressedPcapSourceTest, RejectCaplenAboveSnaplen) {
+  std::vector<uint8_t> pcap = BuildPcap({"first", "second"});
+  const uint32_t caplen = 0x7fffffff;
+  std::memcpy(pcap.data() + pcap_file_header_len + 8, &caplen, sizeof(caplen));
+
+  const std::string filename = ::testing::TempDir() + "compressed_source_caplen_test.pcap.gz";
+  ASSERT_TRUE(WriteGzip(filename, pcap));
+
+  CompressedPcapSource source;
+  ASSERT_TRUE(source.Open(filename));
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  EXPECT_EQ(source.GetNextPayload(data, len), ReturnCode::FailedParsingPacket);
+  source.Close();
+  std::remove(filename.c_str());
+}
+
+// A capture cut off inside the compressed stream is an error, not the end of the capture.
+TEST(CompressedPcapSourceTest, TruncatedStreamIsAnError) {
+  std::vector<std::string> payloads;
+  for (int i = 0; i < 200; ++i) {
+    payloads.push_back("segment " + std::to_string(i));
+  }
+  const std::string filename = ::testing::TempDir() + "compressed_source_truncated_test.pcap.gz";
+  ASSERT_TRUE(WriteGzip(filename, BuildPcap(payloads)));
+
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  std::vector<uint8_t> compressed(1 << 16);
+  compressed.resize(std::fread(compressed.data(), 1, compressed.size(), file));
+  std::fclose(file);
+  compressed.resize(compressed.size() / 2);
+  file = std::fopen(filename.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  std::fwrite(compressed.data(), 1, compressed.size(), file);
+  std::fclose(file);
+
+  CompressedPcapSource source(256, 3);
+  ASSERT_TRUE(source.Open(filename));
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+  ReturnCode ret_code = ReturnCode::Success;
+  while (ret_code == ReturnCode::Success) {
+    ret_code = source.GetNextPayload(data, len);
+  }
+  EXPECT_EQ(ret_code, ReturnCode::FailedParsingPacket);
+  source.Close();
+  std::remove(filename.c_str());
+}
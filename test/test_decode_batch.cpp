@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "iex_decoder.h"
+#include "pcap_builder.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t base_time = 1517058000000000000;
+
+}  // namespace
+
+TEST(DecodeBatchTest, RejectsZeroCapacity) {
+  const std::string filename = ::testing::TempDir() + "decode_batch_capacity_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(
+      filename, base_time,
+      {BuildSegment(1, base_time, {BuildSystemEvent('O', base_time)})}));
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  IEXMessage msgs[4];
+  size_t count = 1;
+  EXPECT_EQ(decoder.DecodeBatch(msgs, 0, count), ReturnCode::InvalidArgument);
+  EXPECT_EQ(count, 0u);
+  ASSERT_EQ(decoder.DecodeBatch(msgs, 4, count), ReturnCode::Success);
+  EXPECT_EQ(count, 1u);
+  EXPECT_EQ(decoder.DecodeBatch(msgs, 4, count), ReturnCode::EndOfStream);
+  std::remove(filename.c_str());
+}
+
+// A block whose length runs past the end of the segment is not read, the next segment still is.
+TEST(DecodeBatchTest, TruncatedBlock) {
+  std::string truncated = BuildSegment(
+      1, base_time, {BuildSystemEvent('O', base_time), BuildSystemEvent('S', base_time + 1)});
+  truncated.resize(truncated.size() - 4);
+  const std::string filename = ::testing::TempDir() + "decode_batch_truncated_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(
+      filename, base_time,
+      {truncated, BuildSegment(3, base_time + 2, {BuildSystemEvent('R', base_time + 2)})}));
+
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  IEXMessage msgs[4];
+  size_t count = 0;
+  EXPECT_EQ(decoder.DecodeBatch(msgs, 4, count), ReturnCode::FailedParsingPacket);
+  ASSERT_EQ(count, 1u);
+  EXPECT_EQ(std::get<SystemEventMessage>(msgs[0]).timestamp, static_cast<uint64_t>(base_time));
+  ASSERT_EQ(decoder.DecodeBatch(msgs, 4, count), ReturnCode::Success);
+  ASSERT_EQ(count, 1u);
+  EXPECT_EQ(std::get<SystemEventMessage>(msgs[0]).timestamp,
+            static_cast<uint64_t>(base_time + 2));
+
+  // GetNextMessage checks the blocks the same way.
+  IEXDecoder message_decoder;
+  ASSERT_TRUE(message_decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  IEXMessage msg;
+  EXPECT_EQ(message_decoder.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(message_decoder.GetNextMessage(msg), ReturnCode::FailedParsingPacket);
+  ASSERT_EQ(message_decoder.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(std::get<SystemEventMessage>(msg).timestamp, static_cast<uint64_t>(base_time + 2));
+  std::remove(filename.c_str());
+}
+
+// Looking for the start of regular hours checks the blocks the same way.
+TEST(DecodeBatchTest, TruncatedBlockBeforeRegularHours) {
+  std::string truncated = BuildSegment(
+      1, base_time, {BuildSystemEvent('S', base_time), BuildSystemEvent('R', base_time + 1)});
+  truncated.resize(truncated.size() - 4);
+  const std::string filename = ::testing::TempDir() + "decode_batch_regular_hours_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(
+      filename, base_time,
+      {truncated, BuildSegment(3, base_time + 2,
+                               {BuildSystemEvent('S', base_time + 2),
+                                BuildSystemEvent('R', base_time + 3)})}));
+
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  decoder.SetRegularHoursOnly(true);
+  IEXMessage msg;
+  ASSERT_EQ(decoder.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(std::get<SystemEventMessage>(msg).timestamp, static_cast<uint64_t>(base_time + 3));
+  EXPECT_EQ(decoder.GetNextMessage(msg), ReturnCode::EndOfStream);
+  std::remove(filename.c_str());
+}
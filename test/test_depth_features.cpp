@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "depth_features.h"
+#include "orderbook.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Reference depth of one side, walked from a plain map.
+template <typename Compare>
+void ExpectDepth(const std::map<int64_t, int, Compare>& levels, const int64_t* prices,
+                 const int* sizes, size_t count, size_t n) {
+  ASSERT_EQ(count, std::min(n, levels.size()));
+  size_t i = 0;
+  for (auto it = levels.begin(); i < count; ++it, ++i) {
+    ASSERT_EQ(prices[i], it->first);
+    ASSERT_EQ(sizes[i], it->second);
+  }
+}
+
+template <typename Book>
+void CheckDepthMatchesLevels(uint32_t seed) {
+  std::mt19937 rng(seed);
+  Book book;
+  std::map<int64_t, int, std::greater<int64_t>> bids;
+  std::map<int64_t, int> asks;
+
+  std::vector<int64_t> bid_prices(Book::max_depth);
+  std::vector<int> bid_sizes(Book::max_depth);
+  std::vector<int64_t> ask_prices(Book::max_depth);
+  std::vector<int> ask_sizes(Book::max_depth);
+  DepthArrays depth{bid_prices.data(), bid_sizes.data(), ask_prices.data(), ask_sizes.data()};
+
+  // Few price points, so top levels are removed often and the levels behind have to move up.
+  for (int i = 0; i < 20000; ++i) {
+    const bool buy = rng() % 2 == 0;
+    const int64_t ticks = buy ? 1990000 - (rng() % 30) * 100 : 2010000 + (rng() % 30) * 100;
+    const int size = rng() % 3 == 0 ? 0 : static_cast<int>(rng() % 500) + 1;
+    if (buy) {
+      book.UpdateOrderBook(MessageType::PriceLevelUpdateBuy, "ZIEXT", Price::FromTicks(ticks), size);
+      if (size == 0) {
+        bids.erase(ticks);
+      } else {
+        bids[ticks] = size;
+      }
+    } else {
+      book.UpdateOrderBook(MessageType::PriceLevelUpdateSell, "ZIEXT", Price::FromTicks(ticks), size);
+      if (size == 0) {
+        asks.erase(ticks);
+      } else {
+        asks[ticks] = size;
+      }
+    }
+    const size_t n = rng() % (Book::max_depth + 1);
+    book.GetDepth(n, depth);
+    ExpectDepth(bids, bid_prices.data(), bid_sizes.data(), depth.bid_count, n);
+    ExpectDepth(asks, ask_prices.data(), ask_sizes.data(), depth.ask_count, n);
+  }
+
+  // The top levels are rebuilt from a snapshot.
+  std::stringstream snapshot;
+  book.SaveSnapshot(snapshot);
+  Book restored;
+  ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+  restored.GetDepth(Book::max_depth, depth);
+  ExpectDepth(bids, bid_prices.data(), bid_sizes.data(), depth.bid_count, Book::max_depth);
+  ExpectDepth(asks, ask_prices.data(), ask_sizes.data(), depth.ask_count, Book::max_depth);
+}
+
+}  // namespace
+
+TEST(DepthFeaturesTest, DepthMatchesLevels) {
+  CheckDepthMatchesLevels<OrderBook>(3);
+  CheckDepthMatchesLevels<LadderOrderBook>(5);
+}
+
+TEST(DepthFeaturesTest, ThinBookAndRequestsBeyondMaxDepth) {
+  OrderBook book;
+  int64_t bid_prices[OrderBook::max_depth];
+  int bid_sizes[OrderBook::max_depth];
+  int64_t ask_prices[OrderBook::max_depth];
+  int ask_sizes[OrderBook::max_depth];
+  DepthArrays depth{bid_prices, bid_sizes, ask_prices, ask_sizes};
+
+  book.GetDepth(OrderBook::max_depth, depth);
+  EXPECT_EQ(depth.bid_count, 0u);
+  EXPECT_EQ(depth.ask_count, 0u);
+  // Nothing is copied, so arrays the caller left null are never touched.
+  DepthArrays no_arrays;
+  book.GetDepth(OrderBook::max_depth, no_arrays);
+  EXPECT_EQ(no_arrays.bid_count, 0u);
+
+  for (int i = 0; i < 20; ++i) {
+    book.UpdateOrderBook(MessageType::PriceLevelUpdateBuy, "ZIEXT", Price::FromTicks(250000 - i * 100),
+                         100 + i);
+  }
+  book.UpdateOrderBook(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 300);
+  book.GetDepth(1000, depth);
+  EXPECT_EQ(depth.bid_count, OrderBook::max_depth);
+  EXPECT_EQ(depth.ask_count, 1u);
+  EXPECT_EQ(bid_prices[0], 250000);
+  EXPECT_EQ(bid_sizes[OrderBook::max_depth - 1], 100 + static_cast<int>(OrderBook::max_depth) - 1);
+  EXPECT_EQ(ask_prices[0], 251000);
+  EXPECT_EQ(ask_sizes[0], 300);
+  book.GetDepth(0, no_arrays);
+  EXPECT_EQ(no_arrays.bid_count, 0u);
+  EXPECT_EQ(no_arrays.ask_count, 0u);
+}
+
+TEST(DepthFeaturesTest, ImbalanceAndWeightedDepth) {
+  const int bid_sizes[] = {100, 200, 300};
+  const int ask_sizes[] = {100, 100};
+  const double weights[] = {1.0, 0.5, 0.25};
+
+  EXPECT_EQ(SumSizes(bid_sizes, 3), 600);
+  EXPECT_EQ(SumSizes(bid_sizes, 0), 0);
+  EXPECT_DOUBLE_EQ(DepthImbalance(bid_sizes, 3, ask_sizes, 2), 400.0 / 800.0);
+  EXPECT_DOUBLE_EQ(DepthImbalance(bid_sizes, 0, ask_sizes, 2), -1.0);
+  EXPECT_EQ(DepthImbalance(bid_sizes, 0, ask_sizes, 0), 0.0);
+  EXPECT_DOUBLE_EQ(WeightedDepth(bid_sizes, weights, 3), 100.0 + 100.0 + 75.0);
+}
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "event_log.h"
+#include "pcap_builder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST(EventLogTest, RoundTrip) {
+  constexpr int64_t base_time = 1517058000000000000;
+  std::vector<std::string> messages;
+  messages.push_back(BuildSystemEvent('R', base_time));
+  for (int i = 0; i < 50; ++i) {
+    messages.push_back(BuildPriceLevelUpdate(i % 2 == 0 ? 0x38 : 0x35, base_time + i * 1000,
+                                             i % 3 == 0 ? "TSLA" : "AAPL", 100 * i,
+                                             3500000 + i));
+  }
+  // Messages that do not match a known layout are stored as they are.
+  messages.push_back(std::string("\x7a\x01\x02\x03\x04", 5));
+  messages.push_back(BuildPriceLevelUpdate(0x38, base_time, "ZIEXT", 1, 1).substr(0, 20));
+  // A timestamp going backwards.
+  messages.push_back(BuildSystemEvent('M', base_time - 5));
+
+  const std::string filename = ::testing::TempDir() + "event_log_test.log";
+  // Small blocks, so the messages spread over several of them.
+  EventLogWriter writer(64);
+  ASSERT_TRUE(writer.Open(filename));
+  for (const auto& message : messages) {
+    ASSERT_TRUE(writer.Write(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+  }
+  EXPECT_EQ(writer.GetMessageCount(), messages.size());
+  ASSERT_TRUE(writer.Close());
+
+  EventLogReader reader;
+  ASSERT_TRUE(reader.Open(filename));
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  for (const auto& message : messages) {
+    ASSERT_EQ(reader.GetNextRawMessage(msg_data_ptr, msg_len), ReturnCode::Success);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(msg_data_ptr), msg_len), message);
+  }
+  EXPECT_EQ(reader.GetNextRawMessage(msg_data_ptr, msg_len), ReturnCode::EndOfStream);
+
+  // The decoded structs are the ones IEXDecoder yields.
+  ASSERT_TRUE(reader.Open(filename));
+  IEXMessage msg;
+  ASSERT_EQ(reader.GetNextMessage(msg), ReturnCode::Success);
+  ASSERT_EQ(reader.GetNextMessage(msg), ReturnCode::Success);
+  const auto* update = std::get_if<PriceLevelUpdateMessage>(&msg);
+  ASSERT_NE(update, nullptr);
+  EXPECT_EQ(update->GetMessageType(), MessageType::PriceLevelUpdateBuy);
+  EXPECT_EQ(update->symbol, Symbol("TSLA"));
+  EXPECT_EQ(update->price.GetTicks(), 3500000);
+  EXPECT_EQ(update->timestamp, static_cast<uint64_t>(base_time));
+  std::remove(filename.c_str());
+}
+
+// Block lengths beyond the writer limit or the end of the file are rejected before allocating.
+TEST(EventLogTest, CorruptBlockHeader) {
+  const std::string filename = ::testing::TempDir() + "event_log_corrupt_test.log";
+  EventLogWriter writer;
+  ASSERT_TRUE(writer.Open(filename));
+  ASSERT_TRUE(writer.Close());
+
+  const auto write_header = [&filename](uint32_t compressed_len, uint32_t raw_len) {
+    std::ofstream out(filename, std::ios::binary | std::ios::app);
+    const uint32_t header[3] = {compressed_len, raw_len, 1};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write("\0\0\0\0", 4);
+  };
+  write_header(4, 0xFFFFFFFF);
+
+  EventLogReader reader;
+  const uint8_t* msg_data_ptr = nullptr;
+  size_t msg_len = 0;
+  ASSERT_TRUE(reader.Open(filename));
+  EXPECT_EQ(reader.GetNextRawMessage(msg_data_ptr, msg_len), ReturnCode::FailedParsingPacket);
+
+  ASSERT_TRUE(writer.Open(filename));
+  ASSERT_TRUE(writer.Close());
+  write_header(0x7FFFFFFF, 64);
+  ASSERT_TRUE(reader.Open(filename));
+  EXPECT_EQ(reader.GetNextRawMessage(msg_data_ptr, msg_len), ReturnCode::FailedParsingPacket);
+
+  // Messages longer than an IEX-TP block are refused by the writer.
+  ASSERT_TRUE(writer.Open(filename));
+  const std::vector<uint8_t> long_message(0x10000, 0x7a);
+  EXPECT_FALSE(writer.Write(long_message.data(), long_message.size()));
+  ASSERT_TRUE(writer.Close());
+  std::remove(filename.c_str());
+}
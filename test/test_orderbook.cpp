@@ -168,3 +168,141 @@ TEST_F(OrderBookTest, LargeNumberOfMessages) {
     EXPECT_EQ(bbo->getAskSize(), 50);
     EXPECT_LT(bbo->getBidPrice(), bbo->getAskPrice());
 }
+
+// Messages held in an IEXMessage variant must update the book exactly like the base class path
+TEST_F(OrderBookTest, ProcessVariantMessages) {
+    std::vector<IEXMessage> messages;
+    messages.emplace_back(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "AAPL", 150.0, 100, 1));
+    messages.emplace_back(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "AAPL", 155.0, 50, 0));
+    messages.emplace_back(SystemEventMessage());
+    messages.emplace_back(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "AAPL", 156.0, 70, 1));
+
+    for (const auto& message : messages) {
+        order_book.ProcessMessage(message);
+    }
+
+    auto bbo = order_book.GetBbo();
+    ASSERT_TRUE(bbo.has_value());
+    EXPECT_DOUBLE_EQ(bbo->getBidPrice(), 150.0);
+    EXPECT_EQ(bbo->getBidSize(), 100);
+    EXPECT_DOUBLE_EQ(bbo->getAskPrice(), 155.0);
+    EXPECT_EQ(bbo->getAskSize(), 50);
+}
+
+// Price levels are keyed on integer ticks, so a level added from a rounded double literal is the
+// same level the wire format refers to.
+TEST_F(OrderBookTest, FixedPointPriceLevels) {
+    EXPECT_EQ(Price(25.10).GetTicks(), 251000);
+    EXPECT_EQ(Price(0.1) + Price(0.2), Price(0.3));
+    EXPECT_EQ(Price::FromTicks(40600), 4.06);
+
+    order_book.UpdateOrderBook(MessageType::PriceLevelUpdateBuy, "ZIEXT", 0.1 + 0.2, 100);
+    order_book.UpdateOrderBook(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 100);
+    order_book.UpdateOrderBook(MessageType::PriceLevelUpdateSell, "ZIEXT", Price::FromTicks(251000), 300);
+    order_book.UpdateBBO();
+
+    auto bbo = order_book.GetBbo();
+    ASSERT_TRUE(bbo.has_value());
+    EXPECT_EQ(bbo->getBidTicks(), Price::FromTicks(3000));
+    EXPECT_EQ(bbo->getAskTicks(), Price::FromTicks(251000));
+    EXPECT_EQ(bbo->getAskSize(), 300);
+
+    order_book.UpdateOrderBook(MessageType::PriceLevelUpdateBuy, "ZIEXT", Price::FromTicks(3000), 0);
+    order_book.UpdateBBO();
+    EXPECT_FALSE(order_book.GetBbo().has_value());
+}
+
+// Price fields still read as the doubles they used to be.
+TEST_F(OrderBookTest, PriceFieldsReadAsDouble) {
+    PriceLevelUpdateMessage message(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.10, 100, 1);
+    const double price = message.price;
+    EXPECT_DOUBLE_EQ(price, 25.10);
+    EXPECT_TRUE(message.price > 25);
+    EXPECT_TRUE(message.price == 25.10);
+    EXPECT_DOUBLE_EQ(message.price - 0.10, 25.00);
+    EXPECT_DOUBLE_EQ(message.price / 2, 12.55);
+    EXPECT_EQ(message.price * 2, Price(50.20));
+}
+
+// The BBO is kept incrementally, and TopOfBookChanged reports only events that moved it
+TEST_F(OrderBookTest, IncrementalBboAndChangeFlag) {
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.00, 100, 1));
+    EXPECT_FALSE(order_book.TopOfBookChanged()); // One side only, still no BBO
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 100, 1));
+    EXPECT_TRUE(order_book.TopOfBookChanged());
+
+    // Levels behind the inside do not move the BBO
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 24.90, 200, 1));
+    EXPECT_FALSE(order_book.TopOfBookChanged());
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.20, 300, 1));
+    EXPECT_FALSE(order_book.TopOfBookChanged());
+
+    // An atomic event removing the best bid reports a change only when it completes
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.00, 0, 0));
+    EXPECT_FALSE(order_book.TopOfBookChanged());
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 0, 1));
+    EXPECT_TRUE(order_book.TopOfBookChanged());
+    auto bbo = order_book.GetBbo();
+    ASSERT_TRUE(bbo.has_value());
+    EXPECT_EQ(bbo->getBidTicks(), Price(24.90));
+    EXPECT_EQ(bbo->getBidSize(), 200);
+    EXPECT_EQ(bbo->getAskTicks(), Price(25.20));
+    EXPECT_EQ(bbo->getAskSize(), 300);
+
+    // A size change at the inside is a change too
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.20, 50, 1));
+    EXPECT_TRUE(order_book.TopOfBookChanged());
+    EXPECT_EQ(order_book.GetBbo()->getAskSize(), 50);
+
+    // A crossed book has no BBO instead of throwing
+    order_book.UpdateOrderBook(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.30, 100);
+    EXPECT_NO_THROW(order_book.UpdateBBO());
+    EXPECT_FALSE(order_book.GetBbo().has_value());
+    EXPECT_TRUE(order_book.TopOfBookChanged());
+}
+
+// An atomic event longer than the staging buffer, e.g. a sweep, still publishes one BBO at its end
+TEST_F(OrderBookTest, AtomicEventLongerThanStagingBuffer) {
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 24.00, 100, 1));
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 30.00, 100, 1));
+    const BBO before = *order_book.GetBbo();
+
+    // Bids stepping up one cent per update, three times the buffer
+    const int updates = 3 * OrderBook::max_atomic_updates;
+    for (int i = 1; i <= updates; ++i) {
+        order_book.ProcessMessage(PriceLevelUpdateMessage(
+            MessageType::PriceLevelUpdateBuy, "ZIEXT", Price::FromTicks(240000 + i * 100), 10 * i, 0));
+        EXPECT_FALSE(order_book.TopOfBookChanged());
+        EXPECT_EQ(*order_book.GetBbo(), before);
+    }
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 29.90, 500, 1));
+    EXPECT_TRUE(order_book.TopOfBookChanged());
+    auto bbo = order_book.GetBbo();
+    ASSERT_TRUE(bbo.has_value());
+    EXPECT_EQ(bbo->getBidTicks(), Price::FromTicks(240000 + updates * 100));
+    EXPECT_EQ(bbo->getBidSize(), 10 * updates);
+    EXPECT_EQ(bbo->getAskTicks(), Price(29.90));
+    EXPECT_EQ(bbo->getAskSize(), 500);
+}
+
+// Updates staged for an open atomic event survive a snapshot round trip
+TEST_F(OrderBookTest, SnapshotKeepsStagedUpdates) {
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.00, 100, 1));
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 100, 1));
+    order_book.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateBuy, "ZIEXT", 25.05, 300, 0));
+
+    std::stringstream snapshot;
+    order_book.SaveSnapshot(snapshot);
+    OrderBook restored;
+    ASSERT_TRUE(restored.LoadSnapshot(snapshot));
+    EXPECT_EQ(restored.GetBbo()->getBidTicks(), Price(25.00));
+
+    restored.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.10, 0, 0));
+    restored.ProcessMessage(PriceLevelUpdateMessage(MessageType::PriceLevelUpdateSell, "ZIEXT", 25.08, 200, 1));
+    EXPECT_TRUE(restored.TopOfBookChanged());
+    auto bbo = restored.GetBbo();
+    ASSERT_TRUE(bbo.has_value());
+    EXPECT_EQ(bbo->getBidTicks(), Price(25.05));
+    EXPECT_EQ(bbo->getBidSize(), 300);
+    EXPECT_EQ(bbo->getAskTicks(), Price(25.08));
+}
@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include "iex_decoder.h"
+#include "packet_index.h"
+#include "pcap_builder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t base_time = 1517058000000000000;
+
+}  // namespace
+
+// A sidecar whose entry count does not match its size is rejected before allocating, and seeking
+// falls back to rebuilding the index.
+TEST(PacketIndexTest, CorruptSidecarIsRebuilt) {
+  std::vector<std::string> payloads = {BuildSegment(1, base_time, {})};
+  for (int64_t sq_num = 1; sq_num <= 8; ++sq_num) {
+    payloads.push_back(
+        BuildSegment(sq_num, base_time + sq_num, {BuildSystemEvent('O', base_time + sq_num)}));
+  }
+  const std::string filename = ::testing::TempDir() + "packet_index_test.pcap";
+  ASSERT_TRUE(WritePcapFile(filename, payloads));
+  const size_t capture_size = BuildPcap(payloads).size();
+  const std::string index_path = PacketIndex::GetSidecarPath(filename);
+  std::remove(index_path.c_str());
+
+  {
+    IEXDecoder decoder;
+    ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+    ASSERT_EQ(decoder.SeekToSequence(5), ReturnCode::Success);
+  }
+  PacketIndex index;
+  ASSERT_TRUE(index.Load(index_path, capture_size));
+
+  // Overwrite the entry count that follows the magic and the capture size.
+  {
+    std::fstream sidecar(index_path, std::ios::binary | std::ios::in | std::ios::out);
+    const uint64_t count = uint64_t(1) << 40;
+    sidecar.seekp(16);
+    sidecar.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  EXPECT_FALSE(index.Load(index_path, capture_size));
+  EXPECT_TRUE(index.Empty());
+
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  ASSERT_EQ(decoder.SeekToSequence(5), ReturnCode::Success);
+  IEXMessage msg;
+  ASSERT_EQ(decoder.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(std::get<SystemEventMessage>(msg).timestamp, static_cast<uint64_t>(base_time + 5));
+  EXPECT_TRUE(index.Load(index_path, capture_size));
+
+  std::remove(index_path.c_str());
+  std::remove(filename.c_str());
+}
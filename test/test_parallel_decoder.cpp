@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "parallel_decoder.h"
+#include "pcap_builder.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t base_time = 1517058000000000000;
+
+// A segment carrying one SystemEvent, timestamped with its sequence number.
+std::string BuildNumberedSegment(int64_t sq_num) {
+  return BuildSegment(sq_num, base_time + sq_num, {BuildSystemEvent('O', base_time + sq_num)});
+}
+
+// Decode a capture and collect the sequence numbers of the delivered messages.
+ReturnCode DecodeSequence(ParallelDecoder& decoder, std::vector<int64_t>& sq_nums) {
+  return decoder.ForEachMessage([&sq_nums](const IEXMessage& msg) {
+    sq_nums.push_back(std::get<SystemEventMessage>(msg).timestamp - base_time);
+  });
+}
+
+}  // namespace
+
+// A block whose length runs past the end of the segment is not read.
+TEST(ParallelDecoderTest, TruncatedBlock) {
+  std::string truncated = BuildSegment(
+      1, base_time + 1,
+      {BuildSystemEvent('O', base_time + 1), BuildSystemEvent('S', base_time + 2)});
+  truncated.resize(truncated.size() - 4);
+  const std::string filename = ::testing::TempDir() + "parallel_decoder_truncated_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(filename, base_time, {truncated, BuildNumberedSegment(3)}));
+
+  ParallelDecoder decoder(2, 1);
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename));
+  std::vector<int64_t> sq_nums;
+  EXPECT_EQ(DecodeSequence(decoder, sq_nums), ReturnCode::FailedParsingPacket);
+  EXPECT_EQ(sq_nums, std::vector<int64_t>({1}));
+  std::remove(filename.c_str());
+}
+
+// A segment captured late, in the chunk after the gap it fills, is still delivered in order.
+TEST(ParallelDecoderTest, ReordersAcrossChunks) {
+  const std::string filename = ::testing::TempDir() + "parallel_decoder_reorder_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(
+      filename, base_time,
+      {BuildNumberedSegment(1), BuildNumberedSegment(3), BuildNumberedSegment(4),
+       BuildNumberedSegment(2), BuildNumberedSegment(5), BuildNumberedSegment(7)}));
+
+  ParallelDecoder decoder(2, 2);
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename));
+  std::vector<int64_t> sq_nums;
+  EXPECT_EQ(DecodeSequence(decoder, sq_nums), ReturnCode::EndOfStream);
+  // Nothing ever fills 6, so 7 follows after a gap.
+  EXPECT_EQ(sq_nums, std::vector<int64_t>({1, 2, 3, 4, 5, 7}));
+  std::remove(filename.c_str());
+}
+
+// Retransmissions are skipped, a segment only partly repeating delivered messages is an error.
+TEST(ParallelDecoderTest, RetransmissionsAndOverlaps) {
+  const std::string filename = ::testing::TempDir() + "parallel_decoder_overlap_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(
+      filename, base_time,
+      {BuildNumberedSegment(1), BuildNumberedSegment(2), BuildNumberedSegment(1),
+       BuildSegment(2, base_time + 2,
+                    {BuildSystemEvent('O', base_time + 2),
+                     BuildSystemEvent('O', base_time + 3)})}));
+
+  ParallelDecoder decoder(2, 2);
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename));
+  std::vector<int64_t> sq_nums;
+  EXPECT_EQ(DecodeSequence(decoder, sq_nums), ReturnCode::FailedParsingPacket);
+  EXPECT_EQ(sq_nums, std::vector<int64_t>({1, 2}));
+  std::remove(filename.c_str());
+}
+
+TEST(ParallelDecoderTest, HandlerStopsEarly) {
+  std::vector<std::string> segments;
+  for (int64_t sq_num = 1; sq_num <= 64; ++sq_num) {
+    segments.push_back(BuildNumberedSegment(sq_num));
+  }
+  const std::string filename = ::testing::TempDir() + "parallel_decoder_stop_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(filename, base_time, segments));
+
+  ParallelDecoder decoder(4, 4);
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename));
+  size_t count = 0;
+  EXPECT_EQ(decoder.ForEachMessage([&count](const IEXMessage&) { return ++count < 3; }),
+            ReturnCode::Success);
+  EXPECT_EQ(count, 3u);
+  std::remove(filename.c_str());
+}
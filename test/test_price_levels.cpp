@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "orderbook.h"
+#include "price_levels.h"
+
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+template <typename Levels>
+std::vector<std::pair<Price, int>> Ascending(const Levels& levels) {
+  std::vector<std::pair<Price, int>> result;
+  levels.ForEachAscending([&result](Price price, int size) {
+    result.emplace_back(price, size);
+    return true;
+  });
+  return result;
+}
+
+template <typename Levels>
+std::vector<std::pair<Price, int>> Descending(const Levels& levels) {
+  std::vector<std::pair<Price, int>> result;
+  levels.ForEachDescending([&result](Price price, int size) {
+    result.emplace_back(price, size);
+    return true;
+  });
+  return result;
+}
+
+}  // namespace
+
+TEST(PriceLevelsTest, LadderSparseFallback) {
+  // A small ladder of 128 one cent slots.
+  TickLadderPriceLevels ladder(100, 128);
+  ladder.Set(100.00, 10);
+  ladder.Set(100.005, 20);  // Sub-penny, off the grid
+  ladder.Set(150.00, 30);   // Outside the window
+  ladder.Set(99.50, 40);
+  EXPECT_EQ(ladder.Size(), 4u);
+  EXPECT_EQ(ladder.GetSparseCount(), 2u);
+  EXPECT_EQ(ladder.Get(100.005), 20);
+  EXPECT_EQ(ladder.Get(100.01), 0);
+  EXPECT_EQ(ladder.Lowest().first, Price(99.50));
+  EXPECT_EQ(ladder.Highest().first, Price(150.00));
+
+  const std::vector<std::pair<Price, int>> expected = {
+      {99.50, 40}, {100.00, 10}, {100.005, 20}, {150.00, 30}};
+  EXPECT_EQ(Ascending(ladder), expected);
+  const std::vector<std::pair<Price, int>> reversed(expected.rbegin(), expected.rend());
+  EXPECT_EQ(Descending(ladder), reversed);
+
+  // Moving the inside out of the window brings the far level into the ladder.
+  ladder.KeepNear(150.00);
+  EXPECT_EQ(ladder.Get(150.00), 30);
+  EXPECT_EQ(ladder.GetSparseCount(), 3u);
+  EXPECT_EQ(Ascending(ladder), expected);
+
+  ladder.Set(150.00, 0);
+  ladder.Set(99.50, 0);
+  EXPECT_EQ(ladder.Highest().first, Price(100.005));
+  EXPECT_EQ(ladder.Lowest().first, Price(100.00));
+  ladder.Clear();
+  EXPECT_TRUE(ladder.Empty());
+}
+
+// The ladder must hold exactly what a map holds under random updates that drift in price.
+TEST(PriceLevelsTest, LadderMatchesMap) {
+  std::mt19937 rng(42);
+  MapPriceLevels map;
+  TickLadderPriceLevels ladder(100, 256);
+  int64_t mid = 2000000;
+  for (int i = 0; i < 20000; ++i) {
+    mid += static_cast<int64_t>(rng() % 201) - 100;
+    int64_t ticks = mid + (static_cast<int64_t>(rng() % 4001) - 2000) * 100;
+    if (rng() % 10 == 0) {
+      ticks += rng() % 100;  // Off the grid
+    }
+    const int size = rng() % 3 == 0 ? 0 : static_cast<int>(rng() % 1000) + 1;
+    map.Set(Price::FromTicks(ticks), size);
+    ladder.Set(Price::FromTicks(ticks), size);
+    if (!map.Empty()) {
+      ladder.KeepNear(map.Highest().first);
+      ASSERT_EQ(ladder.Highest(), map.Highest());
+      ASSERT_EQ(ladder.Lowest(), map.Lowest());
+    }
+    ASSERT_EQ(ladder.Size(), map.Size());
+  }
+  EXPECT_EQ(Ascending(ladder), Ascending(map));
+  EXPECT_EQ(Descending(ladder), Descending(map));
+}
+
+TEST(PriceLevelsTest, LadderOrderBookMatchesMapOrderBook) {
+  std::mt19937 rng(7);
+  OrderBook map_book;
+  LadderOrderBook ladder_book;
+  for (int i = 0; i < 2000; ++i) {
+    const bool buy = rng() % 2 == 0;
+    const int64_t ticks = buy ? 1990000 - (rng() % 50) * 100 : 2010000 + (rng() % 50) * 100;
+    const int size = rng() % 4 == 0 ? 0 : static_cast<int>(rng() % 500) + 1;
+    const auto type = buy ? MessageType::PriceLevelUpdateBuy : MessageType::PriceLevelUpdateSell;
+    map_book.UpdateOrderBook(type, "ZIEXT", Price::FromTicks(ticks), size);
+    ladder_book.UpdateOrderBook(type, "ZIEXT", Price::FromTicks(ticks), size);
+  }
+  map_book.UpdateBBO();
+  ladder_book.UpdateBBO();
+  ASSERT_TRUE(map_book.GetBbo().has_value());
+  ASSERT_TRUE(ladder_book.GetBbo().has_value());
+  EXPECT_EQ(ladder_book.GetBbo()->getBidTicks(), map_book.GetBbo()->getBidTicks());
+  EXPECT_EQ(ladder_book.GetBbo()->getAskTicks(), map_book.GetBbo()->getAskTicks());
+  EXPECT_EQ(ladder_book.GetBookPressure(), map_book.GetBookPressure());
+
+  // Both write the same snapshot format.
+  std::ostringstream map_out;
+  std::ostringstream ladder_out;
+  map_book.SaveSnapshot(map_out);
+  ladder_book.SaveSnapshot(ladder_out);
+  EXPECT_EQ(ladder_out.str(), map_out.str());
+}
@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "quote_csv_writer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string FormatPrice(Price price) {
+  char out[32];
+  return std::string(out, QuoteCsvWriter::FormatPrice(price, out));
+}
+
+// Timestamps are formatted in local time, so the zone is pinned to UTC for the test and restored
+// afterwards for the rest of the binary.
+class QuoteCsvWriterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const char* tz = std::getenv("TZ");
+    had_tz_ = tz != nullptr;
+    if (had_tz_) {
+      saved_tz_ = tz;
+    }
+    setenv("TZ", "UTC", 1);
+    tzset();
+  }
+
+  void TearDown() override {
+    if (had_tz_) {
+      setenv("TZ", saved_tz_.c_str(), 1);
+    } else {
+      unsetenv("TZ");
+    }
+    tzset();
+  }
+
+ private:
+  bool had_tz_ = false;
+  std::string saved_tz_;
+};
+
+}  // namespace
+
+TEST_F(QuoteCsvWriterTest, FormatPrice) {
+  EXPECT_EQ(FormatPrice(Price::FromTicks(1234500)), "123.45");
+  EXPECT_EQ(FormatPrice(Price::FromTicks(1230000)), "123");
+  EXPECT_EQ(FormatPrice(Price::FromTicks(1)), "0.0001");
+  EXPECT_EQ(FormatPrice(Price::FromTicks(1000010)), "100.001");
+  EXPECT_EQ(FormatPrice(Price::FromTicks(0)), "0");
+  EXPECT_EQ(FormatPrice(Price::FromTicks(-25000)), "-2.5");
+}
+
+TEST_F(QuoteCsvWriterTest, WriteRows) {
+  const std::string filename = ::testing::TempDir() + "quote_csv_writer_test.csv";
+  // A buffer of a few rows, so the rows are flushed in several writes.
+  QuoteCsvWriter writer(16);
+  ASSERT_TRUE(writer.Open(filename));
+  const uint64_t open_time = 1516973400000000000;  // 2018-01-26 13:30:00 UTC
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_TRUE(writer.WriteQuote(open_time + i * 600000000ULL + 42, "TSLA", 100 + i,
+                                  Price::FromTicks(3500000 + i), 200,
+                                  Price::FromTicks(3501000)));
+  }
+  ASSERT_TRUE(writer.Close());
+
+  std::ifstream in(filename);
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "Timestamp,Symbol,BidSize,BidPrice,AskSize,AskPrice");
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "2018-01-26 13:30:00.000000042,TSLA,100,350,200,350.1");
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "2018-01-26 13:30:00.600000042,TSLA,101,350.0001,200,350.1");
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(line, "2018-01-26 13:30:01.200000042,TSLA,102,350.0002,200,350.1");
+  size_t rows = 3;
+  while (std::getline(in, line)) {
+    ++rows;
+  }
+  EXPECT_EQ(rows, 20u);
+  std::remove(filename.c_str());
+}
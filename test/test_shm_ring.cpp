@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "pcap_builder.h"
+#include "shm_ring.h"
+
+#include <cstdio>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace {
+
+constexpr int64_t base_time = 1517058000000000000;  // 2018-01-27 13:00 UTC
+
+bool PublishEvent(ShmRingPublisher& publisher, int64_t sq_num) {
+  const std::string event = BuildSystemEvent('R', base_time + sq_num);
+  return publisher.Publish(reinterpret_cast<const uint8_t*>(event.data()), event.size(), sq_num);
+}
+
+int64_t GetTimestamp(const IEXMessage& msg) {
+  return static_cast<int64_t>(std::get<SystemEventMessage>(msg).timestamp);
+}
+
+}  // namespace
+
+TEST(ShmRingTest, PublishAndConsume) {
+  const std::string name = "/iex_shm_ring_test";
+  ShmRingPublisher publisher(8);
+  ASSERT_TRUE(publisher.Open(name));
+  ShmRingConsumer consumer;
+  ASSERT_TRUE(consumer.Open(name));
+
+  IEXMessage msg;
+  EXPECT_EQ(consumer.GetNextMessage(msg), ReturnCode::WouldBlock);
+
+  for (int64_t sq_num = 1; sq_num <= 5; ++sq_num) {
+    ASSERT_TRUE(PublishEvent(publisher, sq_num));
+  }
+  EXPECT_EQ(consumer.GetLag(), 5u);
+  for (int64_t sq_num = 1; sq_num <= 5; ++sq_num) {
+    ASSERT_EQ(consumer.GetNextMessage(msg), ReturnCode::Success);
+    EXPECT_EQ(consumer.GetLastSequence(), sq_num);
+    EXPECT_EQ(GetTimestamp(msg), base_time + sq_num);
+  }
+  EXPECT_EQ(consumer.GetNextMessage(msg), ReturnCode::WouldBlock);
+
+  // Lapping the consumer loses the overwritten messages, reading resumes at an intact one.
+  for (int64_t sq_num = 6; sq_num <= 25; ++sq_num) {
+    ASSERT_TRUE(PublishEvent(publisher, sq_num));
+  }
+  ASSERT_EQ(consumer.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(consumer.GetOverrunCount(), 1u);
+  EXPECT_EQ(consumer.GetLastSequence(), 6 + static_cast<int64_t>(consumer.GetMissedCount()));
+  EXPECT_GE(consumer.GetLastSequence(), 18);
+  while (consumer.GetNextMessage(msg) == ReturnCode::Success) {
+  }
+  EXPECT_EQ(consumer.GetLastSequence(), 25);
+
+  // A consumer attaching late can still read what the ring holds.
+  ShmRingConsumer late_consumer;
+  ASSERT_TRUE(late_consumer.Open(name, true));
+  ASSERT_EQ(late_consumer.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(late_consumer.GetLastSequence(), 18);
+
+  publisher.Finish();
+  EXPECT_EQ(consumer.GetNextMessage(msg), ReturnCode::EndOfStream);
+
+  std::string oversized(shm_ring::max_message_len + 1, 'x');
+  EXPECT_FALSE(publisher.Publish(reinterpret_cast<const uint8_t*>(oversized.data()),
+                                 oversized.size(), 26));
+  publisher.Close();
+}
+
+// PublishAll reports a message too large for a slot instead of dropping it silently.
+TEST(ShmRingTest, PublishAllStopsAtOversizedMessage) {
+  std::vector<std::string> messages;
+  messages.push_back(BuildSystemEvent('O', base_time + 1));
+  std::string oversized = BuildSystemEvent('S', base_time + 2);
+  oversized.resize(shm_ring::max_message_len + 1, '\0');
+  messages.push_back(oversized);
+  messages.push_back(BuildSystemEvent('R', base_time + 3));
+  const std::string filename = ::testing::TempDir() + "shm_ring_test.pcap";
+  ASSERT_TRUE(WriteSegmentCapture(filename, base_time, {BuildSegment(1, base_time, messages)}));
+
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenFileForDecoding(filename, ReaderBackend::MemoryMapped));
+  const std::string name = "/iex_shm_ring_oversized_test";
+  ShmRingPublisher publisher(8);
+  ASSERT_TRUE(publisher.Open(name));
+  ShmRingConsumer consumer;
+  ASSERT_TRUE(consumer.Open(name));
+  EXPECT_EQ(publisher.PublishAll(decoder), ReturnCode::FailedWriting);
+
+  IEXMessage msg;
+  ASSERT_EQ(consumer.GetNextMessage(msg), ReturnCode::Success);
+  EXPECT_EQ(consumer.GetLastSequence(), 1);
+  EXPECT_EQ(consumer.GetNextMessage(msg), ReturnCode::WouldBlock);
+  publisher.Close();
+  std::remove(filename.c_str());
+}
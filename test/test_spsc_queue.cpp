@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+#include "spsc_queue.h"
+
+#include <cstdint>
+#include <thread>
+
+TEST(SpscQueueTest, FullAndEmpty) {
+  SpscQueue<int> queue(3);
+  EXPECT_EQ(queue.Capacity(), 4u);
+  int value = 0;
+  EXPECT_FALSE(queue.TryPop(value));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.TryPush(i));
+  }
+  EXPECT_FALSE(queue.TryPush(4));
+  EXPECT_EQ(queue.Size(), 4u);
+  ASSERT_TRUE(queue.TryPop(value));
+  EXPECT_EQ(value, 0);
+  EXPECT_TRUE(queue.TryPush(4));
+}
+
+TEST(SpscQueueTest, KeepsOrderAcrossThreads) {
+  constexpr uint64_t count = 1000000;
+  SpscQueue<uint64_t> queue(64);
+  std::thread producer([&queue]() {
+    for (uint64_t i = 0; i < count; ++i) {
+      while (!queue.TryPush(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  uint64_t expected = 0;
+  uint64_t value = 0;
+  while (expected < count) {
+    if (queue.TryPop(value)) {
+      ASSERT_EQ(value, expected++);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+}
@@ -0,0 +1,40 @@
+#include "gtest/gtest.h"
+#include "subscription.h"
+
+#include <cstring>
+
+namespace {
+
+// A message block with the type byte at 0 and the symbol at 10, as all symbol messages have.
+std::vector<uint8_t> MakeBlock(MessageType type, const char* symbol) {
+  std::vector<uint8_t> block(30, 0);
+  block[0] = static_cast<uint8_t>(type);
+  std::memset(block.data() + 10, ' ', 8);
+  std::memcpy(block.data() + 10, symbol, std::strlen(symbol));
+  return block;
+}
+
+}  // namespace
+
+TEST(SubscriptionTest, MatchesAllByDefault) {
+  Subscription subscription;
+  EXPECT_TRUE(subscription.MatchesAll());
+  auto block = MakeBlock(MessageType::QuoteUpdate, "AAPL");
+  EXPECT_TRUE(subscription.Matches(block.data(), block.size()));
+}
+
+TEST(SubscriptionTest, FilterOnSymbolAndType) {
+  Subscription subscription;
+  subscription.AddSymbol("TSLA").AddMessageType(MessageType::PriceLevelUpdateBuy)
+      .AddMessageType(MessageType::SystemEvent);
+
+  auto tsla_buy = MakeBlock(MessageType::PriceLevelUpdateBuy, "TSLA");
+  auto aapl_buy = MakeBlock(MessageType::PriceLevelUpdateBuy, "AAPL");
+  auto tsla_sell = MakeBlock(MessageType::PriceLevelUpdateSell, "TSLA");
+  auto system_event = MakeBlock(MessageType::SystemEvent, "");
+  EXPECT_TRUE(subscription.Matches(tsla_buy.data(), tsla_buy.size()));
+  EXPECT_FALSE(subscription.Matches(aapl_buy.data(), aapl_buy.size()));
+  EXPECT_FALSE(subscription.Matches(tsla_sell.data(), tsla_sell.size()));
+  // System events carry no symbol, so only the type filter applies.
+  EXPECT_TRUE(subscription.Matches(system_event.data(), system_event.size()));
+}
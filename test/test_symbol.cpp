@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "symbol.h"
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+TEST(SymbolTest, PackAndUnpack) {
+    const uint8_t wire[8] = {'Z', 'I', 'E', 'X', 'T', ' ', ' ', ' '};
+    Symbol from_wire = Symbol::FromWire(wire);
+    EXPECT_EQ(from_wire, Symbol("ZIEXT"));
+    EXPECT_EQ(from_wire, "ZIEXT");
+    EXPECT_EQ(from_wire.ToString(), "ZIEXT");
+    EXPECT_NE(from_wire, Symbol("ZIEX"));
+
+    EXPECT_TRUE(Symbol().empty());
+    EXPECT_EQ(Symbol().ToString(), "");
+    EXPECT_EQ(Symbol(std::string("ABCDEFGHIJ")).ToString(), "ABCDEFGH");
+}
+
+TEST(SymbolTest, AlphabeticalOrder) {
+    EXPECT_LT(Symbol("AAPL"), Symbol("AB"));
+    EXPECT_LT(Symbol("A"), Symbol("AA"));
+    EXPECT_LT(Symbol("TSLA"), Symbol("ZIEXT"));
+    EXPECT_FALSE(Symbol("TSLA") < Symbol("TSLA"));
+}
+
+TEST(SymbolTableTest, DenseIds) {
+    SymbolTable table(4);
+    EXPECT_EQ(table.Find("TSLA"), SymbolTable::invalid_id);
+
+    // Enough symbols to force the slot arrays to grow several times.
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(table.Intern(Symbol(("S" + std::to_string(i)).c_str())), static_cast<uint32_t>(i));
+    }
+    EXPECT_EQ(table.Size(), 1000u);
+    for (int i = 0; i < 1000; ++i) {
+        const Symbol symbol(("S" + std::to_string(i)).c_str());
+        EXPECT_EQ(table.Intern(symbol), static_cast<uint32_t>(i));
+        EXPECT_EQ(table.Find(symbol), static_cast<uint32_t>(i));
+        EXPECT_EQ(table.GetSymbol(i), symbol);
+    }
+}
+
+TEST(SymbolTableTest, SeedFromSecurityDirectory) {
+    SymbolTable table;
+    SecurityDirectoryMessage directory;
+    directory.symbol = "ZEXIT";
+    EXPECT_EQ(table.AddSecurity(directory), 0u);
+    EXPECT_EQ(table.Find("ZEXIT"), 0u);
+    EXPECT_EQ(table.Intern("AAPL"), 1u);
+}
+
+// Share classes, units and warrants share their leading characters, they must not share a chain.
+TEST(SymbolTableTest, PrefixFamiliesSpread) {
+    const char* const family[] = {"GOOG", "GOOGL", "BRK.A", "BRK.B", "SPAQ", "SPAQU", "SPAQW"};
+    SymbolTable table;
+    for (const char* symbol : family) {
+        table.Intern(symbol);
+    }
+    size_t total = 0;
+    for (const char* symbol : family) {
+        total += table.GetProbeLength(symbol);
+    }
+    EXPECT_LE(total, std::size(family) + 1);
+
+    // A whole generated family of one prefix with every suffix letter.
+    SymbolTable suffixes;
+    for (char c = 'A'; c <= 'Z'; ++c) {
+        suffixes.Intern(Symbol((std::string("SPAQ") + c).c_str()));
+    }
+    size_t longest = 0;
+    for (char c = 'A'; c <= 'Z'; ++c) {
+        const Symbol symbol((std::string("SPAQ") + c).c_str());
+        longest = std::max(longest, suffixes.GetProbeLength(symbol));
+    }
+    EXPECT_LE(longest, 3u);
+}
@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+#include "iex_decoder.h"
+#include "pcap_builder.h"
+#include "pcap_replayer.h"
+#include "udp_packet_source.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replay a capture over loopback and decode it from the live source, with simulated loss.
+TEST(UdpPacketSourceTest, ReplayOverLoopback) {
+  constexpr int64_t t0 = 1517058015909382289;
+  constexpr int segment_count = 21;
+  constexpr int messages_per_segment = 3;
+  std::vector<std::string> payloads;
+  for (int i = 0; i < segment_count; ++i) {
+    std::vector<std::string> messages;
+    for (int j = 0; j < messages_per_segment; ++j) {
+      messages.push_back(BuildSystemEvent('O', t0 + i * messages_per_segment + j));
+    }
+    payloads.push_back(BuildSegment(1 + i * messages_per_segment, t0 + i, messages));
+  }
+  const std::string filename = ::testing::TempDir() + "udp_source_test.pcap";
+  ASSERT_TRUE(WritePcapFile(filename, payloads));
+
+  auto source_ptr = std::make_unique<UdpPacketSource>(8, 500);
+  ASSERT_TRUE(source_ptr->Open("127.0.0.1:0"));
+  UdpPacketSource* source = source_ptr.get();
+  IEXDecoder decoder;
+  ASSERT_TRUE(decoder.OpenSourceForDecoding(std::move(source_ptr)));
+
+  // Every fifth segment is dropped by the replayer.
+  constexpr size_t skip_every = 5;
+  PcapReplayer replayer;
+  ASSERT_TRUE(replayer.Open(filename, "127.0.0.1:" + std::to_string(source->GetPort())));
+  size_t sent = 0;
+  std::thread replay_thread([&] { sent = replayer.Run(5000, 0, skip_every); });
+
+  IEXMessage msg;
+  size_t received = 0;
+  while (decoder.GetNextMessage(msg) == ReturnCode::Success) {
+    ++received;
+  }
+  replay_thread.join();
+  std::remove(filename.c_str());
+
+  const size_t dropped = segment_count / skip_every;
+  EXPECT_EQ(sent, segment_count - dropped);
+  EXPECT_EQ(received, sent * messages_per_segment);
+  EXPECT_EQ(source->GetGapCount(), dropped);
+  EXPECT_EQ(source->GetMissedMessageCount(), dropped * messages_per_segment);
+  EXPECT_EQ(source->GetExpectedSequence(), 1 + segment_count * messages_per_segment);
+}
+
+// A malformed or out of range port is rejected instead of being sent to port 0.
+TEST(UdpPacketSourceTest, ReplayerRejectsBadPorts) {
+  const std::string filename = ::testing::TempDir() + "udp_source_port_test.pcap";
+  ASSERT_TRUE(WritePcapFile(filename, {BuildSegment(1, 0, {})}));
+  PcapReplayer replayer;
+  for (const char* destination : {"127.0.0.1:0", "127.0.0.1:65536", "127.0.0.1:4294967297",
+                                  "127.0.0.1:12a", "127.0.0.1:", "127.0.0.1:-1"}) {
+    EXPECT_FALSE(replayer.Open(filename, destination)) << destination;
+  }
+  EXPECT_TRUE(replayer.Open(filename, "127.0.0.1:65535"));
+  replayer.Close();
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Helpers for tests that write files, keeping them out of the working directory.
+
+// A fresh directory under the gtest temp dir, or an empty string if it cannot be created.
+inline std::string MakeTempDirectory(const std::string& prefix) {
+  std::string path = ::testing::TempDir() + prefix + "_XXXXXX";
+  std::vector<char> buffer(path.begin(), path.end());
+  buffer.push_back('\0');
+  if (::mkdtemp(buffer.data()) == nullptr) {
+    return std::string();
+  }
+  return std::string(buffer.data());
+}
+
+// Remove a directory holding only files.
+inline void RemoveDirectory(const std::string& directory) {
+  if (DIR* dir = ::opendir(directory.c_str())) {
+    while (const dirent* entry = ::readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name != "." && name != "..") {
+        ::unlink((directory + "/" + name).c_str());
+      }
+    }
+    ::closedir(dir);
+  }
+  ::rmdir(directory.c_str());
+}
+
+// Fixture giving every test its own temp directory, removed with its files afterwards.
+class TempDirectoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    directory = MakeTempDirectory(std::string(info->test_suite_name()) + "_" + info->name());
+  }
+  void TearDown() override {
+    if (!directory.empty()) {
+      RemoveDirectory(directory);
+    }
+  }
+
+  std::string directory;
+};